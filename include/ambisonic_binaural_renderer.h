@@ -0,0 +1,76 @@
+#ifndef AMBISONIC_BINAURAL_RENDERER_H_
+#define AMBISONIC_BINAURAL_RENDERER_H_
+
+#include <vector>
+
+#include "binaural_bus_renderer.h"
+
+class FFTFilter;
+
+// Encodes sources into a first to third order Ambisonics bus (real spherical
+// harmonics, ACN channel order, N3D normalization) and decodes the bus to
+// binaural over a fixed layout of virtual speakers taken from the HRTF bank.
+// The decoder and the virtual speaker HRTFs are folded into one filter per
+// bus channel and ear, so 2 * (order + 1)^2 convolutions run per block
+// regardless of the number of sources.
+//
+// Source directions are given in world coordinates. Head rotation is applied
+// as a single rotation of the bus.
+class AmbisonicBinauralRenderer : public BinauralBusRenderer {
+ public:
+  AmbisonicBinauralRenderer(const HRTF& hrtf, int order, int block_size);
+  virtual ~AmbisonicBinauralRenderer();
+
+  int GetOrder() const;
+  int GetNumChannels() const;
+
+  // Yaw turns the head to the right, pitch lifts the nose and roll tilts the
+  // right ear down. The rotation is crossfaded over the next block.
+  void SetHeadRotation(float yaw_deg, float pitch_deg, float roll_deg);
+
+  virtual int AddSource();
+  virtual void SetSourceDirection(int source_id, float elevation_deg,
+                                  float azimuth_deg, float distance);
+  virtual void AddSourceBlock(int source_id, const std::vector<float>& input);
+  virtual void ProcessBlock(std::vector<float>* output_left,
+                            std::vector<float>* output_right);
+
+ private:
+  struct Source {
+    std::vector<float> gains;
+    std::vector<float> target_gains;
+  };
+
+  // Spherical harmonics of the unit vector |direction| (x front, y left,
+  // z up) up to |order_|.
+  void EncodeDirection(const float direction[3],
+                       std::vector<float>* coefficients) const;
+  void InitRotation();
+  void InitDecoder();
+  void RotateBus(const std::vector<double>& rotation,
+                 std::vector<std::vector<float> >* rotated_bus) const;
+
+  const int order_;
+  const int num_channels_;
+
+  std::vector<Source> sources_;
+  std::vector<std::vector<float> > bus_;
+
+  // Rotation matrices (num_channels_ x num_channels_, row major) are
+  // computed by least squares from the harmonics of a set of sample
+  // directions before and after rotating them.
+  std::vector<std::vector<float> > rotation_samples_;
+  std::vector<double> rotation_projection_;
+  std::vector<double> rotation_;
+  std::vector<double> target_rotation_;
+  bool rotation_is_identity_;
+
+  std::vector<std::vector<float> > rotated_bus_;
+  std::vector<std::vector<float> > prev_rotated_bus_;
+  std::vector<float> xfade_window_;
+
+  std::vector<FFTFilter*> channel_filters_[2];
+  std::vector<float> filtered_channel_;
+};
+
+#endif  // AMBISONIC_BINAURAL_RENDERER_H_
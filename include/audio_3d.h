@@ -3,28 +3,263 @@
 
 #include <cstdint>
 #include <vector>
+
+#include "parametric_hrtf.h"
+
+class BlockFifo;
+class DelayLine;
+class FractionalDelayLine;
 class FFTFilter;
+class FIRFilter;
 class HRTF;
+class HRTFDataSource;
 class Reberation;
 
 class Audio3DSource {
  public:
   Audio3DSource(int sample_rate, int block_size);
+  Audio3DSource(const HRTFDataSource& hrtf_data_source, int sample_rate,
+                int block_size);
+  // Shares an HRTF bank with other sources. |hrtf| must outlive the source.
+  // Such sources render no reverb themselves, their owner mixes
+  // AddReverbSend() into a shared reverb bus.
+  Audio3DSource(const HRTF& hrtf, int block_size);
   virtual ~Audio3DSource();
 
-  void SetPosition(int x, int y, int z);
+  // Listener-relative position in meters, x to the right, y to the front
+  // and z up, see ListenerPose. Audio3DScene transforms many sources at once.
+  void SetPosition(float x, float y, float z);
   void SetDirection(float elevation_deg, float azimuth_deg, float distance);
 
+  int GetBlockSize() const;
+
+  // Delays the source by the propagation time of sound over its distance,
+  // so that a moving source is Doppler shifted. Longer distances are
+  // clamped to |max_distance| meters, 0 disables the propagation delay.
+  // Allocates only when |max_distance| exceeds all previous maxima.
+  void SetMaxDistance(float max_distance);
+  float GetMaxDistance() const;
+
+  // Distance attenuation of the direct sound.
+  float GetDistanceGain() const;
+
+  // A virtual source skips rendering and only advances its clock, i.e. the
+  // propagation delay. Turning virtual fades the source out over one block,
+  // turning audible again fades it back in. Only for sources sharing their
+  // HRTF bank, see Audio3DScene::SetMaxVoices().
+  void SetVirtual(bool is_virtual);
+  // True once the fade-out and one more block playing the filter tails
+  // have been rendered; ProcessBlock() then outputs silence and adds
+  // nothing to the spectrum or reverb send.
+  bool IsVirtual() const;
+
+  enum QualityTier {
+    // Full-length HRTF convolution.
+    kFullHRTF,
+    // Truncated minimum-phase HRTFs and a fractional interaural time delay.
+    kTruncatedHRTF,
+    // Interaural time delay, broadband level difference and a one-pole head
+    // shadow filter per ear, see ParametricHRTF.
+    kParametric
+  };
+
+  // Switching tiers is crossfaded over one block.
+  void SetQualityTier(QualityTier quality_tier);
+  QualityTier GetQualityTier() const;
+  // Renders no better than |quality_tier| regardless of GetQualityTier(),
+  // e.g. to shed load. kFullHRTF removes the limit.
+  void LimitQualityTier(QualityTier quality_tier);
+  QualityTier GetQualityTierLimit() const;
+
+  // Keeps the selected HRTF until the direction has moved by more than
+  // |degrees| in elevation or azimuth, which saves kernel switches of
+  // slowly moving sources. Defaults to 0.
+  void SetHRTFSwitchHysteresis(float degrees);
+  float GetHRTFSwitchHysteresis() const;
+
+  // Degradation imposed by a load governor, see
+  // Audio3DScene::SetCPUBudget(). Kept apart from the settings above, which
+  // it never overwrites: the source renders the cheaper tier, the larger
+  // hysteresis and mutes the reverb send if either side asks for it.
+  void SetGovernorLimits(QualityTier quality_tier_limit,
+                         float hrtf_switch_hysteresis_deg,
+                         bool reverb_send_muted);
+  QualityTier GetGovernorQualityTierLimit() const;
+
+  // Kernel switches, see Audio3DScene::SetMaxHRTFSwitchesPerBlock(). A
+  // switch is pending if the current direction selects another HRTF than
+  // the rendered one; the direction error is the angle between the two
+  // directions in degrees. DeferHRTFSwitch() keeps the rendered HRTF for
+  // the next block.
+  bool IsHRTFSwitchPending() const;
+  float GetHRTFDirectionError() const;
+  void DeferHRTFSwitch();
+
+  // Stores the frequency-domain HRTF bank in half precision, see
+  // HRTF::ConvertFreqDomainBankToHalfFloat(). Only for sources owning their
+  // HRTF bank.
+  void UseHalfFloatHRTFBank();
+
   void ProcessBlock(const std::vector<float>&input,
                     std::vector<float>* output_left,
                     std::vector<float>* output_right);
+  // Writes GetBlockSize() interleaved left/right frames to |output|.
+  void ProcessBlock(const std::vector<float>& input, float* output);
+
+  // Render directly from and to host buffers without allocating. |input|
+  // holds GetBlockSize() frames of |num_input_channels| interleaved
+  // channels, which are downmixed to mono. The output is written with
+  // |output_stride| floats per frame; interleaved stereo uses
+  // output_right = output_left + 1 and a stride of 2, planar output a
+  // stride of 1.
+  void ProcessBlock(const float* input, int num_input_channels,
+                    float* output_left, float* output_right,
+                    int output_stride);
+  // Planar input, |input_channels| points to |num_input_channels| blocks.
+  void ProcessBlock(const float* const* input_channels,
+                    int num_input_channels, float* output_left,
+                    float* output_right, int output_stride);
+
+  // Accepts any number of frames per call, e.g. variable host buffer sizes.
+  // The frames are rebuffered into blocks of GetBlockSize(), which delays
+  // the output by GetFifoLatency() frames. Arguments as for ProcessBlock();
+  // changing |num_input_channels| between calls allocates. Must not be
+  // mixed with ProcessBlock().
+  void ProcessFrames(const float* input, int num_input_channels,
+                     int num_frames, float* output_left, float* output_right,
+                     int output_stride);
+  int GetFifoLatency() const;
+
+  // Renders the full HRTF tier into the frequency domain for summation with
+  // other sources, see Audio3DScene. Adds the filtered spectrum of |input|
+  // to |spectrum_left| and |spectrum_right| (FFTFilter layout of the block
+  // size) which the owner inverse transforms and overlap-adds. Crossfades
+  // and the other quality tiers are written to |output_left| and
+  // |output_right| in the time domain. Distance damping scales the spectrum
+  // and therefore changes per block instead of ramping. Only for sources
+  // sharing their HRTF bank; a source must not mix the time-domain and the
+  // spectral ProcessBlock().
+  void ProcessBlock(const std::vector<float>& input,
+                    std::vector<float>* spectrum_left,
+                    std::vector<float>* spectrum_right,
+                    std::vector<float>* output_left,
+                    std::vector<float>* output_right);
+
+  // Reverb send level at the HRTF distance. The send falls off with the
+  // square root of the distance attenuation.
+  void SetReverbSendLevel(float level);
+  // Fades the reverb send out while muted.
+  void SetReverbSendMuted(bool muted);
+  bool IsReverbSendMuted() const;
+  // Adds the reverb send of the last processed block to |send_bus|.
+  void AddReverbSend(std::vector<float>* send_bus) const;
  private:
+  class FifoProcessor;
+
+  // Takes ownership of |owned_hrtf| and renders its own reverb.
+  Audio3DSource(HRTF* owned_hrtf, int block_size);
+
+  void Init();
+  void InitReberation();
+  // True if the direction moved beyond the switch hysteresis since the last
+  // HRTF selection.
+  bool HasDirectionChanged() const;
+  // Looks up the HRTF of the current direction. Returns true if the
+  // selected bank entry changed.
+  bool SelectHRTF();
   void CalculateXFadeWindow();
-  void ApplyXFadeWindow(const std::vector<float>& block_a,
-                        const std::vector<float>& block_b,
-                        std::vector<float>* output);
 
-  static void ApplyDamping(float damping_factor, std::vector<float>* block);
+  void SetFullHRTFKernels();
+  bool RenderFullHRTF(const float* input, bool new_hrtf_selected,
+                      std::vector<float>* output_left,
+                      std::vector<float>* output_right,
+                      std::vector<float>* previous_left,
+                      std::vector<float>* previous_right);
+  void ResetFullHRTF(const float* input,
+                     std::vector<float>* output_left,
+                     std::vector<float>* output_right);
+
+  // Adds the full HRTF spectrum of one ear for the spectral ProcessBlock().
+  // The bus holds the tail of the previous block filtered with the previous
+  // kernel and damping. If the kernel or the damping changed, writes the
+  // time-domain |correction| that crossfades to the current kernel and
+  // ramps the damping like RenderBlock(), and returns true.
+  bool AddFullHRTFSpectrum(bool left_ear, bool previous_full_hrtf,
+                           int previous_hrtf_index,
+                           bool previous_left_right_swap,
+                           float previous_damping,
+                           std::vector<float>* spectrum,
+                           std::vector<float>* correction);
+  // Adds |spectrum| times the full HRTF of one ear, scaled by |gain|, to
+  // |result|. Reads the kernel from the bank in its stored precision.
+  void MultiplyAddKernel(const std::vector<float>& spectrum, bool left_ear,
+                         int hrtf_index, bool left_right_swap, float gain,
+                         std::vector<float>* result) const;
+  // Writes |spectrum| times the previous minus the current full HRTF to
+  // |product_spectrum_|. A missing kernel is zero.
+  void MultiplyDifferenceKernel(const std::vector<float>& spectrum,
+                                bool left_ear, bool previous_full_hrtf,
+                                int previous_hrtf_index,
+                                bool previous_left_right_swap,
+                                bool full_hrtf);
+  static void MultiplyAddSpectrum(const std::vector<float>& spectrum_a,
+                                  const std::vector<float>& spectrum_b,
+                                  float gain, std::vector<float>* result);
+  static void MultiplyAddSpectrum(const std::vector<float>& spectrum_a,
+                                  const std::vector<uint16_t>& half_spectrum_b,
+                                  float gain, std::vector<float>* result);
+
+  void UpdateInterauralDelay(const float* input);
+  bool RenderMinimumPhaseHRTF(std::vector<float>* output_left,
+                              std::vector<float>* output_right,
+                              std::vector<float>* previous_left,
+                              std::vector<float>* previous_right);
+
+  void ResetParametric(std::vector<float>* output_left,
+                       std::vector<float>* output_right);
+  void RenderParametric(std::vector<float>* output_left,
+                        std::vector<float>* output_right);
+  static void ApplyParametricEar(
+      const std::vector<float>& delayed_input,
+      const ParametricHRTF::EarParameters& target_parameters,
+      ParametricHRTF::EarParameters* parameters, float* shadow_state,
+      std::vector<float>* output);
+
+  void UpdateTargetQualityTier();
+  // Renders the current block with |quality_tier|. If the tier crossfades
+  // to a new HRTF, the output of the previous HRTF goes to |previous_left|
+  // and |previous_right| for the output stage and true is returned. Without
+  // them the tier keeps the previous HRTF. StartQualityTier() is used for
+  // the first block after a tier switch and resets the tier state.
+  bool RenderQualityTier(QualityTier quality_tier, const float* input,
+                         bool new_hrtf_selected,
+                         std::vector<float>* output_left,
+                         std::vector<float>* output_right,
+                         std::vector<float>* previous_left,
+                         std::vector<float>* previous_right);
+  void StartQualityTier(QualityTier quality_tier, const float* input,
+                        std::vector<float>* output_left,
+                        std::vector<float>* output_right);
+
+  void UpdateReverbSend(const float* input);
+  // Returns |input| delayed by the propagation delay, or |input| itself if
+  // the propagation delay is disabled.
+  const float* ApplyPropagationDelay(const float* input);
+  // Returns |input| faded out or in while the source turns virtual or
+  // audible, silence for the block after the fade-out, otherwise |input|
+  // itself. A source resuming from silence clears |new_hrtf_selected|.
+  const float* ApplyVirtualFade(const float* input, bool* new_hrtf_selected);
+  // Resets the filter, overlap and interaural delay history to silence and
+  // sets up all tiers for the current HRTF when the source turns audible
+  // again.
+  void ResumeFromSilence();
+
+  // Renders the quality tiers and mixes crossfade, distance damping and
+  // reverb into the output in one pass, see RenderOutputStage().
+  // |source_input| holds one block and may point into a host buffer.
+  void RenderBlock(const float* source_input, float* output_left,
+                   float* output_right, int output_stride);
+
   const int sample_rate_;
   const int block_size_;
   float elevation_deg_;
@@ -32,14 +267,82 @@ class Audio3DSource {
   float distance_;
 
   float damping_;
+  // Damping reached at the end of the last block. Both renderers ramp from
+  // it to |damping_|; negative before the first block.
+  float applied_damping_;
 
   std::vector<float> xfade_window_;
   std::vector<float> prev_signal_block_;
+  std::vector<float> input_block_;
+  std::vector<float> tier_output_left_;
+  std::vector<float> tier_output_right_;
+  std::vector<float> previous_tier_output_left_;
+  std::vector<float> previous_tier_output_right_;
+
+  const HRTF* hrtf_;
+  HRTF* owned_hrtf_;
+  int hrtf_index_;
+  bool left_right_swap_;
+  float selected_elevation_deg_;
+  float selected_azimuth_deg_;
 
-  HRTF* hrtf_;
   FFTFilter* left_hrtf_filter_;
   FFTFilter* right_hrtf_filter_;
 
+  // Frequency-domain rendering.
+  std::vector<float> input_spectrum_;
+  std::vector<float> prev_input_spectrum_;
+  std::vector<float> product_spectrum_;
+  std::vector<float> correction_signal_;
+  std::vector<float> full_hrtf_correction_left_;
+  std::vector<float> full_hrtf_correction_right_;
+
+  QualityTier quality_tier_;
+  QualityTier quality_tier_limit_;
+  QualityTier governor_quality_tier_limit_;
+  // Tier rendered in the current block, the cheapest of |quality_tier_| and
+  // both limits.
+  QualityTier target_quality_tier_;
+  QualityTier active_quality_tier_;
+  float hrtf_switch_hysteresis_deg_;
+  float governor_hysteresis_deg_;
+  bool hrtf_switch_deferred_;
+  DelayLine* itd_delay_line_;
+  float left_delay_;
+  float right_delay_;
+  std::vector<float> left_delayed_input_;
+  std::vector<float> right_delayed_input_;
+  FIRFilter* left_min_phase_filter_;
+  FIRFilter* right_min_phase_filter_;
+  const std::vector<float>* left_min_phase_kernel_;
+  const std::vector<float>* right_min_phase_kernel_;
+
+  // Owned by the HRTF bank.
+  const ParametricHRTF* parametric_hrtf_;
+  ParametricHRTF::EarParameters left_parametric_;
+  ParametricHRTF::EarParameters right_parametric_;
+  float left_shadow_state_;
+  float right_shadow_state_;
+
+  float max_distance_;
+  FractionalDelayLine* propagation_delay_line_;
+  std::vector<float> propagated_input_;
+
+  bool is_virtual_;
+  // The last block was silent.
+  bool virtual_faded_out_;
+  // The block after the fade-out has been rendered.
+  bool virtual_tail_played_;
+  std::vector<float> virtual_fade_input_;
+
+  BlockFifo* fifo_;
+  FifoProcessor* fifo_processor_;
+
+  float reverb_send_level_;
+  bool reverb_send_muted_;
+  bool governor_reverb_send_muted_;
+  float reverb_send_gain_;
+  std::vector<float> reverb_send_block_;
   Reberation* reberation_;
 };
 
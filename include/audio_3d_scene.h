@@ -0,0 +1,266 @@
+#ifndef AUDIO_3D_SCENE_H_
+#define AUDIO_3D_SCENE_H_
+
+#include <vector>
+
+#include "listener_geometry.h"
+#include "thread_pool.h"
+
+class Audio3DSource;
+class BlockFifo;
+class FDNReverb;
+class FFTFilter;
+class HRTF;
+class HRTFDataSource;
+class Reberation;
+
+// Renders many Audio3DSources that share one HRTF bank into a single stereo
+// output bus. The sources feed one shared reverb through their distance
+// dependent reverb sends.
+//
+// Sources can be rendered on a persistent work-stealing thread pool. Every
+// source renders into its own buffers which are summed in id order, so the
+// output is bit-identical for any number of threads.
+class Audio3DScene {
+ public:
+  Audio3DScene(int sample_rate, int block_size);
+  Audio3DScene(const HRTFDataSource& hrtf_data_source, int sample_rate,
+               int block_size);
+  virtual ~Audio3DScene();
+
+  int GetSampleRate() const;
+  int GetBlockSize() const;
+
+  // Renders sources on |num_threads| workers, <= 0 selects all hardware
+  // cores. The thread calling ProcessBlock() is one of the workers. Workers
+  // try to switch to realtime scheduling.
+  void SetNumThreads(int num_threads);
+  int GetNumThreads() const;
+  // Scheduling statistics of the last rendered block.
+  const ThreadPool::Stats& GetSchedulerStats() const;
+
+  enum SummationMode {
+    // Every source convolves and overlap-adds on its own, the outputs are
+    // summed in the time domain.
+    kTimeDomainSummation,
+    // Sources add their filtered spectra to one left and one right spectrum
+    // bus which takes the only two inverse FFTs per block. HRTF and quality
+    // tier crossfades are rendered as time-domain corrections.
+    kFrequencyDomainSummation
+  };
+  // Must be selected before the first block is rendered.
+  void SetSummationMode(SummationMode summation_mode);
+  SummationMode GetSummationMode() const;
+
+  enum ReverbMode {
+    // Convolution with a synthesized impulse response, see Reberation.
+    kConvolutionReverb,
+    // Feedback delay network whose cost does not depend on the decay time,
+    // see FDNReverb.
+    kFDNReverb
+  };
+  // Must be selected before the first block is rendered.
+  void SetReverbMode(ReverbMode reverb_mode);
+  ReverbMode GetReverbMode() const;
+  // Decay times of the FDN reverb to -60 dB at low and high frequencies in
+  // seconds. Can be changed while rendering.
+  void SetFDNReverbTime(float low_reverb_time, float high_reverb_time);
+
+  // Stores the shared frequency-domain HRTF bank in half precision. Must be
+  // called before adding sources.
+  void UseHalfFloatHRTFBank();
+
+  // Returns the id of a new source. Ids are consecutive starting at 0.
+  int AddSource();
+  int GetNumSources() const;
+  // The scene keeps ownership of its sources.
+  Audio3DSource* GetSource(int source_id);
+
+  // Places source |source_id| at a world position in meters. Before every
+  // block the positions of all placed sources are converted to directions
+  // relative to the listener pose in one batch, which then overrides
+  // Audio3DSource::SetDirection() of these sources.
+  void SetSourcePosition(int source_id, float x, float y, float z);
+  void SetListenerPose(const ListenerPose& listener_pose);
+  const ListenerPose& GetListenerPose() const;
+
+  // Voice management. Before every block each source gets an audibility
+  // of its distance gain times the RMS level of its input block. Sources
+  // below |threshold| and all but the |max_voices| most audible sources
+  // turn virtual (see Audio3DSource::SetVirtual()) and cost next to nothing
+  // until they are audible again. A threshold of 0 and |max_voices| <= 0
+  // disable the respective limit, which is the default.
+  void SetAudibilityThreshold(float threshold);
+  void SetMaxVoices(int max_voices);
+  int GetMaxVoices() const;
+  // Number of sources virtualized for the last rendered block.
+  int GetNumVirtualSources() const;
+
+  // CPU budget governor. Measures the render time of every block against
+  // |budget| times the block period (e.g. 0.5). Over budget it steps down
+  // one quality level per block; after a run of blocks well below the
+  // budget it steps back up. Quality levels, each including the previous:
+  //   1  widens the HRTF switch hysteresis of all sources,
+  //   2  mutes the reverb sends of the more distant half of the sources,
+  //   3  limits these sources to Audio3DSource::kTruncatedHRTF,
+  //   4  limits them to kParametric and the others to kTruncatedHRTF.
+  // 0 disables the governor and restores full quality (default). The
+  // levels apply through Audio3DSource::SetGovernorLimits() and keep the
+  // settings made on the sources themselves.
+  void SetCPUBudget(float budget);
+  float GetCPUBudget() const;
+
+  struct GovernorStats {
+    int quality_level;
+    int num_step_downs;
+    int num_step_ups;
+    int num_blocks_over_budget;
+    double last_render_seconds;
+  };
+  const GovernorStats& GetGovernorStats() const;
+
+  // Limits the number of HRTF kernel switches per block, whose crossfades
+  // cost extra transforms. When more sources need a new HRTF, e.g. after a
+  // head rotation, the switches are staggered over the following blocks in
+  // order of direction error times loudness, weighted by the number of
+  // blocks a source has waited. <= 0 allows any number (default).
+  void SetMaxHRTFSwitchesPerBlock(int max_switches);
+  int GetMaxHRTFSwitchesPerBlock() const;
+  // Number of switches postponed in the last rendered block.
+  int GetNumDeferredHRTFSwitches() const;
+
+  // Renders one block of all sources. |inputs| holds one block per source
+  // in id order. The interleaved version writes GetBlockSize() left/right
+  // sample pairs to |output|.
+  void ProcessBlock(const std::vector<std::vector<float> >& inputs,
+                    float* output);
+  void ProcessBlock(const std::vector<std::vector<float> >& inputs,
+                    float* output_left, float* output_right);
+  void ProcessBlock(const std::vector<std::vector<float> >& inputs,
+                    float* output_left, float* output_right,
+                    int output_stride);
+
+  // Render directly from and to host buffers without allocating. |input|
+  // holds GetBlockSize() frames with one interleaved channel per source in
+  // id order, |input_channels| points to one block per source. The output
+  // is written with |output_stride| floats per frame; interleaved stereo
+  // uses output_right = output_left + 1 and a stride of 2.
+  void ProcessBlock(const float* input, float* output_left,
+                    float* output_right, int output_stride);
+  void ProcessBlock(const float* const* input_channels, float* output_left,
+                    float* output_right, int output_stride);
+
+  // Accepts any number of frames per call with one interleaved channel per
+  // source. The frames are rebuffered into blocks of GetBlockSize(), which
+  // delays the output by GetFifoLatency() frames. Must not be mixed with
+  // ProcessBlock().
+  void ProcessFrames(const float* input, int num_frames, float* output_left,
+                     float* output_right, int output_stride);
+  int GetFifoLatency() const;
+
+ private:
+  class FifoProcessor;
+  class RenderTask;
+
+  // Takes ownership of |hrtf|.
+  Audio3DScene(HRTF* hrtf, int sample_rate, int block_size);
+
+  // Input and rendered block of one source.
+  struct SourceOutput {
+    std::vector<float> input;
+    std::vector<float> left;
+    std::vector<float> right;
+    std::vector<float> reverb_send;
+    // Only used for kFrequencyDomainSummation.
+    std::vector<float> spectrum_left;
+    std::vector<float> spectrum_right;
+    // Virtual source, the buffers hold no signal.
+    bool silent;
+  };
+
+  void Init();
+  // Allocates the reverb of |reverb_mode_| and frees the other one.
+  void CreateReverb();
+  void RenderSources(float* output_left, float* output_right,
+                     int output_stride);
+  void RenderSource(int source_id);
+  void UpdateSourceDirections();
+  float GetInputLevel(int source_id) const;
+  void UpdateVirtualSources();
+  void UpdateGovernor(double render_seconds);
+  void ScheduleHRTFSwitches();
+  void ApplyQualityLevel();
+  // Inverse transforms |spectrum| and overlap-adds it to |bus|.
+  void AddSpectrumBus(const std::vector<float>& spectrum,
+                      std::vector<float>* tail, std::vector<float>* bus);
+
+  const int sample_rate_;
+  const int block_size_;
+
+  HRTF* hrtf_;
+  std::vector<Audio3DSource*> sources_;
+  // Only the reverb of |reverb_mode_| is allocated, the other one is 0.
+  Reberation* reberation_;
+  FDNReverb* fdn_reverb_;
+
+  ThreadPool* thread_pool_;
+  RenderTask* render_task_;
+  // Input of the block being rendered, either interleaved or planar.
+  const float* input_;
+  const float* const* input_channels_;
+  std::vector<const float*> input_channel_pointers_;
+  std::vector<SourceOutput> source_outputs_;
+
+  BlockFifo* fifo_;
+  FifoProcessor* fifo_processor_;
+
+  // Source positions as separate coordinate arrays for the batch transform.
+  ListenerPose listener_pose_;
+  std::vector<float> source_x_;
+  std::vector<float> source_y_;
+  std::vector<float> source_z_;
+  std::vector<bool> source_positioned_;
+  int num_positioned_sources_;
+  std::vector<float> source_elevation_deg_;
+  std::vector<float> source_azimuth_deg_;
+  std::vector<float> source_distance_;
+
+  float audibility_threshold_;
+  int max_voices_;
+  int num_virtual_sources_;
+  std::vector<float> source_audibility_;
+  // Audible source ids, ordered by audibility when voices are limited.
+  std::vector<int> voices_;
+
+  float cpu_budget_;
+  GovernorStats governor_stats_;
+  int num_blocks_below_budget_;
+  std::vector<float> source_distance_gain_;
+  // Source ids, the more distant half first when degrading quality.
+  std::vector<int> distance_order_;
+
+  int max_hrtf_switches_per_block_;
+  int num_deferred_hrtf_switches_;
+  // Sources with a pending switch, the ones switching first.
+  std::vector<int> pending_switches_;
+  std::vector<float> switch_priority_;
+  std::vector<int> num_blocks_deferred_;
+
+  SummationMode summation_mode_;
+  ReverbMode reverb_mode_;
+  float fdn_low_reverb_time_;
+  float fdn_high_reverb_time_;
+  bool rendering_started_;
+  FFTFilter* bus_filter_;
+  std::vector<float> spectrum_bus_left_;
+  std::vector<float> spectrum_bus_right_;
+  std::vector<float> bus_signal_;
+  std::vector<float> bus_tail_left_;
+  std::vector<float> bus_tail_right_;
+
+  std::vector<float> bus_left_;
+  std::vector<float> bus_right_;
+  std::vector<float> reverb_send_bus_;
+};
+
+#endif  // AUDIO_3D_SCENE_H_
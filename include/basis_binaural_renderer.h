@@ -0,0 +1,50 @@
+#ifndef BASIS_BINAURAL_RENDERER_H_
+#define BASIS_BINAURAL_RENDERER_H_
+
+#include <vector>
+
+#include "binaural_bus_renderer.h"
+
+class DelayLine;
+class FFTFilter;
+class HRTFBasis;
+
+// Renders sources through the principal-component basis of the HRTF bank.
+// Each source applies its interaural time delay and mixes into one bus per
+// basis filter and ear, weighted by its HRTF's basis weights. Only the basis
+// filters are convolved, 2 * (GetNumBasisFilters() + 1) per block.
+class BasisBinauralRenderer : public BinauralBusRenderer {
+ public:
+  BasisBinauralRenderer(const HRTF& hrtf, const HRTFBasis& basis,
+                        int block_size);
+  virtual ~BasisBinauralRenderer();
+
+  virtual int AddSource();
+  virtual void SetSourceDirection(int source_id, float elevation_deg,
+                                  float azimuth_deg, float distance);
+  virtual void AddSourceBlock(int source_id, const std::vector<float>& input);
+  virtual void ProcessBlock(std::vector<float>* output_left,
+                            std::vector<float>* output_right);
+
+ private:
+  struct Source {
+    DelayLine* delay_line;
+    // Per ear: onset delay and bus gains, bus 0 carries the mean filter.
+    float delay[2];
+    float target_delay[2];
+    std::vector<float> gains[2];
+    std::vector<float> target_gains[2];
+  };
+
+  const HRTFBasis& basis_;
+  int num_buses_;
+
+  std::vector<Source> sources_;
+
+  std::vector<std::vector<float> > buses_[2];
+  std::vector<FFTFilter*> bus_filters_[2];
+  std::vector<float> delayed_input_;
+  std::vector<float> filtered_bus_;
+};
+
+#endif  // BASIS_BINAURAL_RENDERER_H_
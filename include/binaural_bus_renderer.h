@@ -0,0 +1,53 @@
+#ifndef BINAURAL_BUS_RENDERER_H_
+#define BINAURAL_BUS_RENDERER_H_
+
+#include <vector>
+
+class HRTF;
+
+// Renders many mono sources through a fixed set of shared filters. Every
+// source is mixed into the renderer's buses with a few scalar gains, so the
+// cost of the binaural filtering does not depend on the number of sources.
+//
+// Per block, call AddSourceBlock() for every source and then ProcessBlock().
+class BinauralBusRenderer {
+ public:
+  BinauralBusRenderer(const HRTF& hrtf, int block_size);
+  virtual ~BinauralBusRenderer();
+
+  // Returns the id of a new, silent source.
+  virtual int AddSource() = 0;
+  virtual void SetSourceDirection(int source_id, float elevation_deg,
+                                  float azimuth_deg, float distance) = 0;
+
+  // Mixes an input block of |source_id| into the buses. Gain changes since
+  // the last block are ramped over the block.
+  virtual void AddSourceBlock(int source_id,
+                              const std::vector<float>& input) = 0;
+
+  // Filters the buses into the binaural output and clears them.
+  virtual void ProcessBlock(std::vector<float>* output_left,
+                            std::vector<float>* output_right) = 0;
+
+ protected:
+  // Conversion between {elevation, azimuth} directions (azimuth growing to
+  // the right) and unit vectors with x pointing to the front, y to the left
+  // and z up.
+  static void DirectionToVector(float elevation_deg, float azimuth_deg,
+                                float direction[3]);
+  static void VectorToDirection(const float direction[3],
+                                float* elevation_deg, float* azimuth_deg);
+
+  // Distance attenuation matching Audio3DSource.
+  float GetDistanceDamping(float distance) const;
+
+  // Adds |input| to |bus| with a gain moving linearly from |start_gain| to
+  // |end_gain| over the block.
+  void MixWithGainRamp(const std::vector<float>& input, float start_gain,
+                       float end_gain, std::vector<float>* bus) const;
+
+  const HRTF& hrtf_;
+  const int block_size_;
+};
+
+#endif  // BINAURAL_BUS_RENDERER_H_
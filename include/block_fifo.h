@@ -0,0 +1,49 @@
+#ifndef BLOCK_FIFO_H_
+#define BLOCK_FIFO_H_
+
+#include <vector>
+
+// Rebuffers host buffers of any size into the fixed block size of a
+// renderer. Input frames are collected until a block is complete while the
+// output of the previous block is played out, which delays the output by
+// exactly one block.
+class BlockFifo {
+ public:
+  class Processor {
+   public:
+    virtual ~Processor() {
+    }
+    // Renders one block of planar |input_channels| into |output_left| and
+    // |output_right|.
+    virtual void ProcessFifoBlock(const float* const* input_channels,
+                                  float* output_left,
+                                  float* output_right) = 0;
+  };
+
+  BlockFifo(int block_size, int num_input_channels);
+  virtual ~BlockFifo();
+
+  // Changing the number of input channels allocates and keeps the frames
+  // collected so far.
+  void SetNumInputChannels(int num_input_channels);
+  int GetNumInputChannels() const;
+
+  // Output delay in frames.
+  int GetLatency() const;
+
+  // Reads |num_frames| frames of GetNumInputChannels() interleaved channels
+  // from |input| and writes as many stereo frames with |output_stride|
+  // floats per frame. Calls |processor| for every completed block.
+  void Process(const float* input, int num_frames, Processor* processor,
+               float* output_left, float* output_right, int output_stride);
+
+ private:
+  const int block_size_;
+  int fifo_pos_;
+  std::vector<std::vector<float> > input_channels_;
+  std::vector<const float*> input_channel_pointers_;
+  std::vector<float> output_left_;
+  std::vector<float> output_right_;
+};
+
+#endif  // BLOCK_FIFO_H_
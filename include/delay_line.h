@@ -0,0 +1,69 @@
+#ifndef DELAY_LINE_H_
+#define DELAY_LINE_H_
+
+#include <vector>
+
+// Block-based delay line with fractional, linearly interpolated read taps.
+// Several taps can read the same signal block, e.g. one per ear.
+class DelayLine {
+ public:
+  DelayLine(int max_delay, int block_size);
+  virtual ~DelayLine();
+
+  void AddSignalBlock(const std::vector<float>& signal_block);
+  // Adds |block_size| samples at |signal_block|.
+  void AddSignalBlock(const float* signal_block);
+
+  // Reads the last signal block delayed by a delay that moves linearly from
+  // |start_delay| to |end_delay| samples over the block.
+  void GetResult(float start_delay, float end_delay,
+                 std::vector<float>* signal_block) const;
+
+  // Resets the delay line to silence.
+  void ClearSignalHistory();
+
+ private:
+  int max_delay_;
+  int block_size_;
+
+  // Last max_delay_+1 samples of the previous blocks followed by the current
+  // block.
+  std::vector<float> signal_buffer_;
+};
+
+// Delay line for long, continuously varying delays such as the propagation
+// delay of a moving source. Reads use third-order Lagrange interpolation and
+// the delay ramps linearly over every block, which produces the Doppler
+// shift of the moving source. The history is a ring buffer sized for
+// |max_delay_capacity| samples at construction; SetMaxDelay() only moves the
+// limit within that capacity and never allocates.
+class FractionalDelayLine {
+ public:
+  FractionalDelayLine(int max_delay_capacity, int block_size);
+  virtual ~FractionalDelayLine();
+
+  void SetMaxDelay(int max_delay);
+  int GetMaxDelay() const;
+  int GetMaxDelayCapacity() const;
+
+  // Writes one block of |input| and reads it into |output| delayed by a
+  // delay that ramps from the delay of the previous block to |delay|
+  // samples. The delay is clamped to [1, GetMaxDelay()]. |output| may alias
+  // |input|.
+  void Process(const float* input, float delay, float* output);
+
+ private:
+  const int block_size_;
+  const int max_delay_capacity_;
+  int max_delay_;
+  // Negative before the first block.
+  float previous_delay_;
+
+  // Ring buffer of a power of two size. Every sample is stored twice,
+  // |buffer_mask_| + 1 samples apart, so that interpolation taps never wrap.
+  std::vector<float> buffer_;
+  int buffer_mask_;
+  int write_pos_;
+};
+
+#endif  // DELAY_LINE_H_
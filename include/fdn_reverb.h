@@ -0,0 +1,57 @@
+#ifndef FDN_REVERB_H_
+#define FDN_REVERB_H_
+
+#include <vector>
+
+// Feedback delay network reverb. |num_lines| delay lines of mutually prime
+// lengths feed back through an orthogonal Hadamard matrix. Every line has a
+// first-order damping filter that sets separate decay times for low and
+// high frequencies. All lines are processed together in SIMD registers and
+// the cost per sample does not depend on the decay time.
+//
+// Drop-in alternative to Reberation for arbitrary long tails.
+class FDNReverb {
+ public:
+  // |num_lines| must be 8 or 16. Inputs hold at most |block_size| samples.
+  FDNReverb(int block_size, int sampling_rate, float reberation_time,
+            int num_lines);
+  virtual ~FDNReverb();
+
+  int GetNumLines() const;
+
+  // Sets the time to decay by 60 dB at DC and at the Nyquist frequency in
+  // seconds. Does not allocate and can be called while rendering.
+  void SetReberationTime(float low_reberation_time,
+                         float high_reberation_time);
+
+  // Feeds |input| and points |output_left| and |output_right| to the reverb
+  // output of the same length, valid until the next call.
+  void ProcessReberation(const std::vector<float>& input,
+                         const float** output_left,
+                         const float** output_right);
+
+  // Lengths of the delay lines in samples.
+  const std::vector<int>& GetDelays() const;
+
+ private:
+  const int block_size_;
+  const int sampling_rate_;
+  const int num_lines_;
+  std::vector<int> delays_;
+
+  // Ring buffer of frames holding one sample per line, a power of two
+  // frames long. A frame is written per sample with one vector store.
+  std::vector<float> buffer_;
+  int buffer_mask_;
+  int write_pos_;
+
+  // Damping filter y[n] = b0 * x[n] + a1 * y[n-1] per line.
+  std::vector<float> filter_b0_;
+  std::vector<float> filter_a1_;
+  std::vector<float> filter_state_;
+
+  std::vector<float> output_left_;
+  std::vector<float> output_right_;
+};
+
+#endif  // FDN_REVERB_H_
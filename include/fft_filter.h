@@ -1,6 +1,7 @@
 #ifndef FFT_FILTER_H_
 #define FFT_FILTER_H_
 
+#include <cstdint>
 #include <vector>
 
 using std::vector;
@@ -18,14 +19,28 @@ class FFTFilter {
   void SetFreqDomainKernel(const vector<float>& kernel);
   void AddFreqDomainKernel(const vector<float>& kernel);
 
+  // Keeps a half precision kernel (see half_float.h) and converts it while
+  // multiplying, halving the kernel memory traffic.
+  void SetFreqDomainKernel(const vector<uint16_t>& half_kernel);
+
+  // The transforms share scratch buffers and must not run concurrently on
+  // the same filter.
   void ForwardTransform(const vector<float>& time_signal,
                         vector<float>* freq_signal) const;
+  // Transforms |filter_len| samples at |time_signal|.
+  void ForwardTransform(const float* time_signal,
+                        vector<float>* freq_signal) const;
   void InverseTransform(const vector<float>& freq_signal,
                         vector<float>* time_signal) const;
 
   void AddSignalBlock(const vector<float>& signal_block);
+  // Adds |filter_len| samples at |signal_block|.
+  void AddSignalBlock(const float* signal_block);
 
   void GetResult(vector<float>* signal_block);
+
+  // Drops the overlap of the previous signal blocks, the kernel is kept.
+  void ClearSignalHistory();
  private:
   FFTFilterImpl* fft_filter_impl_;
 
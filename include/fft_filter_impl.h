@@ -1,5 +1,6 @@
 #ifndef FFT_FILTER_IMPL_H_
 #define FFT_FILTER_IMPL_H_
+#include <cstdint>
 #include <vector>
 
 #include "kiss_fftr.h"
@@ -16,25 +17,42 @@ class FFTFilterImpl {
 
   void SetFreqDomainKernel(const vector<float>& kernel);
   void AddFreqDomainKernel(const vector<float>& kernel);
+  void SetFreqDomainKernel(const vector<uint16_t>& half_kernel);
 
   void ForwardTransform(const vector<float>& time_signal,
                         vector<float>* freq_signal) const;
+  void ForwardTransform(const float* time_signal,
+                        vector<float>* freq_signal) const;
   void InverseTransform(const vector<float>& freq_signal,
                         vector<float>* time_signal) const;
 
   void AddSignalBlock(const vector<float>& signal_block);
+  void AddSignalBlock(const float* signal_block);
 
   void GetResult(vector<float>* signal_block);
 
+  void ClearSignalHistory();
+
  private:
   void Init();
 
+  // Transforms |size| samples, zero padded to the transform length.
+  void ForwardTransform(const float* time_signal, int size,
+                        vector<float>* freq_signal) const;
+
   void ComplexVectorProduct(const vector<kiss_fft_cpx>& input_a,
                             const vector<kiss_fft_cpx>& input_b,
                             vector<kiss_fft_cpx>* result) const;
 
+  void ComplexVectorProduct(const vector<kiss_fft_cpx>& input_a,
+                            const vector<uint16_t>& half_input_b,
+                            vector<kiss_fft_cpx>* result) const;
+  void ExpandHalfPrecisionKernel();
+
   void VectorCopyWithZeroPadding(const vector<kiss_fft_scalar>& input,
                                  vector<kiss_fft_scalar>* output) const;
+  void VectorCopyWithZeroPadding(const kiss_fft_scalar* input, int size,
+                                 vector<kiss_fft_scalar>* output) const;
 
   void InverseFFTScaling(vector<float>* signal) const;
 
@@ -47,6 +65,8 @@ class FFTFilterImpl {
   bool kernel_defined_;
   vector<kiss_fft_scalar> kernel_time_domain_buffer_;
   vector<kiss_fft_cpx> kernel_freq_domain_buffer_;
+  bool kernel_half_precision_;
+  vector<uint16_t> kernel_half_freq_domain_buffer_;
 
   int buffer_selector_;
   vector<vector<kiss_fft_scalar> > signal_time_domain_buffer_;
@@ -54,6 +74,10 @@ class FFTFilterImpl {
 
   vector<kiss_fft_cpx> filtered_freq_domain_buffer_;
 
+  // Scratch buffers of ForwardTransform() and InverseTransform().
+  mutable vector<kiss_fft_scalar> transform_time_domain_buffer_;
+  mutable vector<kiss_fft_cpx> transform_freq_domain_buffer_;
+
   kiss_fftr_cfg forward_fft_;
   kiss_fftr_cfg inverse_fft_;
 };
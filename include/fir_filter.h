@@ -0,0 +1,33 @@
+#ifndef FIR_FILTER_H_
+#define FIR_FILTER_H_
+
+#include <vector>
+
+// Direct-form FIR filter for short kernels. The kernel is passed per call so
+// that the same signal block can be filtered with several kernels, e.g. for
+// crossfading between HRTFs.
+class FIRFilter {
+ public:
+  FIRFilter(int max_kernel_len, int block_size);
+  virtual ~FIRFilter();
+
+  void AddSignalBlock(const std::vector<float>& signal_block);
+
+  // Convolves the last signal block with |kernel| taking the previous signal
+  // blocks into account.
+  void GetResult(const std::vector<float>& kernel,
+                 std::vector<float>* signal_block) const;
+
+  // Resets the filter to silence.
+  void ClearSignalHistory();
+
+ private:
+  int max_kernel_len_;
+  int block_size_;
+
+  // Last max_kernel_len_-1 samples of the previous blocks followed by the
+  // current block.
+  std::vector<float> signal_buffer_;
+};
+
+#endif  // FIR_FILTER_H_
@@ -52,7 +52,7 @@ class FLANNNeighborSearch {
 
   // Front center is at (0, 0)
   // elevation_deg range from -90 to 90, azimuth_deg range from -180 to 180
-  int FindNearestHRTF(float elevation_deg, float azimuth_deg) {
+  int FindNearestHRTF(float elevation_deg, float azimuth_deg) const {
     assert(flann_index_ && "FLANN index missing");
     // Flann query
     Point3D carthesian_point_on_unit_sphere;
@@ -78,7 +78,7 @@ class FLANNNeighborSearch {
 
  private:
   void GetPointOnUnitSphere(float elevation_deg, float azimuth_deg,
-                            Point3D* carthesian_point) {
+                            Point3D* carthesian_point) const {
     assert(carthesian_point);
 
     float elevation_rad = elevation_deg * M_PI / 180.0;
@@ -0,0 +1,23 @@
+#ifndef HALF_FLOAT_H_
+#define HALF_FLOAT_H_
+
+#include <cstdint>
+#include <vector>
+
+// Conversion between float32 and IEEE 754 half precision (binary16) stored
+// as uint16_t. Uses F16C instructions when compiled with -mf16c
+// (USE_F16C), otherwise a portable implementation with the same
+// round-to-nearest-even results.
+
+uint16_t ConvertFloatToHalf(float value);
+float ConvertHalfToFloat(uint16_t value);
+
+void ConvertFloatToHalf(const float* input, int size, uint16_t* output);
+void ConvertHalfToFloat(const uint16_t* input, int size, float* output);
+
+void ConvertFloatToHalf(const std::vector<float>& input,
+                        std::vector<uint16_t>* output);
+void ConvertHalfToFloat(const std::vector<uint16_t>& input,
+                        std::vector<float>* output);
+
+#endif  // HALF_FLOAT_H_
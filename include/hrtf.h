@@ -1,42 +1,128 @@
 #ifndef HRTF_LOOKUP_H_
 #define HRTF_LOOKUP_H_
 
+#include <cstdint>
 #include <memory>
 #include <utility>
 #include <vector>
 
 class FLANNNeighborSearch;
+class HRTFDataSource;
+class ParametricHRTF;
 
 class HRTF {
  public:
-  HRTF(int sample_rate, int block_size);
+  // Uses the compiled-in HRTF dataset. |num_threads| <= 0 builds the HRTF
+  // bank on all hardware cores.
+  HRTF(int sample_rate, int block_size, int num_threads = 0);
+  // Streams the HRTF bank from |data_source|, which is only accessed during
+  // construction.
+  HRTF(const HRTFDataSource& data_source, int sample_rate, int block_size,
+       int num_threads = 0);
   virtual ~HRTF();
 
+  // False if the library has no compiled-in dataset or reading the dataset
+  // failed. The HRTFs that could not be loaded are silent, so the object
+  // stays safe to use.
+  bool IsValid() const;
+
   bool SetDirection(float elevation_deg, float azimuth_deg);
   void GetDirection(float* elevation_deg, float* azimuth_deg) const;
 
+  // HRTFs of the current direction.
   const std::vector<float>& GetLeftEarTimeHRTF() const;
   const std::vector<float>& GetRightEarTimeHRTF() const;
 
   const std::vector<float>& GetLeftEarFreqHRTF() const;
   const std::vector<float>& GetRightEarFreqHRTF() const;
 
+  // Minimum-phase part of the current HRTFs, truncated to
+  // GetMinimumPhaseFilterSize() taps. Together with the per-ear onset delays
+  // (in samples) they approximate the full-length HRTFs.
+  const std::vector<float>& GetLeftEarMinimumPhaseHRTF() const;
+  const std::vector<float>& GetRightEarMinimumPhaseHRTF() const;
+  float GetLeftEarDelay() const;
+  float GetRightEarDelay() const;
+
+  // Bank entry of the current direction.
+  int GetHRTFIndex() const;
+  bool GetLeftRightSwap() const;
+
+  // Stateless access to the HRTF bank. The bank only covers the right
+  // hemisphere, directions on the left are rendered by swapping the ears.
+  int GetNumHRTFs() const;
+  void GetHRTFDirection(int hrtf_index, float* elevation_deg,
+                        float* azimuth_deg) const;
+  int FindHRTF(float elevation_deg, float azimuth_deg,
+               bool* left_right_swap) const;
+
+  const std::vector<float>& GetLeftEarTimeHRTF(int hrtf_index,
+                                               bool left_right_swap) const;
+  const std::vector<float>& GetRightEarTimeHRTF(int hrtf_index,
+                                                bool left_right_swap) const;
+  const std::vector<float>& GetLeftEarFreqHRTF(int hrtf_index,
+                                               bool left_right_swap) const;
+  const std::vector<float>& GetRightEarFreqHRTF(int hrtf_index,
+                                                bool left_right_swap) const;
+  // Decodes the frequency-domain HRTF regardless of the bank precision.
+  void GetLeftEarFreqHRTF(int hrtf_index, bool left_right_swap,
+                          std::vector<float>* kernel) const;
+  void GetRightEarFreqHRTF(int hrtf_index, bool left_right_swap,
+                           std::vector<float>* kernel) const;
+  const std::vector<float>& GetLeftEarMinimumPhaseHRTF(
+      int hrtf_index, bool left_right_swap) const;
+  const std::vector<float>& GetRightEarMinimumPhaseHRTF(
+      int hrtf_index, bool left_right_swap) const;
+  float GetLeftEarDelay(int hrtf_index, bool left_right_swap) const;
+  float GetRightEarDelay(int hrtf_index, bool left_right_swap) const;
+
+  // Parametric approximation of the bank. Built once with the bank and
+  // shared by all sources rendering from it.
+  const ParametricHRTF& GetParametricHRTF() const;
+
+  // Converts the frequency-domain bank to IEEE half precision, which halves
+  // its footprint and the traffic of kernel switches. Afterwards the float
+  // frequency-domain accessors are no longer valid.
+  void ConvertFreqDomainBankToHalfFloat();
+  bool IsFreqDomainBankHalfFloat() const;
+
+  const std::vector<uint16_t>& GetLeftEarHalfFloatFreqHRTF() const;
+  const std::vector<uint16_t>& GetRightEarHalfFloatFreqHRTF() const;
+  const std::vector<uint16_t>& GetLeftEarHalfFloatFreqHRTF(
+      int hrtf_index, bool left_right_swap) const;
+  const std::vector<uint16_t>& GetRightEarHalfFloatFreqHRTF(
+      int hrtf_index, bool left_right_swap) const;
+
   float GetDistance() const;
+  int GetSampleRate() const;
 
   int GetFilterSize() const;
+  int GetMinimumPhaseFilterSize() const;
 
  private:
-  static void ConvertShortToFloatVector(const short* input_ptr, int input_size,
-                                        std::vector<float>* output);
+  class BankBuildTask;
 
-  void ResampleHRTFs();
-  void FreqTransformHRTFs();
+  // Resamples all HRTFs to |sample_rate_| and transforms them into the
+  // frequency domain using |num_threads| workers. Returns false if any HRTF
+  // could not be read.
+  bool BuildHRTFBank(const HRTFDataSource& data_source, int num_threads);
   void InitNeighborSearch();
 
+  void Init(const HRTFDataSource& data_source, int num_threads);
+
   int sample_rate_;
   int block_size_;
+  bool valid_;
+
+  int num_hrtfs_;
+  float distance_;
+  std::vector<std::pair<int, int> > directions_;
 
   FLANNNeighborSearch* hrtf_nn_search_;
+  ParametricHRTF* parametric_hrtf_;
+  // Nearest HRTF per whole-degree {elevation, azimuth} of the right
+  // hemisphere, indexed (elevation + 90) * 181 + azimuth.
+  std::vector<int> nearest_hrtf_table_;
 
   int hrtf_index_;
   bool left_right_swap_;
@@ -45,11 +131,19 @@ class HRTF {
   float hrtf_azimuth_deg_;
 
   int filter_size_;
+  int min_phase_filter_size_;
 
   typedef std::vector<float> ResampledHRTFT;
   typedef std::pair<ResampledHRTFT, ResampledHRTFT> ResampledHRTFPairT;
   std::vector<ResampledHRTFPairT> hrtf_resampled_time_domain_;
   std::vector<ResampledHRTFPairT> hrtf_resampled_freq_domain_;
+  std::vector<ResampledHRTFPairT> hrtf_min_phase_time_domain_;
+
+  bool half_float_freq_domain_;
+  typedef std::vector<uint16_t> HalfFloatHRTFT;
+  std::vector<std::pair<HalfFloatHRTFT, HalfFloatHRTFT> >
+      hrtf_half_float_freq_domain_;
+  std::vector<std::pair<float, float> > hrtf_delays_;
 
 };
 
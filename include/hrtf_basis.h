@@ -0,0 +1,49 @@
+#ifndef HRTF_BASIS_H_
+#define HRTF_BASIS_H_
+
+#include <utility>
+#include <vector>
+
+class HRTF;
+
+// Approximates all minimum-phase HRTFs of a bank as weighted sums of a small
+// set of shared basis filters, the principal components of the bank:
+//
+//   hrtf ~= mean + sum_k weight_k * basis_k
+//
+// The interaural time delays are not part of the basis and have to be
+// applied separately (see HRTF::GetLeftEarDelay()).
+class HRTFBasis {
+ public:
+  HRTFBasis(const HRTF& hrtf, int num_basis_filters);
+  virtual ~HRTFBasis();
+
+  int GetNumBasisFilters() const;
+  int GetFilterSize() const;
+
+  const std::vector<float>& GetMeanFilter() const;
+  const std::vector<float>& GetBasisFilter(int basis_index) const;
+
+  // Basis weights of bank entry |hrtf_index|, see HRTF::FindHRTF().
+  const std::vector<float>& GetLeftEarWeights(int hrtf_index,
+                                              bool left_right_swap) const;
+  const std::vector<float>& GetRightEarWeights(int hrtf_index,
+                                               bool left_right_swap) const;
+
+  // Residual energy of the approximation relative to the energy of the
+  // mean-free HRTFs when using the first |num_basis_filters| components.
+  float GetApproximationError(int num_basis_filters) const;
+
+ private:
+  int filter_size_;
+  std::vector<float> mean_filter_;
+  std::vector<std::vector<float> > basis_filters_;
+
+  // Eigenvalues of the HRTF covariance matrix in descending order.
+  std::vector<double> eigenvalues_;
+
+  typedef std::vector<float> WeightsT;
+  std::vector<std::pair<WeightsT, WeightsT> > weights_;
+};
+
+#endif  // HRTF_BASIS_H_
@@ -1,6 +1,9 @@
 #ifndef HRTF_DATA_H_
 #define HRTF_DATA_H_
 
+// Compiled-in HRTF dataset. Only include this header from the translation
+// unit that wraps it into an HRTFDataSource (see hrtf_data_source.h).
+
 #include <string>
 
 #ifdef MIT_KEMAR
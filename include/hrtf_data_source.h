@@ -0,0 +1,102 @@
+#ifndef HRTF_DATA_SOURCE_H_
+#define HRTF_DATA_SOURCE_H_
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Provides HRTF measurements of a dataset. Only the metadata is held in
+// memory, the impulse responses are read on demand per direction so that
+// large datasets can be streamed into the HRTF bank.
+//
+// Directions follow the MIT KEMAR convention: {elevation, azimuth} pairs in
+// degrees covering the right hemisphere (azimuth 0 to 180). The left
+// hemisphere is obtained by swapping the ears.
+class HRTFDataSource {
+ public:
+  HRTFDataSource();
+  virtual ~HRTFDataSource();
+
+  const std::string& GetIdentifier() const;
+  int GetNumHRTFs() const;
+  int GetFIRLength() const;
+  int GetSampleRate() const;
+  float GetDistance() const;
+  void GetDirection(int index, int* elevation_deg, int* azimuth_deg) const;
+
+  // Reads the left and right ear impulse responses of HRTF |index|. Must be
+  // safe to call concurrently from multiple threads.
+  virtual bool ReadHRTF(int index, std::vector<float>* left,
+                        std::vector<float>* right) const = 0;
+
+  // Returns the compiled-in dataset or 0 if the library was built without
+  // one. The caller takes ownership.
+  static HRTFDataSource* CreateDefault();
+
+ protected:
+  static void ConvertShortToFloatVector(const short* input_ptr, int input_size,
+                                        std::vector<float>* output);
+
+  std::string identifier_;
+  int fir_length_;
+  int sample_rate_;
+  float distance_;
+  std::vector<std::pair<int, int> > directions_;
+};
+
+// Reads the elev*/H*e*a.wav directory tree of the MIT KEMAR "compact"
+// dataset. Every file holds a 16-bit stereo impulse response.
+class WavHRTFDataSource : public HRTFDataSource {
+ public:
+  WavHRTFDataSource();
+  virtual ~WavHRTFDataSource();
+
+  // Scans |directory| for HRTF files measured at |distance| meters.
+  bool Open(const std::string& directory, float distance);
+
+  virtual bool ReadHRTF(int index, std::vector<float>* left,
+                        std::vector<float>* right) const;
+
+ private:
+  // Reads the 16-bit stereo impulse response in |file_name|.
+  static bool ReadStereoWav(const std::string& file_name, int* sample_rate,
+                            std::vector<float>* left,
+                            std::vector<float>* right);
+
+  std::vector<std::string> file_names_;
+};
+
+// Compact binary HRTF dataset. Layout (little endian):
+//   char[4]  magic "HRTF"
+//   int32    version
+//   int32    identifier length, followed by the identifier characters
+//   int32    number of HRTFs
+//   int32    FIR length
+//   int32    sample rate
+//   float32  distance in meters
+//   int32    {elevation, azimuth} per HRTF
+//   int16    left and right FIR per HRTF
+// The file stays open while the data source exists and is read with
+// positioned reads, which are safe to issue from several threads.
+class BinaryHRTFDataSource : public HRTFDataSource {
+ public:
+  BinaryHRTFDataSource();
+  virtual ~BinaryHRTFDataSource();
+
+  bool Open(const std::string& file_name);
+
+  virtual bool ReadHRTF(int index, std::vector<float>* left,
+                        std::vector<float>* right) const;
+
+  // Streams |data_source| into a binary dataset file, one HRTF at a time.
+  static bool Write(const HRTFDataSource& data_source,
+                    const std::string& file_name);
+
+ private:
+  std::string file_name_;
+  int file_descriptor_;
+  long data_offset_;
+};
+
+#endif  // HRTF_DATA_SOURCE_H_
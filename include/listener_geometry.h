@@ -0,0 +1,26 @@
+#ifndef LISTENER_GEOMETRY_H_
+#define LISTENER_GEOMETRY_H_
+
+// Cartesian coordinates in meters with x pointing to the right, y to the
+// front and z up when the listener is in its default orientation. Azimuth is
+// measured clockwise from the front (positive to the right), elevation
+// upwards from the horizontal plane, as for Audio3DSource::SetDirection().
+struct ListenerPose {
+  ListenerPose();
+
+  float position[3];
+  // Unit quaternion {w, x, y, z} rotating the listener's default orientation
+  // into its current one.
+  float orientation[4];
+};
+
+// Converts |num_positions| world positions given as separate x, y and z
+// arrays into listener-relative elevation and azimuth in degrees and the
+// distance in meters. Works on four positions at a time with SSE when
+// available. The angles are accurate to about 0.001 degrees.
+void TransformToSpherical(const ListenerPose& listener, const float* x,
+                          const float* y, const float* z, int num_positions,
+                          float* elevation_deg, float* azimuth_deg,
+                          float* distance);
+
+#endif  // LISTENER_GEOMETRY_H_
@@ -0,0 +1,35 @@
+#ifndef OUTPUT_STAGE_H_
+#define OUTPUT_STAGE_H_
+
+// Final stage of a binaural renderer, fused into a single pass over the
+// block:
+//
+//   output = (previous + fade_in * (next - previous)) * gain + reverb
+//
+// The crossfade window must sum to one with its time reverse (e.g. a sin^2
+// window), so that fade_in * next + (1 - fade_in) * previous matches a
+// fade-out with the reversed window. |gain| ramps linearly from
+// |start_gain| towards |end_gain| and reaches it with the last frame.
+// Uses SSE when available.
+struct OutputStageInput {
+  const float* next_left;
+  const float* next_right;
+  // Block faded out, 0 without crossfade.
+  const float* previous_left;
+  const float* previous_right;
+  const float* fade_in_window;
+  // Added after the gain, usually the reverb. 0 if unused.
+  const float* reverb_left;
+  const float* reverb_right;
+  float start_gain;
+  float end_gain;
+};
+
+// Writes |num_frames| frames to |output_left| and |output_right|, advancing
+// both by |output_stride| floats per frame. Interleaved stereo output uses
+// output_right = output_left + 1 and a stride of 2.
+void RenderOutputStage(const OutputStageInput& input, int num_frames,
+                       float* output_left, float* output_right,
+                       int output_stride);
+
+#endif  // OUTPUT_STAGE_H_
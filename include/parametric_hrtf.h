@@ -0,0 +1,34 @@
+#ifndef PARAMETRIC_HRTF_H_
+#define PARAMETRIC_HRTF_H_
+
+#include <utility>
+#include <vector>
+
+class HRTF;
+
+// Parametric approximation of the HRTF bank for cheap spatialization: per
+// ear the onset delay of the bank (see HRTF::GetLeftEarDelay()), a broadband
+// gain and a one-pole lowpass modelling the head shadow,
+//
+//   y[n] = gain * ((1 - a) * x[n] + a * y'[n - 1]).
+class ParametricHRTF {
+ public:
+  struct EarParameters {
+    float gain;
+    float shadow_coefficient;
+  };
+
+  explicit ParametricHRTF(const HRTF& hrtf);
+  virtual ~ParametricHRTF();
+
+  // Parameters of bank entry |hrtf_index|, see HRTF::FindHRTF().
+  const EarParameters& GetLeftEarParameters(int hrtf_index,
+                                            bool left_right_swap) const;
+  const EarParameters& GetRightEarParameters(int hrtf_index,
+                                             bool left_right_swap) const;
+
+ private:
+  std::vector<std::pair<EarParameters, EarParameters> > parameters_;
+};
+
+#endif  // PARAMETRIC_HRTF_H_
@@ -6,11 +6,18 @@ class FFTFilter;
 class Reberation {
  public:
   Reberation(int block_size, int sampling_rate, float reberation_time);
+  virtual ~Reberation();
   float GetQuietPeriod() const;
 
   void AddReberation(const std::vector<float>& input,
                      std::vector<float>* output_left,
                      std::vector<float>* output_right);
+  // Feeds |input| and points |output_left| and |output_right| to the reverb
+  // output of the same length, valid until the next call. The input size
+  // must divide the reverb block size.
+  void ProcessReberation(const std::vector<float>& input,
+                         const float** output_left,
+                         const float** output_right);
 
   const std::vector<float>& GetImpulseResponseLeft() const;
   const std::vector<float>& GetImpulseResponseRight() const;
@@ -0,0 +1,88 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+ public:
+  class Task {
+   public:
+    virtual ~Task() {
+    }
+    // Processes item |task_index| on worker |worker_index|. Worker indices
+    // range from 0 to GetNumWorkers()-1 and can be used to address
+    // per-worker state.
+    virtual void Run(int task_index, int worker_index) = 0;
+  };
+
+  // Timing of the last ParallelFor() call.
+  struct Stats {
+    // Time from the start of ParallelFor() until all items were processed.
+    double wall_seconds;
+    // Time spent in Task::Run() summed over all workers.
+    double task_seconds;
+    // Number of item ranges taken from other workers.
+    int num_steals;
+  };
+
+  // |num_workers| <= 0 selects the number of hardware cores. The calling
+  // thread of ParallelFor acts as worker 0.
+  explicit ThreadPool(int num_workers);
+  virtual ~ThreadPool();
+
+  int GetNumWorkers() const;
+
+  // Tries to switch the worker threads to realtime (SCHED_FIFO) scheduling.
+  // Returns false if the system does not permit it; the workers then keep
+  // running with normal priority.
+  bool SetRealtimePriority();
+
+  // Runs task->Run() for all items in [0, num_tasks) and blocks until all of
+  // them are processed. Every worker starts on a contiguous range of items
+  // and, once its range is exhausted, steals half of the remaining items of
+  // another worker. With a single worker no lock is taken. Otherwise the
+  // lock is only held to wake the workers, the caller waits for them by
+  // spinning on an atomic counter and then yielding.
+  void ParallelFor(int num_tasks, Task* task);
+
+  // Scheduler overhead of the last ParallelFor() is approximately
+  // wall_seconds - task_seconds / GetNumWorkers().
+  const Stats& GetLastStats() const;
+
+ private:
+  // Item range [begin, end) of a worker packed as begin << 32 | end. The
+  // owner pops items from the front, thieves take the back half.
+  struct WorkerState {
+    std::atomic<unsigned long long> range;
+    double task_seconds;
+    int num_steals;
+    // Keeps the states of different workers on separate cache lines.
+    char padding[64];
+  };
+
+  void WorkerLoop(int worker_index);
+  void RunTasks(int worker_index);
+  int PopTask(int worker_index);
+  int StealTasks(int worker_index);
+
+  int num_workers_;
+  std::vector<std::thread> threads_;
+  WorkerState* worker_states_;
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+
+  Task* task_;
+  int generation_;
+  // Workers that have not finished the current ParallelFor().
+  std::atomic<int> pending_workers_;
+  bool shutdown_;
+
+  Stats stats_;
+};
+
+#endif  // THREAD_POOL_H_
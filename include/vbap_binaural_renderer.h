@@ -0,0 +1,72 @@
+#ifndef VBAP_BINAURAL_RENDERER_H_
+#define VBAP_BINAURAL_RENDERER_H_
+
+#include <vector>
+
+#include "binaural_bus_renderer.h"
+
+class FFTFilter;
+
+// Amplitude-pans sources onto a fixed layout of virtual loudspeakers with
+// vector base amplitude panning (VBAP). Every loudspeaker is convolved once
+// with its static HRTF pair, so a source costs at most three ramped gains
+// and never switches filter kernels.
+class VBAPBinauralRenderer : public BinauralBusRenderer {
+ public:
+  enum Layout {
+    // Eight loudspeakers in the horizontal plane. Elevation is ignored.
+    kRing,
+    // 21 loudspeakers in rings at -40, 0 and 40 degrees elevation plus one
+    // at the zenith.
+    kDome
+  };
+
+  VBAPBinauralRenderer(const HRTF& hrtf, Layout layout, int block_size);
+  virtual ~VBAPBinauralRenderer();
+
+  int GetNumSpeakers() const;
+
+  // Power normalized panning gains of a direction.
+  void GetSpeakerGains(float elevation_deg, float azimuth_deg,
+                       std::vector<float>* gains) const;
+
+  virtual int AddSource();
+  virtual void SetSourceDirection(int source_id, float elevation_deg,
+                                  float azimuth_deg, float distance);
+  virtual void AddSourceBlock(int source_id, const std::vector<float>& input);
+  virtual void ProcessBlock(std::vector<float>* output_left,
+                            std::vector<float>* output_right);
+
+ private:
+  struct Source {
+    std::vector<float> gains;
+    std::vector<float> target_gains;
+  };
+
+  struct Triangle {
+    int speakers[3];
+    // Inverse of the matrix with the speaker directions as rows.
+    float inverse_base[3][3];
+  };
+
+  void AddSpeakerRing(float elevation_deg, int num_speakers,
+                      float azimuth_offset_deg);
+  void Triangulate();
+
+  int num_speakers_;
+  // Speakers 0 to lowest_ring_size_ - 1 form the lowest ring.
+  int lowest_ring_size_;
+  // Unit vectors of all loudspeakers. Entries from num_speakers_ on are
+  // imaginary loudspeakers closing the lowest ring; their gains are spread
+  // evenly over that ring.
+  std::vector<std::vector<float> > speaker_directions_;
+  std::vector<Triangle> triangles_;
+
+  std::vector<Source> sources_;
+  std::vector<std::vector<float> > buses_;
+
+  std::vector<FFTFilter*> speaker_filters_[2];
+  std::vector<float> filtered_bus_;
+};
+
+#endif  // VBAP_BINAURAL_RENDERER_H_
@@ -0,0 +1,108 @@
+#ifndef WAV_FILE_H_
+#define WAV_FILE_H_
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Memory-maps a RIFF/WAVE file with 16 or 24-bit integer or 32-bit float
+// PCM samples and converts frames on demand, so that inputs of any length
+// are read without holding them in memory.
+class WavReader {
+ public:
+  WavReader();
+  virtual ~WavReader();
+
+  bool Open(const std::string& file_name);
+  void Close();
+
+  int GetSampleRate() const;
+  int GetNumChannels() const;
+  int GetNumFrames() const;
+
+  // Converts |num_frames| frames of |channel| starting at |frame| to floats
+  // in [-1, 1]. Frames beyond the end of the file read as zero.
+  void ReadChannel(int channel, int frame, int num_frames,
+                   float* output) const;
+  // Reads |num_frames| interleaved frames of all channels.
+  void ReadFrames(int frame, int num_frames, float* output) const;
+  // Drops the mapped pages of all frames before |frame| from memory. They
+  // are mapped again if read later. Keeps the memory use of sequential
+  // reads constant.
+  void ReleaseFrames(int frame);
+
+ private:
+  bool ParseHeader();
+
+  unsigned char* map_;
+  size_t map_size_;
+  size_t released_size_;
+  const unsigned char* data_;
+  int audio_format_;
+  int bytes_per_sample_;
+  int sample_rate_;
+  int num_channels_;
+  int num_frames_;
+};
+
+// Writes a 32-bit float RIFF/WAVE file incrementally. Write() copies the
+// frames into one of a fixed number of buffers which a writer thread
+// encodes and writes to disk, so memory use does not grow with the length
+// of the file. Write() blocks while all buffers are queued.
+class WavWriter {
+ public:
+  // |num_buffers| buffers of |frames_per_buffer| frames each.
+  WavWriter(int frames_per_buffer, int num_buffers);
+  virtual ~WavWriter();
+
+  bool Open(const std::string& file_name, int sample_rate, int num_channels);
+  // Appends |num_frames| interleaved frames. Returns false once writing
+  // failed.
+  bool Write(const float* frames, int num_frames);
+  // Flushes the queued frames, completes the header and closes the file.
+  bool Close();
+
+ private:
+  void QueueBuffer();
+  void WriterLoop();
+
+  int frames_per_buffer_;
+  int sample_rate_;
+  int num_channels_;
+  std::string file_name_;
+  std::FILE* file_;
+
+  std::vector<std::vector<float> > buffers_;
+  // Buffer being filled by Write(), -1 if none.
+  int fill_buffer_;
+  int fill_size_;
+  long long num_samples_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable queue_cv_;
+  std::condition_variable free_cv_;
+  // Indices of full buffers in write order and of free buffers, with the
+  // number of valid samples of every queued buffer.
+  std::deque<std::pair<int, int> > queue_;
+  std::vector<int> free_buffers_;
+  bool closing_;
+  bool write_failed_;
+};
+
+// Reads all frames of a WAV file supported by WavReader into |samples|
+// with |num_channels| interleaved channels.
+bool ReadWavFile(const std::string& file_name, int* sample_rate,
+                 int* num_channels, std::vector<float>* samples);
+
+// Writes |samples|, |num_channels| interleaved channels, as a 32-bit float
+// RIFF/WAVE file.
+bool WriteWavFile(const std::string& file_name, int sample_rate,
+                  int num_channels, const std::vector<float>& samples);
+
+#endif  // WAV_FILE_H_
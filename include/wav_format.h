@@ -0,0 +1,44 @@
+#ifndef WAV_FORMAT_H_
+#define WAV_FORMAT_H_
+
+#include <cstddef>
+
+// Little-endian sample coding and RIFF/WAVE header parsing shared by the
+// WAV file reader and writer and the HRTF data sources.
+
+const int kWavFormatPCM = 1;
+const int kWavFormatFloat = 3;
+const int kWavFormatExtensible = 0xFFFE;
+
+// Decodes signed integers of 16, 24 and 32 bits.
+int DecodeLE16(const unsigned char* data);
+int DecodeLE24(const unsigned char* data);
+int DecodeLE32(const unsigned char* data);
+
+void EncodeLE16(int value, unsigned char* data);
+void EncodeLE32(int value, unsigned char* data);
+
+// 16-bit PCM samples are scaled by 1/32768, so that -32768 maps to -1.
+// Encoding rounds and saturates at 32767.
+float PCM16ToFloat(int value);
+int FloatToPCM16(float value);
+
+struct WavFormat {
+  // kWavFormatPCM or kWavFormatFloat for files in the extensible format.
+  int audio_format;
+  int num_channels;
+  int sample_rate;
+  int bits_per_sample;
+  // Position of the samples and size of the data chunk as claimed by its
+  // header, which can exceed the bytes actually present.
+  size_t data_offset;
+  size_t data_size;
+};
+
+// Walks the chunks of the RIFF/WAVE file of |size| bytes at |data| up to
+// the data chunk. Returns false if the file is malformed or no format chunk
+// precedes the data chunk. The sample format is not checked.
+bool ParseWavHeader(const unsigned char* data, size_t size,
+                    WavFormat* format);
+
+#endif  // WAV_FORMAT_H_
@@ -0,0 +1,359 @@
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+
+#include "ambisonic_binaural_renderer.h"
+#include "fft_filter.h"
+#include "hrtf.h"
+
+namespace {
+
+const int kNumRotationSamples = 64;
+
+// Nearly uniform distribution of |num_points| unit vectors.
+void GetFibonacciSphere(int num_points,
+                        std::vector<std::vector<float> >* points) {
+  const double golden_angle = M_PI * (3.0 - sqrt(5.0));
+  points->resize(num_points);
+  for (int i = 0; i < num_points; ++i) {
+    double z = 1.0 - (2.0 * i + 1.0) / num_points;
+    double radius = sqrt(1.0 - z * z);
+    (*points)[i].resize(3);
+    (*points)[i][0] = radius * cos(golden_angle * i);
+    (*points)[i][1] = radius * sin(golden_angle * i);
+    (*points)[i][2] = z;
+  }
+}
+
+// Gauss-Jordan inversion of the size x size row major |matrix| in place.
+void InvertMatrix(int size, std::vector<double>* matrix) {
+  std::vector<double>& a = *matrix;
+  std::vector<double> inverse(size * size, 0.0);
+  for (int i = 0; i < size; ++i) {
+    inverse[i * size + i] = 1.0;
+  }
+  for (int col = 0; col < size; ++col) {
+    int pivot = col;
+    for (int row = col + 1; row < size; ++row) {
+      if (fabs(a[row * size + col]) > fabs(a[pivot * size + col])) {
+        pivot = row;
+      }
+    }
+    assert(fabs(a[pivot * size + col]) > 1e-12);
+    for (int k = 0; k < size; ++k) {
+      std::swap(a[col * size + k], a[pivot * size + k]);
+      std::swap(inverse[col * size + k], inverse[pivot * size + k]);
+    }
+    double scale = 1.0 / a[col * size + col];
+    for (int k = 0; k < size; ++k) {
+      a[col * size + k] *= scale;
+      inverse[col * size + k] *= scale;
+    }
+    for (int row = 0; row < size; ++row) {
+      double factor = a[row * size + col];
+      if (row == col || factor == 0.0) {
+        continue;
+      }
+      for (int k = 0; k < size; ++k) {
+        a[row * size + k] -= factor * a[col * size + k];
+        inverse[row * size + k] -= factor * inverse[col * size + k];
+      }
+    }
+  }
+  a.swap(inverse);
+}
+
+}  // namespace
+
+AmbisonicBinauralRenderer::AmbisonicBinauralRenderer(const HRTF& hrtf,
+                                                     int order,
+                                                     int block_size)
+    : BinauralBusRenderer(hrtf, block_size),
+      order_(order),
+      num_channels_((order + 1) * (order + 1)),
+      rotation_is_identity_(true) {
+  assert(order_ >= 1 && order_ <= 3);
+  bus_.assign(num_channels_, std::vector<float>(block_size_, 0.0f));
+  rotated_bus_ = bus_;
+  prev_rotated_bus_ = bus_;
+
+  xfade_window_.resize(block_size_);
+  for (int i = 0; i < block_size_; ++i) {
+    xfade_window_[i] = static_cast<float>(i + 1) / block_size_;
+  }
+
+  InitRotation();
+  InitDecoder();
+}
+
+AmbisonicBinauralRenderer::~AmbisonicBinauralRenderer() {
+  for (int ear = 0; ear < 2; ++ear) {
+    for (int i = 0; i < channel_filters_[ear].size(); ++i) {
+      delete channel_filters_[ear][i];
+    }
+  }
+}
+
+int AmbisonicBinauralRenderer::GetOrder() const {
+  return order_;
+}
+
+int AmbisonicBinauralRenderer::GetNumChannels() const {
+  return num_channels_;
+}
+
+void AmbisonicBinauralRenderer::EncodeDirection(
+    const float direction[3], std::vector<float>* coefficients) const {
+  float x = direction[0];
+  float y = direction[1];
+  float z = direction[2];
+  std::vector<float>& c = *coefficients;
+  c.resize(num_channels_);
+  c[0] = 1.0f;
+  c[1] = sqrt(3.0f) * y;
+  c[2] = sqrt(3.0f) * z;
+  c[3] = sqrt(3.0f) * x;
+  if (order_ < 2) {
+    return;
+  }
+  c[4] = sqrt(15.0f) * x * y;
+  c[5] = sqrt(15.0f) * y * z;
+  c[6] = sqrt(5.0f) / 2.0f * (3.0f * z * z - 1.0f);
+  c[7] = sqrt(15.0f) * x * z;
+  c[8] = sqrt(15.0f) / 2.0f * (x * x - y * y);
+  if (order_ < 3) {
+    return;
+  }
+  c[9] = sqrt(35.0f / 8.0f) * y * (3.0f * x * x - y * y);
+  c[10] = sqrt(105.0f) * x * y * z;
+  c[11] = sqrt(21.0f / 8.0f) * y * (5.0f * z * z - 1.0f);
+  c[12] = sqrt(7.0f) / 2.0f * z * (5.0f * z * z - 3.0f);
+  c[13] = sqrt(21.0f / 8.0f) * x * (5.0f * z * z - 1.0f);
+  c[14] = sqrt(105.0f) / 2.0f * z * (x * x - y * y);
+  c[15] = sqrt(35.0f / 8.0f) * x * (x * x - 3.0f * y * y);
+}
+
+void AmbisonicBinauralRenderer::InitRotation() {
+  GetFibonacciSphere(kNumRotationSamples, &rotation_samples_);
+
+  // rotation_projection_ = A^T (A A^T)^-1 with the sample harmonics as the
+  // columns of A, so that R = B * rotation_projection_ for the harmonics B
+  // of the rotated samples.
+  std::vector<std::vector<float> > harmonics(kNumRotationSamples);
+  for (int i = 0; i < kNumRotationSamples; ++i) {
+    EncodeDirection(&rotation_samples_[i][0], &harmonics[i]);
+  }
+  std::vector<double> gram(num_channels_ * num_channels_, 0.0);
+  for (int i = 0; i < kNumRotationSamples; ++i) {
+    for (int j = 0; j < num_channels_; ++j) {
+      for (int k = 0; k < num_channels_; ++k) {
+        gram[j * num_channels_ + k] += harmonics[i][j] * harmonics[i][k];
+      }
+    }
+  }
+  InvertMatrix(num_channels_, &gram);
+
+  rotation_projection_.assign(kNumRotationSamples * num_channels_, 0.0);
+  for (int i = 0; i < kNumRotationSamples; ++i) {
+    for (int k = 0; k < num_channels_; ++k) {
+      double sum = 0.0;
+      for (int j = 0; j < num_channels_; ++j) {
+        sum += harmonics[i][j] * gram[j * num_channels_ + k];
+      }
+      rotation_projection_[i * num_channels_ + k] = sum;
+    }
+  }
+
+  rotation_.assign(num_channels_ * num_channels_, 0.0);
+  for (int i = 0; i < num_channels_; ++i) {
+    rotation_[i * num_channels_ + i] = 1.0;
+  }
+  target_rotation_ = rotation_;
+}
+
+void AmbisonicBinauralRenderer::InitDecoder() {
+  // Sampling decoder with max-rE weighting over a uniform virtual speaker
+  // layout. The decoder gains are folded into the speaker HRTFs.
+  int num_speakers = 2 * num_channels_;
+  std::vector<std::vector<float> > speakers;
+  GetFibonacciSphere(num_speakers, &speakers);
+
+  float cos_max_re = cos(137.9 * M_PI / 180.0 / (order_ + 1.51));
+  float order_weights[4] = { 1.0f, cos_max_re, (3.0f * cos_max_re
+      * cos_max_re - 1.0f) / 2.0f, (5.0f * cos_max_re * cos_max_re
+      * cos_max_re - 3.0f * cos_max_re) / 2.0f };
+
+  int filter_size = hrtf_.GetFilterSize();
+  std::vector<std::vector<float> > kernels[2];
+  for (int ear = 0; ear < 2; ++ear) {
+    kernels[ear].assign(num_channels_, std::vector<float>(filter_size, 0.0f));
+  }
+
+  std::vector<float> harmonics;
+  for (int s = 0; s < num_speakers; ++s) {
+    EncodeDirection(&speakers[s][0], &harmonics);
+    float elevation_deg;
+    float azimuth_deg;
+    VectorToDirection(&speakers[s][0], &elevation_deg, &azimuth_deg);
+    bool left_right_swap;
+    int hrtf_index = hrtf_.FindHRTF(elevation_deg, azimuth_deg,
+                                    &left_right_swap);
+    const std::vector<float>* speaker_hrtf[2] = {
+        &hrtf_.GetLeftEarTimeHRTF(hrtf_index, left_right_swap),
+        &hrtf_.GetRightEarTimeHRTF(hrtf_index, left_right_swap) };
+
+    int channel = 0;
+    for (int n = 0; n <= order_; ++n) {
+      for (int m = -n; m <= n; ++m, ++channel) {
+        float gain = order_weights[n] * harmonics[channel] / num_speakers;
+        for (int ear = 0; ear < 2; ++ear) {
+          for (int i = 0; i < filter_size; ++i) {
+            kernels[ear][channel][i] += gain * (*speaker_hrtf[ear])[i];
+          }
+        }
+      }
+    }
+  }
+
+  for (int ear = 0; ear < 2; ++ear) {
+    for (int channel = 0; channel < num_channels_; ++channel) {
+      FFTFilter* filter = new FFTFilter(block_size_);
+      filter->SetTimeDomainKernel(kernels[ear][channel]);
+      channel_filters_[ear].push_back(filter);
+    }
+  }
+}
+
+void AmbisonicBinauralRenderer::SetHeadRotation(float yaw_deg,
+                                                float pitch_deg,
+                                                float roll_deg) {
+  double yaw = -yaw_deg * M_PI / 180.0;
+  double pitch = -pitch_deg * M_PI / 180.0;
+  double roll = roll_deg * M_PI / 180.0;
+
+  // Head to world rotation Rz(yaw) * Ry(pitch) * Rx(roll).
+  double cy = cos(yaw), sy = sin(yaw);
+  double cp = cos(pitch), sp = sin(pitch);
+  double cr = cos(roll), sr = sin(roll);
+  double head[3][3] = {
+      { cy * cp, cy * sp * sr - sy * cr, cy * sp * cr + sy * sr },
+      { sy * cp, sy * sp * sr + cy * cr, sy * sp * cr - cy * sr },
+      { -sp, cp * sr, cp * cr } };
+
+  // Harmonics of the sample directions as seen from the rotated head.
+  std::vector<std::vector<float> > rotated_harmonics(kNumRotationSamples);
+  for (int i = 0; i < kNumRotationSamples; ++i) {
+    float rotated[3];
+    for (int j = 0; j < 3; ++j) {
+      rotated[j] = head[0][j] * rotation_samples_[i][0]
+          + head[1][j] * rotation_samples_[i][1]
+          + head[2][j] * rotation_samples_[i][2];
+    }
+    EncodeDirection(rotated, &rotated_harmonics[i]);
+  }
+
+  rotation_is_identity_ = (yaw_deg == 0.0f && pitch_deg == 0.0f
+      && roll_deg == 0.0f);
+  for (int j = 0; j < num_channels_; ++j) {
+    for (int k = 0; k < num_channels_; ++k) {
+      double sum = 0.0;
+      for (int i = 0; i < kNumRotationSamples; ++i) {
+        sum += rotated_harmonics[i][j]
+            * rotation_projection_[i * num_channels_ + k];
+      }
+      target_rotation_[j * num_channels_ + k] = sum;
+    }
+  }
+}
+
+int AmbisonicBinauralRenderer::AddSource() {
+  Source source;
+  source.gains.assign(num_channels_, 0.0f);
+  source.target_gains.assign(num_channels_, 0.0f);
+  sources_.push_back(source);
+  return sources_.size() - 1;
+}
+
+void AmbisonicBinauralRenderer::SetSourceDirection(int source_id,
+                                                   float elevation_deg,
+                                                   float azimuth_deg,
+                                                   float distance) {
+  assert(source_id >= 0 && source_id < sources_.size());
+  Source& source = sources_[source_id];
+  float direction[3];
+  DirectionToVector(elevation_deg, azimuth_deg, direction);
+  EncodeDirection(direction, &source.target_gains);
+  float damping = GetDistanceDamping(distance);
+  for (int i = 0; i < num_channels_; ++i) {
+    source.target_gains[i] *= damping;
+  }
+}
+
+void AmbisonicBinauralRenderer::AddSourceBlock(
+    int source_id, const std::vector<float>& input) {
+  assert(source_id >= 0 && source_id < sources_.size());
+  Source& source = sources_[source_id];
+  for (int i = 0; i < num_channels_; ++i) {
+    MixWithGainRamp(input, source.gains[i], source.target_gains[i],
+                    &bus_[i]);
+    source.gains[i] = source.target_gains[i];
+  }
+}
+
+void AmbisonicBinauralRenderer::RotateBus(
+    const std::vector<double>& rotation,
+    std::vector<std::vector<float> >* rotated_bus) const {
+  for (int j = 0; j < num_channels_; ++j) {
+    std::vector<float>& out = (*rotated_bus)[j];
+    out.assign(block_size_, 0.0f);
+    for (int k = 0; k < num_channels_; ++k) {
+      float gain = rotation[j * num_channels_ + k];
+      if (fabs(gain) < 1e-6f) {
+        continue;
+      }
+      const std::vector<float>& in = bus_[k];
+      for (int i = 0; i < block_size_; ++i) {
+        out[i] += gain * in[i];
+      }
+    }
+  }
+}
+
+void AmbisonicBinauralRenderer::ProcessBlock(
+    std::vector<float>* output_left, std::vector<float>* output_right) {
+  assert(output_left && output_right);
+
+  const std::vector<std::vector<float> >* decoder_input = &bus_;
+  if (rotation_ != target_rotation_) {
+    RotateBus(rotation_, &prev_rotated_bus_);
+    RotateBus(target_rotation_, &rotated_bus_);
+    for (int j = 0; j < num_channels_; ++j) {
+      for (int i = 0; i < block_size_; ++i) {
+        rotated_bus_[j][i] = prev_rotated_bus_[j][i] + xfade_window_[i]
+            * (rotated_bus_[j][i] - prev_rotated_bus_[j][i]);
+      }
+    }
+    rotation_ = target_rotation_;
+    decoder_input = &rotated_bus_;
+  } else if (!rotation_is_identity_) {
+    RotateBus(rotation_, &rotated_bus_);
+    decoder_input = &rotated_bus_;
+  }
+
+  std::vector<float>* outputs[2] = { output_left, output_right };
+  for (int ear = 0; ear < 2; ++ear) {
+    outputs[ear]->assign(block_size_, 0.0f);
+    for (int channel = 0; channel < num_channels_; ++channel) {
+      FFTFilter* filter = channel_filters_[ear][channel];
+      filter->AddSignalBlock((*decoder_input)[channel]);
+      filter->GetResult(&filtered_channel_);
+      for (int i = 0; i < block_size_; ++i) {
+        (*outputs[ear])[i] += filtered_channel_[i];
+      }
+    }
+  }
+
+  for (int j = 0; j < num_channels_; ++j) {
+    bus_[j].assign(block_size_, 0.0f);
+  }
+}
@@ -1,30 +1,152 @@
+#include <algorithm>
 #include <cmath>
 #include <assert.h>
 #include "audio_3d.h"
+#include "block_fifo.h"
+#include "delay_line.h"
 #include "hrtf.h"
+#include "listener_geometry.h"
+#include "parametric_hrtf.h"
 #include "fft_filter.h"
+#include "fir_filter.h"
+#include "half_float.h"
+#include "output_stage.h"
 #include "reberation.h"
 
+namespace {
+
+// Meters per second.
+const float kSpeedOfSound = 343.0f;
+
+}  // namespace
+
+class Audio3DSource::FifoProcessor : public BlockFifo::Processor {
+ public:
+  explicit FifoProcessor(Audio3DSource* source)
+      : source_(source),
+        num_input_channels_(1) {
+  }
+  virtual ~FifoProcessor() {
+  }
+
+  virtual void ProcessFifoBlock(const float* const* input_channels,
+                                float* output_left, float* output_right) {
+    source_->ProcessBlock(input_channels, num_input_channels_, output_left,
+                          output_right, 1);
+  }
+
+  void SetNumInputChannels(int num_input_channels) {
+    num_input_channels_ = num_input_channels;
+  }
+
+ private:
+  Audio3DSource* source_;
+  int num_input_channels_;
+};
+
 Audio3DSource::Audio3DSource(int sample_rate, int block_size)
-    : sample_rate_(sample_rate),
+    : Audio3DSource(new HRTF(sample_rate, block_size), block_size) {
+}
+
+Audio3DSource::Audio3DSource(const HRTFDataSource& hrtf_data_source,
+                             int sample_rate, int block_size)
+    : Audio3DSource(new HRTF(hrtf_data_source, sample_rate, block_size),
+                    block_size) {
+}
+
+Audio3DSource::Audio3DSource(HRTF* owned_hrtf, int block_size)
+    : Audio3DSource(*owned_hrtf, block_size) {
+  owned_hrtf_ = owned_hrtf;
+  InitReberation();
+}
+
+Audio3DSource::Audio3DSource(const HRTF& hrtf, int block_size)
+    : sample_rate_(hrtf.GetSampleRate()),
       block_size_(block_size),
       elevation_deg_(0.0f),
       azimuth_deg_(0.0f),
       distance_(0.0f),
+      damping_(1.0f),
+      applied_damping_(-1.0f),
       hrtf_(0),
+      owned_hrtf_(0),
+      hrtf_index_(0),
+      left_right_swap_(false),
+      selected_elevation_deg_(0.0f),
+      selected_azimuth_deg_(0.0f),
       left_hrtf_filter_(0),
-      right_hrtf_filter_(0) {
-  prev_signal_block_.resize(block_size, 0.0f);
+      right_hrtf_filter_(0),
+      quality_tier_(kFullHRTF),
+      quality_tier_limit_(kFullHRTF),
+      governor_quality_tier_limit_(kFullHRTF),
+      target_quality_tier_(kFullHRTF),
+      active_quality_tier_(kFullHRTF),
+      hrtf_switch_hysteresis_deg_(0.0f),
+      governor_hysteresis_deg_(0.0f),
+      hrtf_switch_deferred_(false),
+      itd_delay_line_(0),
+      left_delay_(0.0f),
+      right_delay_(0.0f),
+      left_min_phase_filter_(0),
+      right_min_phase_filter_(0),
+      left_min_phase_kernel_(0),
+      right_min_phase_kernel_(0),
+      parametric_hrtf_(0),
+      left_shadow_state_(0.0f),
+      right_shadow_state_(0.0f),
+      max_distance_(0.0f),
+      propagation_delay_line_(0),
+      is_virtual_(false),
+      virtual_faded_out_(false),
+      virtual_tail_played_(false),
+      fifo_(0),
+      fifo_processor_(0),
+      reverb_send_level_(1.0f),
+      reverb_send_muted_(false),
+      governor_reverb_send_muted_(false),
+      reverb_send_gain_(1.0f),
+      reberation_(0) {
+  hrtf_ = &hrtf;
+  Init();
+}
+
+void Audio3DSource::Init() {
+  parametric_hrtf_ = &hrtf_->GetParametricHRTF();
+  hrtf_index_ = hrtf_->FindHRTF(selected_elevation_deg_,
+                                selected_azimuth_deg_, &left_right_swap_);
+  prev_signal_block_.resize(block_size_, 0.0f);
+  input_block_.resize(block_size_, 0.0f);
 
   CalculateXFadeWindow();
 
-  hrtf_ = new HRTF(sample_rate, block_size_);
   left_hrtf_filter_ = new FFTFilter(block_size_);
   right_hrtf_filter_ = new FFTFilter(block_size_);
+  SetFullHRTFKernels();
+  input_spectrum_.resize(2 * block_size_ + 2, 0.0f);
+  prev_input_spectrum_.resize(2 * block_size_ + 2, 0.0f);
+
+  itd_delay_line_ = new DelayLine(hrtf_->GetFilterSize(), block_size_);
+  left_delay_ = hrtf_->GetLeftEarDelay(hrtf_index_, left_right_swap_);
+  right_delay_ = hrtf_->GetRightEarDelay(hrtf_index_, left_right_swap_);
+  left_min_phase_filter_ = new FIRFilter(hrtf_->GetMinimumPhaseFilterSize(),
+                                         block_size_);
+  right_min_phase_filter_ = new FIRFilter(hrtf_->GetMinimumPhaseFilterSize(),
+                                          block_size_);
+  left_min_phase_kernel_ = &hrtf_->GetLeftEarMinimumPhaseHRTF(
+      hrtf_index_, left_right_swap_);
+  right_min_phase_kernel_ = &hrtf_->GetRightEarMinimumPhaseHRTF(
+      hrtf_index_, left_right_swap_);
 
-  left_hrtf_filter_->SetFreqDomainKernel(hrtf_->GetLeftEarFreqHRTF());
-  right_hrtf_filter_->SetFreqDomainKernel(hrtf_->GetRightEarFreqHRTF());
+  left_parametric_ = parametric_hrtf_->GetLeftEarParameters(
+      hrtf_index_, left_right_swap_);
+  right_parametric_ = parametric_hrtf_->GetRightEarParameters(
+      hrtf_index_, left_right_swap_);
 
+  fifo_ = new BlockFifo(block_size_, 1);
+  fifo_processor_ = new FifoProcessor(this);
+}
+
+void Audio3DSource::InitReberation() {
   int reberation_size = 2048 * 2;
   float reberation_duration = 0.100;
   reberation_ = new Reberation(reberation_size, sample_rate_,
@@ -32,14 +154,26 @@ Audio3DSource::Audio3DSource(int sample_rate, int block_size)
 }
 
 Audio3DSource::~Audio3DSource() {
-  delete hrtf_;
+  delete owned_hrtf_;
   delete left_hrtf_filter_;
   delete right_hrtf_filter_;
+  delete itd_delay_line_;
+  delete left_min_phase_filter_;
+  delete right_min_phase_filter_;
   delete reberation_;
+  delete propagation_delay_line_;
+  delete fifo_;
+  delete fifo_processor_;
 }
 
-void Audio3DSource::SetPosition(int x, int y, int z) {
+void Audio3DSource::SetPosition(float x, float y, float z) {
+  ListenerPose listener;
+  float elevation_deg, azimuth_deg, distance;
+  TransformToSpherical(listener, &x, &y, &z, 1, &elevation_deg, &azimuth_deg,
+                       &distance);
+  SetDirection(elevation_deg, azimuth_deg, distance);
 }
+
 void Audio3DSource::SetDirection(float elevation_deg, float azimuth_deg,
                                  float distance) {
   elevation_deg_ = elevation_deg;
@@ -51,6 +185,239 @@ void Audio3DSource::SetDirection(float elevation_deg, float azimuth_deg,
   assert(damping_ >= 0 && damping_ <= 1.0f);
 }
 
+int Audio3DSource::GetBlockSize() const {
+  return block_size_;
+}
+
+void Audio3DSource::SetMaxDistance(float max_distance) {
+  assert(max_distance >= 0.0f);
+  max_distance_ = max_distance;
+  if (max_distance_ == 0.0f) {
+    return;
+  }
+  int max_delay = ceil(max_distance_ * sample_rate_ / kSpeedOfSound);
+  max_delay = std::max(max_delay, 1);
+  if (!propagation_delay_line_
+      || propagation_delay_line_->GetMaxDelayCapacity() < max_delay) {
+    delete propagation_delay_line_;
+    propagation_delay_line_ = new FractionalDelayLine(max_delay, block_size_);
+    propagated_input_.resize(block_size_);
+  }
+  propagation_delay_line_->SetMaxDelay(max_delay);
+}
+
+float Audio3DSource::GetMaxDistance() const {
+  return max_distance_;
+}
+
+float Audio3DSource::GetDistanceGain() const {
+  return damping_;
+}
+
+void Audio3DSource::SetVirtual(bool is_virtual) {
+  assert(!reberation_ && "Virtual sources need a shared reverb");
+  is_virtual_ = is_virtual;
+}
+
+bool Audio3DSource::IsVirtual() const {
+  return is_virtual_ && virtual_faded_out_ && virtual_tail_played_;
+}
+
+const float* Audio3DSource::ApplyVirtualFade(const float* input,
+                                             bool* new_hrtf_selected) {
+  assert(new_hrtf_selected);
+  if (is_virtual_ && virtual_faded_out_) {
+    // The block after the fade-out renders silence, which plays the filter
+    // tails of the fade-out before the source turns virtual.
+    virtual_fade_input_.assign(block_size_, 0.0f);
+    virtual_tail_played_ = true;
+    return &virtual_fade_input_[0];
+  }
+  if (is_virtual_ == virtual_faded_out_) {
+    return input;
+  }
+  virtual_fade_input_.resize(block_size_);
+  for (int i = 0; i < block_size_; ++i) {
+    float gain = is_virtual_ ? 1.0f - xfade_window_[i] : xfade_window_[i];
+    virtual_fade_input_[i] = input[i] * gain;
+  }
+  if (is_virtual_) {
+    virtual_tail_played_ = false;
+  } else if (virtual_tail_played_) {
+    // The tails of the blocks before the fade-out have been played, start
+    // from silence at the current HRTF, tier and distance without any
+    // crossfade.
+    ResumeFromSilence();
+    applied_damping_ = -1.0f;
+    active_quality_tier_ = target_quality_tier_;
+    *new_hrtf_selected = false;
+  }
+  virtual_faded_out_ = is_virtual_;
+  return &virtual_fade_input_[0];
+}
+
+void Audio3DSource::ResumeFromSilence() {
+  input_spectrum_.assign(input_spectrum_.size(), 0.0f);
+  prev_signal_block_.assign(block_size_, 0.0f);
+  left_hrtf_filter_->ClearSignalHistory();
+  right_hrtf_filter_->ClearSignalHistory();
+  itd_delay_line_->ClearSignalHistory();
+  left_min_phase_filter_->ClearSignalHistory();
+  right_min_phase_filter_->ClearSignalHistory();
+  left_shadow_state_ = 0.0f;
+  right_shadow_state_ = 0.0f;
+  // All tiers start at the HRTF selected for this block instead of
+  // gliding from the one before the source turned virtual.
+  SetFullHRTFKernels();
+  left_min_phase_kernel_ = &hrtf_->GetLeftEarMinimumPhaseHRTF(
+      hrtf_index_, left_right_swap_);
+  right_min_phase_kernel_ = &hrtf_->GetRightEarMinimumPhaseHRTF(
+      hrtf_index_, left_right_swap_);
+  left_parametric_ = parametric_hrtf_->GetLeftEarParameters(
+      hrtf_index_, left_right_swap_);
+  right_parametric_ = parametric_hrtf_->GetRightEarParameters(
+      hrtf_index_, left_right_swap_);
+  left_delay_ = hrtf_->GetLeftEarDelay(hrtf_index_, left_right_swap_);
+  right_delay_ = hrtf_->GetRightEarDelay(hrtf_index_, left_right_swap_);
+}
+
+const float* Audio3DSource::ApplyPropagationDelay(const float* input) {
+  if (max_distance_ == 0.0f) {
+    return input;
+  }
+  propagation_delay_line_->Process(
+      input, distance_ * sample_rate_ / kSpeedOfSound,
+      &propagated_input_[0]);
+  return &propagated_input_[0];
+}
+
+void Audio3DSource::SetQualityTier(QualityTier quality_tier) {
+  quality_tier_ = quality_tier;
+}
+
+Audio3DSource::QualityTier Audio3DSource::GetQualityTier() const {
+  return quality_tier_;
+}
+
+void Audio3DSource::LimitQualityTier(QualityTier quality_tier) {
+  quality_tier_limit_ = quality_tier;
+}
+
+Audio3DSource::QualityTier Audio3DSource::GetQualityTierLimit() const {
+  return quality_tier_limit_;
+}
+
+void Audio3DSource::UpdateTargetQualityTier() {
+  // Tiers are ordered from the most to the least expensive.
+  target_quality_tier_ = std::max(std::max(quality_tier_, quality_tier_limit_),
+                                  governor_quality_tier_limit_);
+}
+
+void Audio3DSource::SetHRTFSwitchHysteresis(float degrees) {
+  assert(degrees >= 0.0f);
+  hrtf_switch_hysteresis_deg_ = degrees;
+}
+
+float Audio3DSource::GetHRTFSwitchHysteresis() const {
+  return hrtf_switch_hysteresis_deg_;
+}
+
+void Audio3DSource::SetGovernorLimits(QualityTier quality_tier_limit,
+                                      float hrtf_switch_hysteresis_deg,
+                                      bool reverb_send_muted) {
+  assert(hrtf_switch_hysteresis_deg >= 0.0f);
+  governor_quality_tier_limit_ = quality_tier_limit;
+  governor_hysteresis_deg_ = hrtf_switch_hysteresis_deg;
+  governor_reverb_send_muted_ = reverb_send_muted;
+}
+
+Audio3DSource::QualityTier Audio3DSource::GetGovernorQualityTierLimit()
+    const {
+  return governor_quality_tier_limit_;
+}
+
+void Audio3DSource::UseHalfFloatHRTFBank() {
+  assert(owned_hrtf_ && "Shared HRTF banks are converted by their owner");
+  owned_hrtf_->ConvertFreqDomainBankToHalfFloat();
+  SetFullHRTFKernels();
+}
+
+void Audio3DSource::SetFullHRTFKernels() {
+  if (hrtf_->IsFreqDomainBankHalfFloat()) {
+    left_hrtf_filter_->SetFreqDomainKernel(
+        hrtf_->GetLeftEarHalfFloatFreqHRTF(hrtf_index_, left_right_swap_));
+    right_hrtf_filter_->SetFreqDomainKernel(
+        hrtf_->GetRightEarHalfFloatFreqHRTF(hrtf_index_, left_right_swap_));
+  } else {
+    left_hrtf_filter_->SetFreqDomainKernel(
+        hrtf_->GetLeftEarFreqHRTF(hrtf_index_, left_right_swap_));
+    right_hrtf_filter_->SetFreqDomainKernel(
+        hrtf_->GetRightEarFreqHRTF(hrtf_index_, left_right_swap_));
+  }
+}
+
+bool Audio3DSource::HasDirectionChanged() const {
+  if (elevation_deg_ == selected_elevation_deg_
+      && azimuth_deg_ == selected_azimuth_deg_) {
+    return false;
+  }
+  float hysteresis_deg = fmax(hrtf_switch_hysteresis_deg_,
+                              governor_hysteresis_deg_);
+  if (hysteresis_deg > 0.0f
+      && fabs(elevation_deg_ - selected_elevation_deg_) <= hysteresis_deg
+      && fabs(remainder(azimuth_deg_ - selected_azimuth_deg_, 360.0f))
+          <= hysteresis_deg) {
+    return false;
+  }
+  return true;
+}
+
+bool Audio3DSource::IsHRTFSwitchPending() const {
+  if (!HasDirectionChanged()) {
+    return false;
+  }
+  bool left_right_swap;
+  int hrtf_index = hrtf_->FindHRTF(elevation_deg_, azimuth_deg_,
+                                   &left_right_swap);
+  return hrtf_index != hrtf_index_ || left_right_swap != left_right_swap_;
+}
+
+float Audio3DSource::GetHRTFDirectionError() const {
+  float elevation = elevation_deg_ * M_PI / 180.0;
+  float selected_elevation = selected_elevation_deg_ * M_PI / 180.0;
+  float azimuth_difference = (azimuth_deg_ - selected_azimuth_deg_) * M_PI
+      / 180.0;
+  float cos_angle = sin(elevation) * sin(selected_elevation)
+      + cos(elevation) * cos(selected_elevation) * cos(azimuth_difference);
+  return acos(fmax(-1.0f, fmin(1.0f, cos_angle))) * 180.0 / M_PI;
+}
+
+void Audio3DSource::DeferHRTFSwitch() {
+  hrtf_switch_deferred_ = true;
+}
+
+bool Audio3DSource::SelectHRTF() {
+  if (hrtf_switch_deferred_) {
+    hrtf_switch_deferred_ = false;
+    return false;
+  }
+  if (!HasDirectionChanged()) {
+    return false;
+  }
+  selected_elevation_deg_ = elevation_deg_;
+  selected_azimuth_deg_ = azimuth_deg_;
+
+  bool left_right_swap;
+  int hrtf_index = hrtf_->FindHRTF(elevation_deg_, azimuth_deg_,
+                                   &left_right_swap);
+  if (hrtf_index == hrtf_index_ && left_right_swap == left_right_swap_) {
+    return false;
+  }
+  hrtf_index_ = hrtf_index;
+  left_right_swap_ = left_right_swap;
+  return true;
+}
+
 void Audio3DSource::CalculateXFadeWindow() {
   xfade_window_.resize(block_size_);
   double phase_step = M_PI / 2.0 / (block_size_ - 1);
@@ -64,74 +431,617 @@ void Audio3DSource::ProcessBlock(const std::vector<float>&input,
                                  std::vector<float>* output_left,
                                  std::vector<float>* output_right) {
   assert(output_left != 0 && output_right != 0);
+  assert(input.size() == block_size_);
+  output_left->resize(block_size_);
+  output_right->resize(block_size_);
+  RenderBlock(&input[0], &(*output_left)[0], &(*output_right)[0], 1);
+}
 
-  left_hrtf_filter_->AddSignalBlock(input);
+void Audio3DSource::ProcessBlock(const std::vector<float>& input,
+                                 float* output) {
+  assert(output != 0);
+  assert(input.size() == block_size_);
+  RenderBlock(&input[0], output, output + 1, 2);
+}
 
-  std::vector<float> current_hrtf_output_left;
-  left_hrtf_filter_->GetResult(&current_hrtf_output_left);
+void Audio3DSource::ProcessBlock(const float* input, int num_input_channels,
+                                 float* output_left, float* output_right,
+                                 int output_stride) {
+  assert(input != 0 && num_input_channels > 0);
+  if (num_input_channels == 1) {
+    RenderBlock(input, output_left, output_right, output_stride);
+    return;
+  }
+  float scale = 1.0f / num_input_channels;
+  for (int i = 0; i < block_size_; ++i) {
+    const float* frame = input + i * num_input_channels;
+    float sum = 0.0f;
+    for (int c = 0; c < num_input_channels; ++c) {
+      sum += frame[c];
+    }
+    input_block_[i] = sum * scale;
+  }
+  RenderBlock(&input_block_[0], output_left, output_right, output_stride);
+}
 
-  right_hrtf_filter_->AddSignalBlock(input);
+void Audio3DSource::ProcessBlock(const float* const* input_channels,
+                                 int num_input_channels, float* output_left,
+                                 float* output_right, int output_stride) {
+  assert(input_channels != 0 && num_input_channels > 0);
+  if (num_input_channels == 1) {
+    RenderBlock(input_channels[0], output_left, output_right, output_stride);
+    return;
+  }
+  input_block_.assign(input_channels[0], input_channels[0] + block_size_);
+  for (int c = 1; c < num_input_channels; ++c) {
+    for (int i = 0; i < block_size_; ++i) {
+      input_block_[i] += input_channels[c][i];
+    }
+  }
+  float scale = 1.0f / num_input_channels;
+  for (int i = 0; i < block_size_; ++i) {
+    input_block_[i] *= scale;
+  }
+  RenderBlock(&input_block_[0], output_left, output_right, output_stride);
+}
+
+void Audio3DSource::ProcessFrames(const float* input, int num_input_channels,
+                                  int num_frames, float* output_left,
+                                  float* output_right, int output_stride) {
+  assert(num_input_channels > 0);
+  if (fifo_->GetNumInputChannels() != num_input_channels) {
+    fifo_->SetNumInputChannels(num_input_channels);
+  }
+  fifo_processor_->SetNumInputChannels(num_input_channels);
+  fifo_->Process(input, num_frames, fifo_processor_, output_left,
+                 output_right, output_stride);
+}
+
+int Audio3DSource::GetFifoLatency() const {
+  return fifo_->GetLatency();
+}
+
+void Audio3DSource::RenderBlock(const float* source_input,
+                                float* output_left, float* output_right,
+                                int output_stride) {
+  const float* delayed_input = ApplyPropagationDelay(source_input);
+  if (IsVirtual()) {
+    for (int i = 0; i < block_size_; ++i) {
+      output_left[i * output_stride] = 0.0f;
+      output_right[i * output_stride] = 0.0f;
+    }
+    reverb_send_block_.assign(block_size_, 0.0f);
+    return;
+  }
+  UpdateTargetQualityTier();
+  bool new_hrtf_selected = SelectHRTF();
+  // After the HRTF selection, so that a resumed source starts at the
+  // current direction.
+  const float* input = ApplyVirtualFade(delayed_input, &new_hrtf_selected);
+
+  // The interaural delay always runs so that the minimum-phase filters hold
+  // a valid signal history when switching the quality tier.
+  UpdateInterauralDelay(input);
+
+  OutputStageInput stage;
+  stage.next_left = 0;
+  stage.next_right = 0;
+  stage.previous_left = 0;
+  stage.previous_right = 0;
+  stage.fade_in_window = &xfade_window_[0];
+  stage.reverb_left = 0;
+  stage.reverb_right = 0;
+  if (target_quality_tier_ == active_quality_tier_) {
+    if (RenderQualityTier(active_quality_tier_, input, new_hrtf_selected,
+                          &tier_output_left_, &tier_output_right_,
+                          &previous_tier_output_left_,
+                          &previous_tier_output_right_)) {
+      stage.previous_left = &previous_tier_output_left_[0];
+      stage.previous_right = &previous_tier_output_right_[0];
+    }
+  } else {
+    // The tier fading out keeps the previous HRTF, so that one crossfade
+    // covers both switches.
+    RenderQualityTier(active_quality_tier_, input, new_hrtf_selected,
+                      &previous_tier_output_left_,
+                      &previous_tier_output_right_, 0, 0);
+    StartQualityTier(target_quality_tier_, input, &tier_output_left_,
+                     &tier_output_right_);
+    stage.previous_left = &previous_tier_output_left_[0];
+    stage.previous_right = &previous_tier_output_right_[0];
+    active_quality_tier_ = target_quality_tier_;
+  }
+  stage.next_left = &tier_output_left_[0];
+  stage.next_right = &tier_output_right_[0];
 
-  std::vector<float> current_hrtf_output_right;
-  right_hrtf_filter_->GetResult(&current_hrtf_output_right);
+  prev_signal_block_.assign(input, input + block_size_);
 
-  bool new_hrtf_selected = hrtf_->SetDirection(elevation_deg_, azimuth_deg_);
+  UpdateReverbSend(input);
+  if (reberation_) {
+    reberation_->ProcessReberation(reverb_send_block_, &stage.reverb_left,
+                                   &stage.reverb_right);
+  }
+
+  // Distance changes ramp over the block to avoid zipper noise.
+  stage.start_gain = applied_damping_ < 0.0f ? damping_ : applied_damping_;
+  stage.end_gain = damping_;
+  applied_damping_ = damping_;
+
+  RenderOutputStage(stage, block_size_, output_left, output_right,
+                    output_stride);
+}
+
+void Audio3DSource::ProcessBlock(const std::vector<float>& source_input,
+                                 std::vector<float>* spectrum_left,
+                                 std::vector<float>* spectrum_right,
+                                 std::vector<float>* output_left,
+                                 std::vector<float>* output_right) {
+  assert(spectrum_left != 0 && spectrum_right != 0);
+  assert(output_left != 0 && output_right != 0);
+  assert(!reberation_ && "Spectral rendering needs a shared reverb");
+  assert(source_input.size() == block_size_);
+  const float* delayed_input = ApplyPropagationDelay(&source_input[0]);
+  if (IsVirtual()) {
+    output_left->assign(block_size_, 0.0f);
+    output_right->assign(block_size_, 0.0f);
+    reverb_send_block_.assign(block_size_, 0.0f);
+    return;
+  }
+  UpdateTargetQualityTier();
+
+  int previous_hrtf_index = hrtf_index_;
+  bool previous_left_right_swap = left_right_swap_;
+  bool new_hrtf_selected = SelectHRTF();
+  const float* input = ApplyVirtualFade(delayed_input, &new_hrtf_selected);
   if (!new_hrtf_selected) {
-    output_left->swap(current_hrtf_output_left);
-    output_right->swap(current_hrtf_output_right);
+    // A resumed source starts at the current HRTF.
+    previous_hrtf_index = hrtf_index_;
+    previous_left_right_swap = left_right_swap_;
+  }
+  UpdateInterauralDelay(input);
+
+  prev_input_spectrum_.swap(input_spectrum_);
+  left_hrtf_filter_->ForwardTransform(input, &input_spectrum_);
+
+  bool previous_full_hrtf = (active_quality_tier_ == kFullHRTF);
+  float previous_damping =
+      applied_damping_ < 0.0f ? damping_ : applied_damping_;
+  bool full_hrtf_switched = AddFullHRTFSpectrum(
+      true, previous_full_hrtf, previous_hrtf_index, previous_left_right_swap,
+      previous_damping, spectrum_left, &full_hrtf_correction_left_);
+  AddFullHRTFSpectrum(false, previous_full_hrtf, previous_hrtf_index,
+                      previous_left_right_swap, previous_damping,
+                      spectrum_right, &full_hrtf_correction_right_);
+
+  OutputStageInput stage;
+  stage.next_left = 0;
+  stage.next_right = 0;
+  stage.previous_left = 0;
+  stage.previous_right = 0;
+  stage.fade_in_window = &xfade_window_[0];
+  stage.reverb_left = 0;
+  stage.reverb_right = 0;
+  if (full_hrtf_switched) {
+    stage.reverb_left = &full_hrtf_correction_left_[0];
+    stage.reverb_right = &full_hrtf_correction_right_[0];
+  }
+  // Ramps like the time-domain renderer, AddFullHRTFSpectrum() corrects
+  // the spectrum for the same ramp.
+  stage.start_gain = previous_damping;
+  stage.end_gain = damping_;
+  applied_damping_ = damping_;
+
+  // Time-domain tiers. The full HRTF side of a tier switch is crossfaded by
+  // the correction of AddFullHRTFSpectrum(), the other side fades from or
+  // to silence.
+  if (target_quality_tier_ == active_quality_tier_) {
+    if (target_quality_tier_ != kFullHRTF) {
+      if (RenderQualityTier(target_quality_tier_, input, new_hrtf_selected,
+                            &tier_output_left_, &tier_output_right_,
+                            &previous_tier_output_left_,
+                            &previous_tier_output_right_)) {
+        stage.previous_left = &previous_tier_output_left_[0];
+        stage.previous_right = &previous_tier_output_right_[0];
+      }
+      stage.next_left = &tier_output_left_[0];
+      stage.next_right = &tier_output_right_[0];
+    }
   } else {
-    // Update filter kernels
-    left_hrtf_filter_->SetFreqDomainKernel(hrtf_->GetLeftEarFreqHRTF());
-    right_hrtf_filter_->SetFreqDomainKernel(hrtf_->GetRightEarFreqHRTF());
-    // Update filter state with previous signal block
-    left_hrtf_filter_->AddSignalBlock(prev_signal_block_);
-    right_hrtf_filter_->AddSignalBlock(prev_signal_block_);
-
-    // Filter current input with updated HRTF filters.
-    left_hrtf_filter_->AddSignalBlock(input);
-    right_hrtf_filter_->AddSignalBlock(input);
-
-    std::vector<float> updated_hrtf_output_left;
-    left_hrtf_filter_->GetResult(&updated_hrtf_output_left);
-    std::vector<float> updated_hrtf_output_right;
-    right_hrtf_filter_->GetResult(&updated_hrtf_output_right);
+    if (active_quality_tier_ != kFullHRTF) {
+      RenderQualityTier(active_quality_tier_, input, new_hrtf_selected,
+                        &previous_tier_output_left_,
+                        &previous_tier_output_right_, 0, 0);
+    } else {
+      previous_tier_output_left_.assign(block_size_, 0.0f);
+      previous_tier_output_right_.assign(block_size_, 0.0f);
+    }
+    if (target_quality_tier_ != kFullHRTF) {
+      StartQualityTier(target_quality_tier_, input, &tier_output_left_,
+                       &tier_output_right_);
+    } else {
+      tier_output_left_.assign(block_size_, 0.0f);
+      tier_output_right_.assign(block_size_, 0.0f);
+    }
+    stage.previous_left = &previous_tier_output_left_[0];
+    stage.previous_right = &previous_tier_output_right_[0];
+    stage.next_left = &tier_output_left_[0];
+    stage.next_right = &tier_output_right_[0];
+    active_quality_tier_ = target_quality_tier_;
+  }
 
+  prev_signal_block_.assign(input, input + block_size_);
+
+  if (stage.next_left) {
     output_left->resize(block_size_);
-    ApplyXFadeWindow(current_hrtf_output_left, updated_hrtf_output_left,
-                     output_left);
     output_right->resize(block_size_);
-    ApplyXFadeWindow(current_hrtf_output_right, updated_hrtf_output_right,
-                     output_right);
+    RenderOutputStage(stage, block_size_, &(*output_left)[0],
+                      &(*output_right)[0], 1);
+  } else if (full_hrtf_switched) {
+    *output_left = full_hrtf_correction_left_;
+    *output_right = full_hrtf_correction_right_;
+  } else {
+    output_left->assign(block_size_, 0.0f);
+    output_right->assign(block_size_, 0.0f);
   }
 
-  prev_signal_block_ = input;
+  UpdateReverbSend(input);
+}
 
-  ApplyDamping(damping_, output_left);
-  ApplyDamping(damping_, output_right);
+bool Audio3DSource::AddFullHRTFSpectrum(bool left_ear,
+                                        bool previous_full_hrtf,
+                                        int previous_hrtf_index,
+                                        bool previous_left_right_swap,
+                                        float previous_damping,
+                                        std::vector<float>* spectrum,
+                                        std::vector<float>* correction) {
+  bool full_hrtf = (target_quality_tier_ == kFullHRTF);
+  if (full_hrtf) {
+    MultiplyAddKernel(input_spectrum_, left_ear, hrtf_index_,
+                      left_right_swap_, damping_, spectrum);
+  }
+  bool kernel_changed = previous_full_hrtf != full_hrtf
+      || (full_hrtf && (previous_hrtf_index != hrtf_index_
+          || previous_left_right_swap != left_right_swap_));
+  bool damping_changed = previous_damping != damping_;
+  if ((!previous_full_hrtf && !full_hrtf)
+      || (!kernel_changed && !damping_changed)) {
+    return false;
+  }
+
+  // The time-domain renderer crossfades from the previous kernel Hp to the
+  // current kernel H (a missing kernel is zero) with the window w and ramps
+  // the damping g from d_prev to d. On top of the bus this becomes
+  //   (g - d_prev) tail(IFFT(X[n-1] Hp)) + (g - d) head(IFFT(X[n] H))
+  //   + g (1 - w) head(IFFT(X[n] D)) - g w tail(IFFT(X[n-1] D))
+  // with D = Hp - H.
+  float gain_step = (damping_ - previous_damping) / block_size_;
+  correction->assign(block_size_, 0.0f);
+  if (damping_changed && previous_full_hrtf) {
+    product_spectrum_.assign(input_spectrum_.size(), 0.0f);
+    MultiplyAddKernel(prev_input_spectrum_, left_ear, previous_hrtf_index,
+                      previous_left_right_swap, 1.0f, &product_spectrum_);
+    left_hrtf_filter_->InverseTransform(product_spectrum_,
+                                        &correction_signal_);
+    for (int i = 0; i < block_size_; ++i) {
+      (*correction)[i] += gain_step * (i + 1)
+          * correction_signal_[block_size_ + i];
+    }
+  }
+  if (damping_changed && full_hrtf) {
+    product_spectrum_.assign(input_spectrum_.size(), 0.0f);
+    MultiplyAddKernel(input_spectrum_, left_ear, hrtf_index_,
+                      left_right_swap_, 1.0f, &product_spectrum_);
+    left_hrtf_filter_->InverseTransform(product_spectrum_,
+                                        &correction_signal_);
+    for (int i = 0; i < block_size_; ++i) {
+      (*correction)[i] += gain_step * (i + 1 - block_size_)
+          * correction_signal_[i];
+    }
+  }
+  if (!kernel_changed) {
+    return true;
+  }
 
-  // Reberation damping!!
-  reberation_->AddReberation(input, output_left, output_right);
+  MultiplyDifferenceKernel(input_spectrum_, left_ear, previous_full_hrtf,
+                           previous_hrtf_index, previous_left_right_swap,
+                           full_hrtf);
+  left_hrtf_filter_->InverseTransform(product_spectrum_, &correction_signal_);
+  for (int i = 0; i < block_size_; ++i) {
+    float gain = previous_damping + gain_step * (i + 1);
+    (*correction)[i] += gain * xfade_window_[block_size_ - 1 - i]
+        * correction_signal_[i];
+  }
+
+  MultiplyDifferenceKernel(prev_input_spectrum_, left_ear,
+                           previous_full_hrtf, previous_hrtf_index,
+                           previous_left_right_swap, full_hrtf);
+  left_hrtf_filter_->InverseTransform(product_spectrum_, &correction_signal_);
+  for (int i = 0; i < block_size_; ++i) {
+    float gain = previous_damping + gain_step * (i + 1);
+    (*correction)[i] -= gain * xfade_window_[i]
+        * correction_signal_[block_size_ + i];
+  }
+  return true;
 }
 
-void Audio3DSource::ApplyXFadeWindow(const std::vector<float>& block_a,
-                                     const std::vector<float>& block_b,
-                                     std::vector<float>* output) {
-  assert(output != 0);
-  assert(block_a.size() == block_b.size());
-  assert(block_a.size() == xfade_window_.size());
-  assert(output->size() == xfade_window_.size());
+void Audio3DSource::MultiplyAddKernel(const std::vector<float>& spectrum,
+                                      bool left_ear, int hrtf_index,
+                                      bool left_right_swap, float gain,
+                                      std::vector<float>* result) const {
+  if (hrtf_->IsFreqDomainBankHalfFloat()) {
+    MultiplyAddSpectrum(spectrum, left_ear
+        ? hrtf_->GetLeftEarHalfFloatFreqHRTF(hrtf_index, left_right_swap)
+        : hrtf_->GetRightEarHalfFloatFreqHRTF(hrtf_index, left_right_swap),
+        gain, result);
+  } else {
+    MultiplyAddSpectrum(spectrum, left_ear
+        ? hrtf_->GetLeftEarFreqHRTF(hrtf_index, left_right_swap)
+        : hrtf_->GetRightEarFreqHRTF(hrtf_index, left_right_swap),
+        gain, result);
+  }
+}
 
-  for (int i = 0; i < block_a.size(); ++i) {
-    (*output)[i] = block_a[i] * xfade_window_[xfade_window_.size() - 1 - i]
-        + block_b[i] * xfade_window_[i];
+void Audio3DSource::MultiplyDifferenceKernel(
+    const std::vector<float>& spectrum, bool left_ear,
+    bool previous_full_hrtf, int previous_hrtf_index,
+    bool previous_left_right_swap, bool full_hrtf) {
+  product_spectrum_.assign(spectrum.size(), 0.0f);
+  if (previous_full_hrtf) {
+    MultiplyAddKernel(spectrum, left_ear, previous_hrtf_index,
+                      previous_left_right_swap, 1.0f, &product_spectrum_);
+  }
+  if (full_hrtf) {
+    MultiplyAddKernel(spectrum, left_ear, hrtf_index_, left_right_swap_,
+                      -1.0f, &product_spectrum_);
   }
 }
 
-void Audio3DSource::ApplyDamping(float damping_factor,
-                                 std::vector<float>* block) {
-  assert(block != 0);
-  for (int i = 0; i < block->size(); ++i) {
-    (*block)[i] *= damping_factor;
+void Audio3DSource::MultiplyAddSpectrum(const std::vector<float>& spectrum_a,
+                                        const std::vector<float>& spectrum_b,
+                                        float gain,
+                                        std::vector<float>* result) {
+  assert(result);
+  assert(spectrum_a.size() == spectrum_b.size());
+  assert(spectrum_a.size() == result->size());
+  for (int i = 0; i < spectrum_a.size(); i += 2) {
+    float a_real = spectrum_a[i];
+    float a_imag = spectrum_a[i + 1];
+    float b_real = spectrum_b[i];
+    float b_imag = spectrum_b[i + 1];
+    (*result)[i] += gain * (a_real * b_real - a_imag * b_imag);
+    (*result)[i + 1] += gain * (a_real * b_imag + a_imag * b_real);
   }
 }
 
+void Audio3DSource::MultiplyAddSpectrum(
+    const std::vector<float>& spectrum_a,
+    const std::vector<uint16_t>& half_spectrum_b, float gain,
+    std::vector<float>* result) {
+  assert(result);
+  assert(spectrum_a.size() == half_spectrum_b.size());
+  assert(spectrum_a.size() == result->size());
+  // Converts the kernel in chunks that stay in L1 cache.
+  static const int kChunkSize = 128;
+  float spectrum_b[kChunkSize];
+  for (int begin = 0; begin < spectrum_a.size(); begin += kChunkSize) {
+    int size = std::min<int>(kChunkSize, spectrum_a.size() - begin);
+    ConvertHalfToFloat(&half_spectrum_b[begin], size, spectrum_b);
+    for (int i = 0; i < size; i += 2) {
+      float a_real = spectrum_a[begin + i];
+      float a_imag = spectrum_a[begin + i + 1];
+      float b_real = spectrum_b[i];
+      float b_imag = spectrum_b[i + 1];
+      (*result)[begin + i] += gain * (a_real * b_real - a_imag * b_imag);
+      (*result)[begin + i + 1] += gain * (a_real * b_imag + a_imag * b_real);
+    }
+  }
+}
+
+void Audio3DSource::SetReverbSendLevel(float level) {
+  assert(level >= 0.0f);
+  reverb_send_level_ = level;
+}
+
+void Audio3DSource::SetReverbSendMuted(bool muted) {
+  reverb_send_muted_ = muted;
+}
+
+bool Audio3DSource::IsReverbSendMuted() const {
+  return reverb_send_muted_;
+}
+
+void Audio3DSource::AddReverbSend(std::vector<float>* send_bus) const {
+  assert(send_bus && send_bus->size() == reverb_send_block_.size());
+  for (int i = 0; i < reverb_send_block_.size(); ++i) {
+    (*send_bus)[i] += reverb_send_block_[i];
+  }
+}
+
+void Audio3DSource::UpdateReverbSend(const float* input) {
+  // The reverb decays slower with distance than the direct sound, so that
+  // far sources sound more reverberant.
+  float send_gain = reverb_send_muted_ || governor_reverb_send_muted_ ? 0.0f
+      : reverb_send_level_ * sqrt(damping_);
+  float gain_step = (send_gain - reverb_send_gain_) / block_size_;
+  reverb_send_block_.resize(block_size_);
+  for (int i = 0; i < block_size_; ++i) {
+    reverb_send_block_[i] = input[i] * (reverb_send_gain_
+        + gain_step * (i + 1));
+  }
+  reverb_send_gain_ = send_gain;
+}
+
+bool Audio3DSource::RenderQualityTier(QualityTier quality_tier,
+                                      const float* input,
+                                      bool new_hrtf_selected,
+                                      std::vector<float>* output_left,
+                                      std::vector<float>* output_right,
+                                      std::vector<float>* previous_left,
+                                      std::vector<float>* previous_right) {
+  switch (quality_tier) {
+    case kFullHRTF:
+      return RenderFullHRTF(input, new_hrtf_selected, output_left,
+                            output_right, previous_left, previous_right);
+    case kTruncatedHRTF:
+      return RenderMinimumPhaseHRTF(output_left, output_right, previous_left,
+                                    previous_right);
+    case kParametric:
+      RenderParametric(output_left, output_right);
+      break;
+  }
+  return false;
+}
+
+void Audio3DSource::StartQualityTier(QualityTier quality_tier,
+                                     const float* input,
+                                     std::vector<float>* output_left,
+                                     std::vector<float>* output_right) {
+  switch (quality_tier) {
+    case kFullHRTF:
+      ResetFullHRTF(input, output_left, output_right);
+      break;
+    case kTruncatedHRTF:
+      left_min_phase_kernel_ = &hrtf_->GetLeftEarMinimumPhaseHRTF(
+          hrtf_index_, left_right_swap_);
+      right_min_phase_kernel_ = &hrtf_->GetRightEarMinimumPhaseHRTF(
+          hrtf_index_, left_right_swap_);
+      RenderMinimumPhaseHRTF(output_left, output_right, 0, 0);
+      break;
+    case kParametric:
+      ResetParametric(output_left, output_right);
+      break;
+  }
+}
+
+bool Audio3DSource::RenderFullHRTF(const float* input,
+                                   bool new_hrtf_selected,
+                                   std::vector<float>* output_left,
+                                   std::vector<float>* output_right,
+                                   std::vector<float>* previous_left,
+                                   std::vector<float>* previous_right) {
+  left_hrtf_filter_->AddSignalBlock(input);
+  right_hrtf_filter_->AddSignalBlock(input);
+
+  if (!new_hrtf_selected || !previous_left) {
+    left_hrtf_filter_->GetResult(output_left);
+    right_hrtf_filter_->GetResult(output_right);
+    return false;
+  }
+  left_hrtf_filter_->GetResult(previous_left);
+  right_hrtf_filter_->GetResult(previous_right);
+  ResetFullHRTF(input, output_left, output_right);
+  return true;
+}
+
+void Audio3DSource::ResetFullHRTF(const float* input,
+                                  std::vector<float>* output_left,
+                                  std::vector<float>* output_right) {
+  // Update filter kernels
+  SetFullHRTFKernels();
+  // Update filter state with previous signal block
+  left_hrtf_filter_->AddSignalBlock(prev_signal_block_);
+  right_hrtf_filter_->AddSignalBlock(prev_signal_block_);
+
+  // Filter current input with updated HRTF filters.
+  left_hrtf_filter_->AddSignalBlock(input);
+  right_hrtf_filter_->AddSignalBlock(input);
+
+  left_hrtf_filter_->GetResult(output_left);
+  right_hrtf_filter_->GetResult(output_right);
+}
+
+void Audio3DSource::UpdateInterauralDelay(const float* input) {
+  itd_delay_line_->AddSignalBlock(input);
+
+  // Glide from the previous to the current onset delays to avoid clicks.
+  float left_delay = hrtf_->GetLeftEarDelay(hrtf_index_, left_right_swap_);
+  float right_delay = hrtf_->GetRightEarDelay(hrtf_index_, left_right_swap_);
+
+  itd_delay_line_->GetResult(left_delay_, left_delay, &left_delayed_input_);
+  left_min_phase_filter_->AddSignalBlock(left_delayed_input_);
+  itd_delay_line_->GetResult(right_delay_, right_delay,
+                             &right_delayed_input_);
+  right_min_phase_filter_->AddSignalBlock(right_delayed_input_);
+
+  left_delay_ = left_delay;
+  right_delay_ = right_delay;
+}
+
+bool Audio3DSource::RenderMinimumPhaseHRTF(
+    std::vector<float>* output_left, std::vector<float>* output_right,
+    std::vector<float>* previous_left, std::vector<float>* previous_right) {
+  const std::vector<float>* left_kernel = &hrtf_->GetLeftEarMinimumPhaseHRTF(
+      hrtf_index_, left_right_swap_);
+  const std::vector<float>* right_kernel =
+      &hrtf_->GetRightEarMinimumPhaseHRTF(hrtf_index_, left_right_swap_);
+
+  if (!previous_left || (left_kernel == left_min_phase_kernel_
+                         && right_kernel == right_min_phase_kernel_)) {
+    left_min_phase_filter_->GetResult(*left_min_phase_kernel_, output_left);
+    right_min_phase_filter_->GetResult(*right_min_phase_kernel_,
+                                       output_right);
+    return false;
+  }
+
+  // Minimum-phase kernels are aligned in time, so crossfading between them
+  // does not cause comb filtering.
+  left_min_phase_filter_->GetResult(*left_min_phase_kernel_, previous_left);
+  left_min_phase_filter_->GetResult(*left_kernel, output_left);
+  right_min_phase_filter_->GetResult(*right_min_phase_kernel_,
+                                     previous_right);
+  right_min_phase_filter_->GetResult(*right_kernel, output_right);
+
+  left_min_phase_kernel_ = left_kernel;
+  right_min_phase_kernel_ = right_kernel;
+  return true;
+}
+
+void Audio3DSource::ResetParametric(std::vector<float>* output_left,
+                                    std::vector<float>* output_right) {
+  // The one-pole filters forget their state within a few samples, which is
+  // hidden by the crossfade into this tier.
+  left_shadow_state_ = 0.0f;
+  right_shadow_state_ = 0.0f;
+  left_parametric_ = parametric_hrtf_->GetLeftEarParameters(
+      hrtf_index_, left_right_swap_);
+  right_parametric_ = parametric_hrtf_->GetRightEarParameters(
+      hrtf_index_, left_right_swap_);
+  RenderParametric(output_left, output_right);
+}
+
+void Audio3DSource::RenderParametric(std::vector<float>* output_left,
+                                     std::vector<float>* output_right) {
+  ApplyParametricEar(left_delayed_input_,
+                     parametric_hrtf_->GetLeftEarParameters(hrtf_index_,
+                                                            left_right_swap_),
+                     &left_parametric_, &left_shadow_state_, output_left);
+  ApplyParametricEar(right_delayed_input_,
+                     parametric_hrtf_->GetRightEarParameters(
+                         hrtf_index_, left_right_swap_),
+                     &right_parametric_, &right_shadow_state_, output_right);
+}
+
+void Audio3DSource::ApplyParametricEar(
+    const std::vector<float>& delayed_input,
+    const ParametricHRTF::EarParameters& target_parameters,
+    ParametricHRTF::EarParameters* parameters, float* shadow_state,
+    std::vector<float>* output) {
+  assert(parameters && shadow_state && output);
+  int block_size = delayed_input.size();
+  output->resize(block_size);
+
+  // Glide gain and filter coefficient over the block to avoid clicks.
+  float gain = parameters->gain;
+  float gain_step = (target_parameters.gain - gain) / block_size;
+  float a = parameters->shadow_coefficient;
+  float a_step = (target_parameters.shadow_coefficient - a) / block_size;
+  float state = *shadow_state;
+  for (int i = 0; i < block_size; ++i) {
+    gain += gain_step;
+    a += a_step;
+    state = (1.0f - a) * delayed_input[i] + a * state;
+    (*output)[i] = gain * state;
+  }
+  *shadow_state = state;
+  *parameters = target_parameters;
+}
@@ -0,0 +1,684 @@
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <cmath>
+
+#include "audio_3d.h"
+#include "audio_3d_scene.h"
+#include "block_fifo.h"
+#include "fdn_reverb.h"
+#include "fft_filter.h"
+#include "hrtf.h"
+#include "output_stage.h"
+#include "reberation.h"
+
+namespace {
+
+// Highest level of the CPU budget governor.
+const int kMaxQualityLevel = 4;
+// HRTF switch hysteresis from quality level 1 on.
+const float kGovernorHysteresisDeg = 5.0f;
+// The governor steps back up after this many blocks below
+// kGovernorRecoveryLoad times the budget.
+const int kGovernorRecoveryBlocks = 20;
+const float kGovernorRecoveryLoad = 0.7f;
+// Same room as a standalone Audio3DSource.
+const int kReberationSize = 2048 * 2;
+const float kReberationDuration = 0.100f;
+// Delay lines of the FDN reverb.
+const int kFDNReverbLines = 16;
+
+// Orders source ids by decreasing value, e.g. audibility, ties by id.
+class HigherValue {
+ public:
+  explicit HigherValue(const std::vector<float>& values)
+      : values_(values) {
+  }
+  bool operator()(int a, int b) const {
+    if (values_[a] != values_[b]) {
+      return values_[a] > values_[b];
+    }
+    return a < b;
+  }
+
+ private:
+  const std::vector<float>& values_;
+};
+
+// Orders sources by increasing distance gain, i.e. the most distant first,
+// ties by source id.
+class MoreDistant {
+ public:
+  explicit MoreDistant(const std::vector<float>& distance_gain)
+      : distance_gain_(distance_gain) {
+  }
+  bool operator()(int a, int b) const {
+    if (distance_gain_[a] != distance_gain_[b]) {
+      return distance_gain_[a] < distance_gain_[b];
+    }
+    return a < b;
+  }
+
+ private:
+  const std::vector<float>& distance_gain_;
+};
+
+}  // namespace
+
+class Audio3DScene::RenderTask : public ThreadPool::Task {
+ public:
+  explicit RenderTask(Audio3DScene* scene)
+      : scene_(scene) {
+  }
+  virtual ~RenderTask() {
+  }
+
+  virtual void Run(int source_id, int /* worker_index */) {
+    scene_->RenderSource(source_id);
+  }
+
+ private:
+  Audio3DScene* scene_;
+};
+
+class Audio3DScene::FifoProcessor : public BlockFifo::Processor {
+ public:
+  explicit FifoProcessor(Audio3DScene* scene)
+      : scene_(scene) {
+  }
+  virtual ~FifoProcessor() {
+  }
+
+  virtual void ProcessFifoBlock(const float* const* input_channels,
+                                float* output_left, float* output_right) {
+    scene_->ProcessBlock(input_channels, output_left, output_right, 1);
+  }
+
+ private:
+  Audio3DScene* scene_;
+};
+
+Audio3DScene::Audio3DScene(int sample_rate, int block_size)
+    : Audio3DScene(new HRTF(sample_rate, block_size), sample_rate,
+                   block_size) {
+}
+
+Audio3DScene::Audio3DScene(const HRTFDataSource& hrtf_data_source,
+                           int sample_rate, int block_size)
+    : Audio3DScene(new HRTF(hrtf_data_source, sample_rate, block_size),
+                   sample_rate, block_size) {
+}
+
+Audio3DScene::Audio3DScene(HRTF* hrtf, int sample_rate, int block_size)
+    : sample_rate_(sample_rate),
+      block_size_(block_size),
+      hrtf_(hrtf),
+      reberation_(0),
+      fdn_reverb_(0),
+      thread_pool_(0),
+      render_task_(0),
+      input_(0),
+      input_channels_(0),
+      fifo_(0),
+      fifo_processor_(0),
+      num_positioned_sources_(0),
+      audibility_threshold_(0.0f),
+      max_voices_(0),
+      num_virtual_sources_(0),
+      cpu_budget_(0.0f),
+      num_blocks_below_budget_(0),
+      max_hrtf_switches_per_block_(0),
+      num_deferred_hrtf_switches_(0),
+      summation_mode_(kTimeDomainSummation),
+      reverb_mode_(kConvolutionReverb),
+      fdn_low_reverb_time_(kReberationDuration),
+      fdn_high_reverb_time_(kReberationDuration),
+      rendering_started_(false),
+      bus_filter_(0) {
+  Init();
+}
+
+void Audio3DScene::Init() {
+  bus_left_.resize(block_size_, 0.0f);
+  bus_right_.resize(block_size_, 0.0f);
+  reverb_send_bus_.resize(block_size_, 0.0f);
+
+  CreateReverb();
+
+  governor_stats_.quality_level = 0;
+  governor_stats_.num_step_downs = 0;
+  governor_stats_.num_step_ups = 0;
+  governor_stats_.num_blocks_over_budget = 0;
+  governor_stats_.last_render_seconds = 0.0;
+
+  render_task_ = new RenderTask(this);
+  SetNumThreads(1);
+
+  bus_filter_ = new FFTFilter(block_size_);
+  fifo_ = new BlockFifo(block_size_, 0);
+  fifo_processor_ = new FifoProcessor(this);
+  spectrum_bus_left_.resize(2 * block_size_ + 2, 0.0f);
+  spectrum_bus_right_.resize(2 * block_size_ + 2, 0.0f);
+  bus_tail_left_.resize(block_size_, 0.0f);
+  bus_tail_right_.resize(block_size_, 0.0f);
+}
+
+Audio3DScene::~Audio3DScene() {
+  for (int i = 0; i < sources_.size(); ++i) {
+    delete sources_[i];
+  }
+  delete thread_pool_;
+  delete render_task_;
+  delete bus_filter_;
+  delete fifo_;
+  delete fifo_processor_;
+  delete reberation_;
+  delete fdn_reverb_;
+  delete hrtf_;
+}
+
+int Audio3DScene::GetSampleRate() const {
+  return sample_rate_;
+}
+
+int Audio3DScene::GetBlockSize() const {
+  return block_size_;
+}
+
+void Audio3DScene::SetNumThreads(int num_threads) {
+  delete thread_pool_;
+  thread_pool_ = new ThreadPool(num_threads);
+  thread_pool_->SetRealtimePriority();
+}
+
+int Audio3DScene::GetNumThreads() const {
+  return thread_pool_->GetNumWorkers();
+}
+
+const ThreadPool::Stats& Audio3DScene::GetSchedulerStats() const {
+  return thread_pool_->GetLastStats();
+}
+
+void Audio3DScene::SetSummationMode(SummationMode summation_mode) {
+  assert(!rendering_started_ && "Sources keep the state of one mode");
+  summation_mode_ = summation_mode;
+}
+
+Audio3DScene::SummationMode Audio3DScene::GetSummationMode() const {
+  return summation_mode_;
+}
+
+void Audio3DScene::SetReverbMode(ReverbMode reverb_mode) {
+  assert(!rendering_started_ && "The other reverb holds no tail");
+  if (reverb_mode != reverb_mode_) {
+    reverb_mode_ = reverb_mode;
+    CreateReverb();
+  }
+}
+
+Audio3DScene::ReverbMode Audio3DScene::GetReverbMode() const {
+  return reverb_mode_;
+}
+
+void Audio3DScene::SetFDNReverbTime(float low_reverb_time,
+                                    float high_reverb_time) {
+  fdn_low_reverb_time_ = low_reverb_time;
+  fdn_high_reverb_time_ = high_reverb_time;
+  if (fdn_reverb_) {
+    fdn_reverb_->SetReberationTime(low_reverb_time, high_reverb_time);
+  }
+}
+
+void Audio3DScene::CreateReverb() {
+  delete reberation_;
+  delete fdn_reverb_;
+  reberation_ = 0;
+  fdn_reverb_ = 0;
+  if (reverb_mode_ == kFDNReverb) {
+    fdn_reverb_ = new FDNReverb(block_size_, sample_rate_,
+                                kReberationDuration, kFDNReverbLines);
+    fdn_reverb_->SetReberationTime(fdn_low_reverb_time_,
+                                   fdn_high_reverb_time_);
+  } else {
+    reberation_ = new Reberation(kReberationSize, sample_rate_,
+                                 kReberationDuration);
+  }
+}
+
+void Audio3DScene::UseHalfFloatHRTFBank() {
+  assert(sources_.empty() && "Sources hold kernels of the float bank");
+  hrtf_->ConvertFreqDomainBankToHalfFloat();
+}
+
+int Audio3DScene::AddSource() {
+  sources_.push_back(new Audio3DSource(*hrtf_, block_size_));
+  SourceOutput source_output;
+  source_output.input.resize(block_size_);
+  source_output.left.resize(block_size_);
+  source_output.right.resize(block_size_);
+  source_output.reverb_send.resize(block_size_);
+  source_output.spectrum_left.resize(2 * block_size_ + 2);
+  source_output.spectrum_right.resize(2 * block_size_ + 2);
+  source_output.silent = false;
+  source_outputs_.push_back(source_output);
+  input_channel_pointers_.resize(sources_.size());
+  fifo_->SetNumInputChannels(sources_.size());
+  source_x_.push_back(0.0f);
+  source_y_.push_back(0.0f);
+  source_z_.push_back(0.0f);
+  source_positioned_.push_back(false);
+  source_elevation_deg_.push_back(0.0f);
+  source_azimuth_deg_.push_back(0.0f);
+  source_distance_.push_back(0.0f);
+  source_audibility_.push_back(0.0f);
+  voices_.reserve(sources_.size());
+  source_distance_gain_.push_back(0.0f);
+  distance_order_.push_back(sources_.size() - 1);
+  pending_switches_.reserve(sources_.size());
+  switch_priority_.push_back(0.0f);
+  num_blocks_deferred_.push_back(0);
+  ApplyQualityLevel();
+  return sources_.size() - 1;
+}
+
+int Audio3DScene::GetNumSources() const {
+  return sources_.size();
+}
+
+Audio3DSource* Audio3DScene::GetSource(int source_id) {
+  assert(source_id >= 0 && source_id < sources_.size());
+  return sources_[source_id];
+}
+
+void Audio3DScene::SetSourcePosition(int source_id, float x, float y,
+                                     float z) {
+  assert(source_id >= 0 && source_id < sources_.size());
+  source_x_[source_id] = x;
+  source_y_[source_id] = y;
+  source_z_[source_id] = z;
+  if (!source_positioned_[source_id]) {
+    source_positioned_[source_id] = true;
+    ++num_positioned_sources_;
+  }
+}
+
+void Audio3DScene::SetListenerPose(const ListenerPose& listener_pose) {
+  listener_pose_ = listener_pose;
+}
+
+const ListenerPose& Audio3DScene::GetListenerPose() const {
+  return listener_pose_;
+}
+
+void Audio3DScene::UpdateSourceDirections() {
+  if (num_positioned_sources_ == 0) {
+    return;
+  }
+  TransformToSpherical(listener_pose_, &source_x_[0], &source_y_[0],
+                       &source_z_[0], sources_.size(),
+                       &source_elevation_deg_[0], &source_azimuth_deg_[0],
+                       &source_distance_[0]);
+  for (int s = 0; s < sources_.size(); ++s) {
+    if (source_positioned_[s]) {
+      sources_[s]->SetDirection(source_elevation_deg_[s],
+                                source_azimuth_deg_[s], source_distance_[s]);
+    }
+  }
+}
+
+void Audio3DScene::SetAudibilityThreshold(float threshold) {
+  assert(threshold >= 0.0f);
+  audibility_threshold_ = threshold;
+}
+
+void Audio3DScene::SetMaxVoices(int max_voices) {
+  max_voices_ = max_voices;
+}
+
+int Audio3DScene::GetMaxVoices() const {
+  return max_voices_;
+}
+
+int Audio3DScene::GetNumVirtualSources() const {
+  return num_virtual_sources_;
+}
+
+float Audio3DScene::GetInputLevel(int source_id) const {
+  float energy = 0.0f;
+  if (input_channels_) {
+    const float* input = input_channels_[source_id];
+    for (int i = 0; i < block_size_; ++i) {
+      energy += input[i] * input[i];
+    }
+  } else {
+    int num_channels = sources_.size();
+    for (int i = 0; i < block_size_; ++i) {
+      float sample = input_[i * num_channels + source_id];
+      energy += sample * sample;
+    }
+  }
+  return sqrt(energy / block_size_);
+}
+
+void Audio3DScene::UpdateVirtualSources() {
+  if (audibility_threshold_ == 0.0f && max_voices_ <= 0) {
+    if (num_virtual_sources_ > 0) {
+      for (int s = 0; s < sources_.size(); ++s) {
+        sources_[s]->SetVirtual(false);
+      }
+      num_virtual_sources_ = 0;
+    }
+    return;
+  }
+
+  voices_.clear();
+  for (int s = 0; s < sources_.size(); ++s) {
+    source_audibility_[s] = sources_[s]->GetDistanceGain()
+        * GetInputLevel(s);
+    if (source_audibility_[s] >= audibility_threshold_) {
+      voices_.push_back(s);
+    }
+  }
+  int num_voices = voices_.size();
+  if (max_voices_ > 0 && num_voices > max_voices_) {
+    std::nth_element(voices_.begin(), voices_.begin() + max_voices_,
+                     voices_.end(), HigherValue(source_audibility_));
+    num_voices = max_voices_;
+  }
+
+  for (int s = 0; s < sources_.size(); ++s) {
+    sources_[s]->SetVirtual(true);
+  }
+  for (int v = 0; v < num_voices; ++v) {
+    sources_[voices_[v]]->SetVirtual(false);
+  }
+  num_virtual_sources_ = sources_.size() - num_voices;
+}
+
+void Audio3DScene::SetCPUBudget(float budget) {
+  assert(budget >= 0.0f);
+  cpu_budget_ = budget;
+  if (cpu_budget_ == 0.0f && governor_stats_.quality_level > 0) {
+    governor_stats_.quality_level = 0;
+    ApplyQualityLevel();
+  }
+  num_blocks_below_budget_ = 0;
+}
+
+float Audio3DScene::GetCPUBudget() const {
+  return cpu_budget_;
+}
+
+const Audio3DScene::GovernorStats& Audio3DScene::GetGovernorStats() const {
+  return governor_stats_;
+}
+
+void Audio3DScene::UpdateGovernor(double render_seconds) {
+  governor_stats_.last_render_seconds = render_seconds;
+  if (cpu_budget_ == 0.0f) {
+    return;
+  }
+  double budget_seconds = static_cast<double>(cpu_budget_) * block_size_
+      / sample_rate_;
+  if (render_seconds > budget_seconds) {
+    ++governor_stats_.num_blocks_over_budget;
+    num_blocks_below_budget_ = 0;
+    if (governor_stats_.quality_level < kMaxQualityLevel) {
+      ++governor_stats_.quality_level;
+      ++governor_stats_.num_step_downs;
+    }
+  } else if (render_seconds < kGovernorRecoveryLoad * budget_seconds) {
+    ++num_blocks_below_budget_;
+    if (num_blocks_below_budget_ >= kGovernorRecoveryBlocks
+        && governor_stats_.quality_level > 0) {
+      --governor_stats_.quality_level;
+      ++governor_stats_.num_step_ups;
+      num_blocks_below_budget_ = 0;
+    }
+  } else {
+    num_blocks_below_budget_ = 0;
+  }
+}
+
+void Audio3DScene::ApplyQualityLevel() {
+  int level = governor_stats_.quality_level;
+  int num_distant = 0;
+  if (level >= 2) {
+    for (int s = 0; s < sources_.size(); ++s) {
+      source_distance_gain_[s] = sources_[s]->GetDistanceGain();
+    }
+    num_distant = sources_.size() / 2;
+    std::nth_element(distance_order_.begin(),
+                     distance_order_.begin() + num_distant,
+                     distance_order_.end(),
+                     MoreDistant(source_distance_gain_));
+  }
+  for (int i = 0; i < distance_order_.size(); ++i) {
+    Audio3DSource* source = sources_[distance_order_[i]];
+    bool distant = i < num_distant;
+    Audio3DSource::QualityTier limit = Audio3DSource::kFullHRTF;
+    if (level >= 4) {
+      limit = distant ? Audio3DSource::kParametric
+          : Audio3DSource::kTruncatedHRTF;
+    } else if (level >= 3 && distant) {
+      limit = Audio3DSource::kTruncatedHRTF;
+    }
+    source->SetGovernorLimits(limit,
+                              level >= 1 ? kGovernorHysteresisDeg : 0.0f,
+                              distant);
+  }
+}
+
+void Audio3DScene::SetMaxHRTFSwitchesPerBlock(int max_switches) {
+  max_hrtf_switches_per_block_ = max_switches;
+}
+
+int Audio3DScene::GetMaxHRTFSwitchesPerBlock() const {
+  return max_hrtf_switches_per_block_;
+}
+
+int Audio3DScene::GetNumDeferredHRTFSwitches() const {
+  return num_deferred_hrtf_switches_;
+}
+
+void Audio3DScene::ScheduleHRTFSwitches() {
+  num_deferred_hrtf_switches_ = 0;
+  if (max_hrtf_switches_per_block_ <= 0) {
+    return;
+  }
+  pending_switches_.clear();
+  for (int s = 0; s < sources_.size(); ++s) {
+    Audio3DSource* source = sources_[s];
+    if (source->IsVirtual() || !source->IsHRTFSwitchPending()) {
+      num_blocks_deferred_[s] = 0;
+      continue;
+    }
+    // Silent sources still get a small priority that grows while waiting.
+    float loudness = source->GetDistanceGain() * GetInputLevel(s) + 1e-6f;
+    switch_priority_[s] = source->GetHRTFDirectionError() * loudness
+        * (1 + num_blocks_deferred_[s]);
+    pending_switches_.push_back(s);
+  }
+  if (pending_switches_.size() <= max_hrtf_switches_per_block_) {
+    return;
+  }
+
+  std::nth_element(pending_switches_.begin(),
+                   pending_switches_.begin() + max_hrtf_switches_per_block_,
+                   pending_switches_.end(), HigherValue(switch_priority_));
+  for (int i = max_hrtf_switches_per_block_; i < pending_switches_.size();
+       ++i) {
+    int s = pending_switches_[i];
+    sources_[s]->DeferHRTFSwitch();
+    ++num_blocks_deferred_[s];
+  }
+  num_deferred_hrtf_switches_ = pending_switches_.size()
+      - max_hrtf_switches_per_block_;
+}
+
+void Audio3DScene::RenderSources(float* output_left, float* output_right,
+                                 int output_stride) {
+  assert(output_left && output_right);
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  rendering_started_ = true;
+  UpdateSourceDirections();
+  UpdateVirtualSources();
+  if (cpu_budget_ > 0.0f) {
+    ApplyQualityLevel();
+  }
+  ScheduleHRTFSwitches();
+  thread_pool_->ParallelFor(sources_.size(), render_task_);
+  input_ = 0;
+  input_channels_ = 0;
+
+  // Fixed-order reduction of the sources.
+  bus_left_.assign(block_size_, 0.0f);
+  bus_right_.assign(block_size_, 0.0f);
+  reverb_send_bus_.assign(block_size_, 0.0f);
+  for (int s = 0; s < source_outputs_.size(); ++s) {
+    const SourceOutput& source_output = source_outputs_[s];
+    if (source_output.silent) {
+      continue;
+    }
+    for (int i = 0; i < block_size_; ++i) {
+      bus_left_[i] += source_output.left[i];
+      bus_right_[i] += source_output.right[i];
+      reverb_send_bus_[i] += source_output.reverb_send[i];
+    }
+  }
+  if (summation_mode_ == kFrequencyDomainSummation) {
+    spectrum_bus_left_.assign(2 * block_size_ + 2, 0.0f);
+    spectrum_bus_right_.assign(2 * block_size_ + 2, 0.0f);
+    for (int s = 0; s < source_outputs_.size(); ++s) {
+      const SourceOutput& source_output = source_outputs_[s];
+      if (source_output.silent) {
+        continue;
+      }
+      for (int i = 0; i < spectrum_bus_left_.size(); ++i) {
+        spectrum_bus_left_[i] += source_output.spectrum_left[i];
+        spectrum_bus_right_[i] += source_output.spectrum_right[i];
+      }
+    }
+    AddSpectrumBus(spectrum_bus_left_, &bus_tail_left_, &bus_left_);
+    AddSpectrumBus(spectrum_bus_right_, &bus_tail_right_, &bus_right_);
+  }
+
+  OutputStageInput stage;
+  stage.next_left = &bus_left_[0];
+  stage.next_right = &bus_right_[0];
+  stage.previous_left = 0;
+  stage.previous_right = 0;
+  stage.fade_in_window = 0;
+  if (reverb_mode_ == kFDNReverb) {
+    fdn_reverb_->ProcessReberation(reverb_send_bus_, &stage.reverb_left,
+                                   &stage.reverb_right);
+  } else {
+    reberation_->ProcessReberation(reverb_send_bus_, &stage.reverb_left,
+                                   &stage.reverb_right);
+  }
+  stage.start_gain = 1.0f;
+  stage.end_gain = 1.0f;
+  RenderOutputStage(stage, block_size_, output_left, output_right,
+                    output_stride);
+
+  UpdateGovernor(std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count());
+}
+
+void Audio3DScene::RenderSource(int source_id) {
+  SourceOutput& source_output = source_outputs_[source_id];
+  if (input_channels_) {
+    source_output.input.assign(input_channels_[source_id],
+                               input_channels_[source_id] + block_size_);
+  } else {
+    assert(input_);
+    int num_channels = sources_.size();
+    for (int i = 0; i < block_size_; ++i) {
+      source_output.input[i] = input_[i * num_channels + source_id];
+    }
+  }
+
+  // A virtual source only advances its clock and renders silence, which
+  // the reduction skips.
+  source_output.silent = sources_[source_id]->IsVirtual();
+  if (summation_mode_ == kFrequencyDomainSummation) {
+    if (!source_output.silent) {
+      source_output.spectrum_left.assign(2 * block_size_ + 2, 0.0f);
+      source_output.spectrum_right.assign(2 * block_size_ + 2, 0.0f);
+    }
+    sources_[source_id]->ProcessBlock(source_output.input,
+                                      &source_output.spectrum_left,
+                                      &source_output.spectrum_right,
+                                      &source_output.left,
+                                      &source_output.right);
+  } else {
+    sources_[source_id]->ProcessBlock(source_output.input,
+                                      &source_output.left,
+                                      &source_output.right);
+  }
+  if (!source_output.silent) {
+    source_output.reverb_send.assign(block_size_, 0.0f);
+    sources_[source_id]->AddReverbSend(&source_output.reverb_send);
+  }
+}
+
+void Audio3DScene::AddSpectrumBus(const std::vector<float>& spectrum,
+                                  std::vector<float>* tail,
+                                  std::vector<float>* bus) {
+  assert(tail && bus);
+  bus_filter_->InverseTransform(spectrum, &bus_signal_);
+  for (int i = 0; i < block_size_; ++i) {
+    (*bus)[i] += bus_signal_[i] + (*tail)[i];
+    (*tail)[i] = bus_signal_[block_size_ + i];
+  }
+}
+
+void Audio3DScene::ProcessBlock(const std::vector<std::vector<float> >& inputs,
+                                float* output) {
+  ProcessBlock(inputs, output, output + 1, 2);
+}
+
+void Audio3DScene::ProcessBlock(const std::vector<std::vector<float> >& inputs,
+                                float* output_left, float* output_right) {
+  ProcessBlock(inputs, output_left, output_right, 1);
+}
+
+void Audio3DScene::ProcessBlock(const std::vector<std::vector<float> >& inputs,
+                                float* output_left, float* output_right,
+                                int output_stride) {
+  assert(inputs.size() == sources_.size());
+  for (int s = 0; s < inputs.size(); ++s) {
+    assert(inputs[s].size() == block_size_);
+    input_channel_pointers_[s] = &inputs[s][0];
+  }
+  ProcessBlock(input_channel_pointers_.empty() ? 0
+                   : &input_channel_pointers_[0],
+               output_left, output_right, output_stride);
+}
+
+void Audio3DScene::ProcessBlock(const float* input, float* output_left,
+                                float* output_right, int output_stride) {
+  assert(input || sources_.empty());
+  input_ = input;
+  RenderSources(output_left, output_right, output_stride);
+}
+
+void Audio3DScene::ProcessBlock(const float* const* input_channels,
+                                float* output_left, float* output_right,
+                                int output_stride) {
+  assert(input_channels || sources_.empty());
+  input_channels_ = input_channels;
+  RenderSources(output_left, output_right, output_stride);
+}
+
+void Audio3DScene::ProcessFrames(const float* input, int num_frames,
+                                 float* output_left, float* output_right,
+                                 int output_stride) {
+  fifo_->Process(input, num_frames, fifo_processor_, output_left,
+                 output_right, output_stride);
+}
+
+int Audio3DScene::GetFifoLatency() const {
+  return fifo_->GetLatency();
+}
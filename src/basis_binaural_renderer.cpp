@@ -0,0 +1,109 @@
+#include <assert.h>
+
+#include "basis_binaural_renderer.h"
+#include "delay_line.h"
+#include "fft_filter.h"
+#include "hrtf.h"
+#include "hrtf_basis.h"
+
+BasisBinauralRenderer::BasisBinauralRenderer(const HRTF& hrtf,
+                                             const HRTFBasis& basis,
+                                             int block_size)
+    : BinauralBusRenderer(hrtf, block_size),
+      basis_(basis),
+      num_buses_(basis.GetNumBasisFilters() + 1) {
+  assert(basis_.GetFilterSize() <= block_size_);
+  for (int ear = 0; ear < 2; ++ear) {
+    buses_[ear].assign(num_buses_, std::vector<float>(block_size_, 0.0f));
+    for (int bus = 0; bus < num_buses_; ++bus) {
+      FFTFilter* filter = new FFTFilter(block_size_);
+      filter->SetTimeDomainKernel(
+          bus == 0 ? basis_.GetMeanFilter() : basis_.GetBasisFilter(bus - 1));
+      bus_filters_[ear].push_back(filter);
+    }
+  }
+}
+
+BasisBinauralRenderer::~BasisBinauralRenderer() {
+  for (int ear = 0; ear < 2; ++ear) {
+    for (int bus = 0; bus < num_buses_; ++bus) {
+      delete bus_filters_[ear][bus];
+    }
+  }
+  for (int i = 0; i < sources_.size(); ++i) {
+    delete sources_[i].delay_line;
+  }
+}
+
+int BasisBinauralRenderer::AddSource() {
+  Source source;
+  source.delay_line = new DelayLine(hrtf_.GetFilterSize(), block_size_);
+  for (int ear = 0; ear < 2; ++ear) {
+    source.delay[ear] = 0.0f;
+    source.target_delay[ear] = 0.0f;
+    source.gains[ear].assign(num_buses_, 0.0f);
+    source.target_gains[ear].assign(num_buses_, 0.0f);
+  }
+  sources_.push_back(source);
+  return sources_.size() - 1;
+}
+
+void BasisBinauralRenderer::SetSourceDirection(int source_id,
+                                               float elevation_deg,
+                                               float azimuth_deg,
+                                               float distance) {
+  assert(source_id >= 0 && source_id < sources_.size());
+  Source& source = sources_[source_id];
+
+  bool left_right_swap;
+  int hrtf_index = hrtf_.FindHRTF(elevation_deg, azimuth_deg,
+                                  &left_right_swap);
+  float damping = GetDistanceDamping(distance);
+
+  source.target_delay[0] = hrtf_.GetLeftEarDelay(hrtf_index, left_right_swap);
+  source.target_delay[1] = hrtf_.GetRightEarDelay(hrtf_index, left_right_swap);
+  const std::vector<float>* weights[2] = { &basis_.GetLeftEarWeights(
+      hrtf_index, left_right_swap), &basis_.GetRightEarWeights(
+      hrtf_index, left_right_swap) };
+  for (int ear = 0; ear < 2; ++ear) {
+    source.target_gains[ear][0] = damping;
+    for (int bus = 1; bus < num_buses_; ++bus) {
+      source.target_gains[ear][bus] = damping * (*weights[ear])[bus - 1];
+    }
+  }
+}
+
+void BasisBinauralRenderer::AddSourceBlock(int source_id,
+                                           const std::vector<float>& input) {
+  assert(source_id >= 0 && source_id < sources_.size());
+  Source& source = sources_[source_id];
+
+  source.delay_line->AddSignalBlock(input);
+  for (int ear = 0; ear < 2; ++ear) {
+    source.delay_line->GetResult(source.delay[ear], source.target_delay[ear],
+                                 &delayed_input_);
+    source.delay[ear] = source.target_delay[ear];
+    for (int bus = 0; bus < num_buses_; ++bus) {
+      MixWithGainRamp(delayed_input_, source.gains[ear][bus],
+                      source.target_gains[ear][bus], &buses_[ear][bus]);
+      source.gains[ear][bus] = source.target_gains[ear][bus];
+    }
+  }
+}
+
+void BasisBinauralRenderer::ProcessBlock(std::vector<float>* output_left,
+                                         std::vector<float>* output_right) {
+  assert(output_left && output_right);
+  std::vector<float>* outputs[2] = { output_left, output_right };
+  for (int ear = 0; ear < 2; ++ear) {
+    outputs[ear]->assign(block_size_, 0.0f);
+    for (int bus = 0; bus < num_buses_; ++bus) {
+      bus_filters_[ear][bus]->AddSignalBlock(buses_[ear][bus]);
+      bus_filters_[ear][bus]->GetResult(&filtered_bus_);
+      for (int i = 0; i < block_size_; ++i) {
+        (*outputs[ear])[i] += filtered_bus_[i];
+      }
+      buses_[ear][bus].assign(block_size_, 0.0f);
+    }
+  }
+}
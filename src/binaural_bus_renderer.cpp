@@ -0,0 +1,56 @@
+#include <assert.h>
+#include <cmath>
+
+#include "binaural_bus_renderer.h"
+#include "hrtf.h"
+
+BinauralBusRenderer::BinauralBusRenderer(const HRTF& hrtf, int block_size)
+    : hrtf_(hrtf),
+      block_size_(block_size) {
+}
+
+BinauralBusRenderer::~BinauralBusRenderer() {
+}
+
+void BinauralBusRenderer::DirectionToVector(float elevation_deg,
+                                            float azimuth_deg,
+                                            float direction[3]) {
+  float elevation = elevation_deg * M_PI / 180.0f;
+  float azimuth = azimuth_deg * M_PI / 180.0f;
+  direction[0] = cos(elevation) * cos(azimuth);
+  direction[1] = -cos(elevation) * sin(azimuth);
+  direction[2] = sin(elevation);
+}
+
+void BinauralBusRenderer::VectorToDirection(const float direction[3],
+                                            float* elevation_deg,
+                                            float* azimuth_deg) {
+  float z = fmax(-1.0f, fmin(1.0f, direction[2]));
+  *elevation_deg = asin(z) * 180.0f / M_PI;
+  *azimuth_deg = atan2(-direction[1], direction[0]) * 180.0f / M_PI;
+}
+
+float BinauralBusRenderer::GetDistanceDamping(float distance) const {
+  float hrtf_distance = hrtf_.GetDistance();
+  return hrtf_distance / fmax(distance, hrtf_distance);
+}
+
+void BinauralBusRenderer::MixWithGainRamp(const std::vector<float>& input,
+                                          float start_gain, float end_gain,
+                                          std::vector<float>* bus) const {
+  assert(bus);
+  assert(input.size() == block_size_ && bus->size() == block_size_);
+  if (start_gain == end_gain) {
+    if (start_gain == 0.0f) {
+      return;
+    }
+    for (int i = 0; i < block_size_; ++i) {
+      (*bus)[i] += input[i] * start_gain;
+    }
+    return;
+  }
+  float gain_step = (end_gain - start_gain) / block_size_;
+  for (int i = 0; i < block_size_; ++i) {
+    (*bus)[i] += input[i] * (start_gain + gain_step * (i + 1));
+  }
+}
@@ -0,0 +1,67 @@
+#include <algorithm>
+#include <assert.h>
+
+#include "block_fifo.h"
+
+BlockFifo::BlockFifo(int block_size, int num_input_channels)
+    : block_size_(block_size),
+      fifo_pos_(0),
+      output_left_(block_size, 0.0f),
+      output_right_(block_size, 0.0f) {
+  assert(block_size_ > 0);
+  SetNumInputChannels(num_input_channels);
+}
+
+BlockFifo::~BlockFifo() {
+}
+
+void BlockFifo::SetNumInputChannels(int num_input_channels) {
+  assert(num_input_channels >= 0);
+  input_channels_.resize(num_input_channels,
+                         std::vector<float>(block_size_, 0.0f));
+  input_channel_pointers_.resize(num_input_channels);
+  for (int c = 0; c < num_input_channels; ++c) {
+    input_channel_pointers_[c] = &input_channels_[c][0];
+  }
+}
+
+int BlockFifo::GetNumInputChannels() const {
+  return input_channels_.size();
+}
+
+int BlockFifo::GetLatency() const {
+  return block_size_;
+}
+
+void BlockFifo::Process(const float* input, int num_frames,
+                        Processor* processor, float* output_left,
+                        float* output_right, int output_stride) {
+  assert(input || input_channels_.empty() || num_frames == 0);
+  assert(processor && output_left && output_right && output_stride > 0);
+  int num_channels = input_channels_.size();
+  int frame = 0;
+  while (frame < num_frames) {
+    int chunk = std::min(num_frames - frame, block_size_ - fifo_pos_);
+    for (int c = 0; c < num_channels; ++c) {
+      float* fifo_input = &input_channels_[c][fifo_pos_];
+      const float* host_input = input + frame * num_channels + c;
+      for (int i = 0; i < chunk; ++i) {
+        fifo_input[i] = host_input[i * num_channels];
+      }
+    }
+    for (int i = 0; i < chunk; ++i) {
+      output_left[(frame + i) * output_stride] = output_left_[fifo_pos_ + i];
+      output_right[(frame + i) * output_stride] =
+          output_right_[fifo_pos_ + i];
+    }
+    fifo_pos_ += chunk;
+    frame += chunk;
+
+    if (fifo_pos_ == block_size_) {
+      processor->ProcessFifoBlock(
+          input_channel_pointers_.empty() ? 0 : &input_channel_pointers_[0],
+          &output_left_[0], &output_right_[0]);
+      fifo_pos_ = 0;
+    }
+  }
+}
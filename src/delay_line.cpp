@@ -0,0 +1,188 @@
+#include <assert.h>
+#include <cmath>
+#include <cstring>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "delay_line.h"
+
+DelayLine::DelayLine(int max_delay, int block_size)
+    : max_delay_(max_delay),
+      block_size_(block_size),
+      signal_buffer_(max_delay + 1 + block_size, 0.0f) {
+  assert(max_delay_ >= 0 && block_size_ > 0);
+}
+
+DelayLine::~DelayLine() {
+}
+
+void DelayLine::AddSignalBlock(const std::vector<float>& signal_block) {
+  assert(
+      signal_block.size() == block_size_
+          && "Signal block size must match block size");
+  AddSignalBlock(&signal_block[0]);
+}
+
+void DelayLine::AddSignalBlock(const float* signal_block) {
+  assert(signal_block);
+  int history_len = max_delay_ + 1;
+  memmove(&signal_buffer_[0], &signal_buffer_[block_size_],
+          sizeof(float) * history_len);
+  memcpy(&signal_buffer_[history_len], signal_block,
+         sizeof(float) * block_size_);
+}
+
+void DelayLine::GetResult(float start_delay, float end_delay,
+                          std::vector<float>* signal_block) const {
+  assert(signal_block);
+  assert(start_delay >= 0.0f && start_delay <= max_delay_);
+  assert(end_delay >= 0.0f && end_delay <= max_delay_);
+  signal_block->resize(block_size_);
+
+  const float* current_block = &signal_buffer_[max_delay_ + 1];
+  float delay_step = (end_delay - start_delay) / block_size_;
+  for (int i = 0; i < block_size_; ++i) {
+    float delay = start_delay + delay_step * (i + 1);
+    int integer_delay = static_cast<int>(delay);
+    float fraction = delay - integer_delay;
+    const float* tap = current_block + i - integer_delay;
+    (*signal_block)[i] = tap[0] + fraction * (tap[-1] - tap[0]);
+  }
+}
+
+void DelayLine::ClearSignalHistory() {
+  memset(&signal_buffer_[0], 0, sizeof(float) * signal_buffer_.size());
+}
+
+namespace {
+
+// Coefficients of the third-order Lagrange interpolator for the taps at
+// integer delays d + 2, d + 1, d and d - 1, where |fraction| is the
+// fractional part of the delay d + fraction.
+inline void GetLagrangeCoefficients(float fraction, float coefficients[4]) {
+  float f_plus_1 = fraction + 1.0f;
+  float f_minus_1 = fraction - 1.0f;
+  float f_minus_2 = fraction - 2.0f;
+  coefficients[0] = f_plus_1 * fraction * f_minus_1 * (1.0f / 6.0f);
+  coefficients[1] = -f_plus_1 * fraction * f_minus_2 * 0.5f;
+  coefficients[2] = f_plus_1 * f_minus_1 * f_minus_2 * 0.5f;
+  coefficients[3] = -fraction * f_minus_1 * f_minus_2 * (1.0f / 6.0f);
+}
+
+#ifdef __SSE__
+// Interpolates four output samples. |taps|[k] points to the four input
+// samples of output k, oldest first.
+inline __m128 InterpolateFour(const float* const taps[4], __m128 fraction) {
+  __m128 one = _mm_set1_ps(1.0f);
+  __m128 f_plus_1 = _mm_add_ps(fraction, one);
+  __m128 f_minus_1 = _mm_sub_ps(fraction, one);
+  __m128 f_minus_2 = _mm_sub_ps(fraction, _mm_set1_ps(2.0f));
+  __m128 f_plus_1_f = _mm_mul_ps(f_plus_1, fraction);
+  __m128 f_minus_1_f_minus_2 = _mm_mul_ps(f_minus_1, f_minus_2);
+  __m128 c0 = _mm_mul_ps(_mm_mul_ps(f_plus_1_f, f_minus_1),
+                         _mm_set1_ps(1.0f / 6.0f));
+  __m128 c1 = _mm_mul_ps(_mm_mul_ps(f_plus_1_f, f_minus_2),
+                         _mm_set1_ps(-0.5f));
+  __m128 c2 = _mm_mul_ps(_mm_mul_ps(f_plus_1, f_minus_1_f_minus_2),
+                         _mm_set1_ps(0.5f));
+  __m128 c3 = _mm_mul_ps(_mm_mul_ps(fraction, f_minus_1_f_minus_2),
+                         _mm_set1_ps(-1.0f / 6.0f));
+
+  // Transposes the taps so that x<k> holds tap k of all four outputs.
+  __m128 x0 = _mm_loadu_ps(taps[0]);
+  __m128 x1 = _mm_loadu_ps(taps[1]);
+  __m128 x2 = _mm_loadu_ps(taps[2]);
+  __m128 x3 = _mm_loadu_ps(taps[3]);
+  _MM_TRANSPOSE4_PS(x0, x1, x2, x3);
+  return _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, x0), _mm_mul_ps(c1, x1)),
+                    _mm_add_ps(_mm_mul_ps(c2, x2), _mm_mul_ps(c3, x3)));
+}
+#endif
+
+}  // namespace
+
+FractionalDelayLine::FractionalDelayLine(int max_delay_capacity,
+                                         int block_size)
+    : block_size_(block_size),
+      max_delay_capacity_(max_delay_capacity),
+      max_delay_(max_delay_capacity),
+      previous_delay_(-1.0f),
+      buffer_mask_(0),
+      write_pos_(0) {
+  assert(max_delay_capacity_ >= 1 && block_size_ > 0);
+  // Room for the longest delay, the interpolation taps and one block.
+  int size = 1;
+  while (size < max_delay_capacity_ + block_size_ + 3) {
+    size *= 2;
+  }
+  buffer_mask_ = size - 1;
+  buffer_.resize(2 * size, 0.0f);
+}
+
+FractionalDelayLine::~FractionalDelayLine() {
+}
+
+void FractionalDelayLine::SetMaxDelay(int max_delay) {
+  assert(max_delay >= 1 && max_delay <= max_delay_capacity_);
+  max_delay_ = max_delay;
+}
+
+int FractionalDelayLine::GetMaxDelay() const {
+  return max_delay_;
+}
+
+int FractionalDelayLine::GetMaxDelayCapacity() const {
+  return max_delay_capacity_;
+}
+
+void FractionalDelayLine::Process(const float* input, float delay,
+                                  float* output) {
+  assert(input && output);
+  int size = buffer_mask_ + 1;
+  // Write the block first; the read position of every output sample then
+  // trails its own input sample.
+  int block_start = write_pos_;
+  for (int i = 0; i < block_size_; ++i) {
+    int pos = (write_pos_ + i) & buffer_mask_;
+    buffer_[pos] = input[i];
+    buffer_[pos + size] = input[i];
+  }
+  write_pos_ = (write_pos_ + block_size_) & buffer_mask_;
+
+  delay = std::fmin(std::fmax(delay, 1.0f), static_cast<float>(max_delay_));
+  float start_delay = previous_delay_ < 0.0f ? delay : previous_delay_;
+  start_delay = std::fmin(start_delay, static_cast<float>(max_delay_));
+  float delay_step = (delay - start_delay) / block_size_;
+  previous_delay_ = delay;
+
+  // The taps of output |i| start at the sample with delay
+  // integer_delay + 2 and cover four consecutive samples. Thanks to the
+  // mirrored copy they never wrap.
+  int i = 0;
+#ifdef __SSE__
+  for (; i + 4 <= block_size_; i += 4) {
+    const float* taps[4];
+    float fractions[4];
+    for (int k = 0; k < 4; ++k) {
+      float tap_delay = start_delay + delay_step * (i + k + 1);
+      int integer_delay = static_cast<int>(tap_delay);
+      fractions[k] = tap_delay - integer_delay;
+      taps[k] = &buffer_[(block_start + i + k - integer_delay - 2)
+          & buffer_mask_];
+    }
+    _mm_storeu_ps(output + i, InterpolateFour(taps, _mm_loadu_ps(fractions)));
+  }
+#endif
+  for (; i < block_size_; ++i) {
+    float tap_delay = start_delay + delay_step * (i + 1);
+    int integer_delay = static_cast<int>(tap_delay);
+    float coefficients[4];
+    GetLagrangeCoefficients(tap_delay - integer_delay, coefficients);
+    const float* taps = &buffer_[(block_start + i - integer_delay - 2)
+        & buffer_mask_];
+    output[i] = coefficients[0] * taps[0] + coefficients[1] * taps[1]
+        + coefficients[2] * taps[2] + coefficients[3] * taps[3];
+  }
+}
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "fdn_reverb.h"
+
+namespace {
+
+const int kMaxLines = 16;
+// Range of the delay line lengths in seconds. The lengths are spread
+// geometrically so that the echo density builds up quickly.
+const float kShortestDelay = 0.010f;
+const float kLongestDelay = 0.037f;
+
+bool IsPrime(int value) {
+  if (value < 2) {
+    return false;
+  }
+  for (int divisor = 2; divisor * divisor <= value; ++divisor) {
+    if (value % divisor == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#ifdef __SSE__
+// Walsh-Hadamard transform within the four lanes of |x|.
+inline __m128 Hadamard4(__m128 x) {
+  __m128 even = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 0, 0));
+  __m128 odd = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 1, 1));
+  x = _mm_add_ps(even, _mm_mul_ps(odd, _mm_setr_ps(1.0f, -1.0f, 1.0f,
+                                                   -1.0f)));
+  __m128 low = _mm_movelh_ps(x, x);
+  __m128 high = _mm_movehl_ps(x, x);
+  return _mm_add_ps(low, _mm_mul_ps(high, _mm_setr_ps(1.0f, 1.0f, -1.0f,
+                                                      -1.0f)));
+}
+#else
+// Unnormalized Walsh-Hadamard transform of |num_lines| values.
+void Hadamard(int num_lines, float* values) {
+  for (int half = 1; half < num_lines; half *= 2) {
+    for (int i = 0; i < num_lines; i += 2 * half) {
+      for (int j = i; j < i + half; ++j) {
+        float a = values[j];
+        float b = values[j + half];
+        values[j] = a + b;
+        values[j + half] = a - b;
+      }
+    }
+  }
+}
+#endif
+
+}  // namespace
+
+FDNReverb::FDNReverb(int block_size, int sampling_rate,
+                     float reberation_time, int num_lines)
+    : block_size_(block_size),
+      sampling_rate_(sampling_rate),
+      num_lines_(num_lines),
+      buffer_mask_(0),
+      write_pos_(0) {
+  assert(block_size_ > 0 && sampling_rate_ > 0);
+  assert((num_lines_ == 8 || num_lines_ == 16) && num_lines_ <= kMaxLines);
+
+  // Mutually prime lengths avoid coinciding echoes.
+  int previous_delay = 0;
+  for (int i = 0; i < num_lines_; ++i) {
+    float seconds = kShortestDelay * pow(kLongestDelay / kShortestDelay,
+                                         static_cast<float>(i)
+                                         / (num_lines_ - 1));
+    int delay = std::max(static_cast<int>(seconds * sampling_rate_),
+                         previous_delay + 1);
+    while (!IsPrime(delay)) {
+      ++delay;
+    }
+    delays_.push_back(delay);
+    previous_delay = delay;
+  }
+
+  int num_frames = 1;
+  while (num_frames <= delays_.back()) {
+    num_frames *= 2;
+  }
+  buffer_mask_ = num_frames - 1;
+  buffer_.resize(num_frames * num_lines_, 0.0f);
+
+  filter_b0_.resize(num_lines_);
+  filter_a1_.resize(num_lines_);
+  filter_state_.resize(num_lines_, 0.0f);
+  SetReberationTime(reberation_time, reberation_time);
+
+  output_left_.resize(block_size_, 0.0f);
+  output_right_.resize(block_size_, 0.0f);
+}
+
+FDNReverb::~FDNReverb() {
+}
+
+int FDNReverb::GetNumLines() const {
+  return num_lines_;
+}
+
+const std::vector<int>& FDNReverb::GetDelays() const {
+  return delays_;
+}
+
+void FDNReverb::SetReberationTime(float low_reberation_time,
+                                  float high_reberation_time) {
+  assert(low_reberation_time > 0.0f && high_reberation_time > 0.0f);
+  for (int i = 0; i < num_lines_; ++i) {
+    // Gain of one pass through the line for a decay of 60 dB per
+    // reberation time.
+    float seconds = static_cast<float>(delays_[i]) / sampling_rate_;
+    float low_gain = pow(10.0f, -3.0f * seconds / low_reberation_time);
+    float high_gain = pow(10.0f, -3.0f * seconds / high_reberation_time);
+    // One-pole filter with a gain of |low_gain| at DC and |high_gain| at
+    // the Nyquist frequency.
+    filter_a1_[i] = (low_gain - high_gain) / (low_gain + high_gain);
+    filter_b0_[i] = low_gain * (1.0f - filter_a1_[i]);
+  }
+}
+
+void FDNReverb::ProcessReberation(const std::vector<float>& input,
+                                  const float** output_left,
+                                  const float** output_right) {
+  assert(output_left && output_right);
+  assert(input.size() <= block_size_);
+
+  // The Hadamard matrix is orthogonal once scaled by 1/sqrt(num_lines_),
+  // so all loss comes from the damping filters.
+  const float matrix_gain = 1.0f / sqrt(static_cast<float>(num_lines_));
+  float* buffer = &buffer_[0];
+  for (int i = 0; i < input.size(); ++i) {
+    float lines[kMaxLines];
+    for (int l = 0; l < num_lines_; ++l) {
+      lines[l] = buffer[((write_pos_ - delays_[l]) & buffer_mask_)
+                        * num_lines_ + l];
+    }
+    float* frame = buffer + write_pos_ * num_lines_;
+    float input_sample = input[i] * matrix_gain;
+
+#ifdef __SSE__
+    const int num_vectors = num_lines_ / 4;
+    __m128 x[kMaxLines / 4];
+    for (int v = 0; v < num_vectors; ++v) {
+      __m128 state = _mm_add_ps(
+          _mm_mul_ps(_mm_loadu_ps(&filter_b0_[4 * v]),
+                     _mm_loadu_ps(&lines[4 * v])),
+          _mm_mul_ps(_mm_loadu_ps(&filter_a1_[4 * v]),
+                     _mm_loadu_ps(&filter_state_[4 * v])));
+      _mm_storeu_ps(&filter_state_[4 * v], state);
+      x[v] = state;
+    }
+    // Butterflies between vectors, then within every vector.
+    for (int half = 1; half < num_vectors; half *= 2) {
+      for (int v = 0; v < num_vectors; v += 2 * half) {
+        for (int w = v; w < v + half; ++w) {
+          __m128 a = x[w];
+          x[w] = _mm_add_ps(a, x[w + half]);
+          x[w + half] = _mm_sub_ps(a, x[w + half]);
+        }
+      }
+    }
+    __m128 scale = _mm_set1_ps(matrix_gain);
+    __m128 feed = _mm_set1_ps(input_sample);
+    for (int v = 0; v < num_vectors; ++v) {
+      x[v] = Hadamard4(x[v]);
+      _mm_storeu_ps(frame + 4 * v, _mm_add_ps(_mm_mul_ps(x[v], scale),
+                                              feed));
+    }
+    _mm_storeu_ps(lines, x[0]);
+#else
+    for (int l = 0; l < num_lines_; ++l) {
+      filter_state_[l] = filter_b0_[l] * lines[l]
+          + filter_a1_[l] * filter_state_[l];
+      lines[l] = filter_state_[l];
+    }
+    Hadamard(num_lines_, lines);
+    for (int l = 0; l < num_lines_; ++l) {
+      frame[l] = lines[l] * matrix_gain + input_sample;
+    }
+#endif
+    // Rows 1 and 2 of the Hadamard matrix are orthogonal sign patterns and
+    // give two decorrelated outputs.
+    output_left_[i] = lines[1] * matrix_gain;
+    output_right_[i] = lines[2] * matrix_gain;
+    write_pos_ = (write_pos_ + 1) & buffer_mask_;
+  }
+  *output_left = &output_left_[0];
+  *output_right = &output_right_[0];
+}
@@ -26,6 +26,10 @@ void FFTFilter::SetFreqDomainKernel(const std::vector<float>& kernel) {
   fft_filter_impl_->SetFreqDomainKernel(kernel);
 }
 
+void FFTFilter::SetFreqDomainKernel(const std::vector<uint16_t>& half_kernel) {
+  fft_filter_impl_->SetFreqDomainKernel(half_kernel);
+}
+
 void FFTFilter::AddTimeDomainKernel(const std::vector<float>& kernel) {
   fft_filter_impl_->AddTimeDomainKernel(kernel);
 }
@@ -35,6 +39,11 @@ void FFTFilter::ForwardTransform(const vector<float>& time_signal,
   fft_filter_impl_->ForwardTransform(time_signal, freq_signal);
 }
 
+void FFTFilter::ForwardTransform(const float* time_signal,
+                                 vector<float>* freq_signal) const {
+  fft_filter_impl_->ForwardTransform(time_signal, freq_signal);
+}
+
 void FFTFilter::InverseTransform(const vector<float>& freq_signal,
                                  vector<float>* time_signal) const {
   fft_filter_impl_->InverseTransform(freq_signal, time_signal);
@@ -44,7 +53,15 @@ void FFTFilter::AddSignalBlock(const vector<float>& signal_block) {
   fft_filter_impl_->AddSignalBlock(signal_block);
 }
 
+void FFTFilter::AddSignalBlock(const float* signal_block) {
+  fft_filter_impl_->AddSignalBlock(signal_block);
+}
+
 void FFTFilter::GetResult(vector<float>* signal_block) {
   fft_filter_impl_->GetResult(signal_block);
 }
 
+void FFTFilter::ClearSignalHistory() {
+  fft_filter_impl_->ClearSignalHistory();
+}
+
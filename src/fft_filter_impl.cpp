@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <assert.h>
 #include <cmath>
 #include <string>
 #include "fft_filter_impl.h"
+#include "half_float.h"
 
 using namespace std;
 
@@ -12,10 +14,13 @@ FFTFilterImpl::FFTFilterImpl(int filter_len)
       kernel_defined_(false),
       kernel_time_domain_buffer_(fft_len_),
       kernel_freq_domain_buffer_(fft_len_ / 2 + 1),
+      kernel_half_precision_(false),
       buffer_selector_(0),
       signal_time_domain_buffer_(2, vector<kiss_fft_scalar>(fft_len_)),
       signal_freq_domain_buffer_(2, vector < kiss_fft_cpx > (fft_len_ / 2 + 1)),
-      filtered_freq_domain_buffer_(fft_len_ / 2 + 1) {
+      filtered_freq_domain_buffer_(fft_len_ / 2 + 1),
+      transform_time_domain_buffer_(fft_len_),
+      transform_freq_domain_buffer_(fft_len_ / 2 + 1) {
   bool is_power_of_two = ((fft_len_ != 0) && !(fft_len_ & (fft_len_ - 1)));
   assert(is_power_of_two && "Filter length must be a power of 2");
 
@@ -45,15 +50,24 @@ void FFTFilterImpl::Init() {
 
 void FFTFilterImpl::ForwardTransform(const vector<float>& time_signal,
                                      vector<float>* freq_signal) const {
-  assert(freq_signal);
   assert(
       time_signal.size() <= max_kernel_len_
           && "Kernel size must be <= max_kernel_len_");
+  ForwardTransform(time_signal.data(), time_signal.size(), freq_signal);
+}
 
-  vector<kiss_fft_scalar> time_domain_buffer(fft_len_);
-  VectorCopyWithZeroPadding(time_signal, &time_domain_buffer);
+void FFTFilterImpl::ForwardTransform(const float* time_signal,
+                                     vector<float>* freq_signal) const {
+  ForwardTransform(time_signal, max_kernel_len_, freq_signal);
+}
 
-  vector<kiss_fft_cpx> freq_domain_buffer(fft_len_ / 2 + 1);
+void FFTFilterImpl::ForwardTransform(const float* time_signal, int size,
+                                     vector<float>* freq_signal) const {
+  assert(freq_signal);
+  vector<kiss_fft_scalar>& time_domain_buffer = transform_time_domain_buffer_;
+  VectorCopyWithZeroPadding(time_signal, size, &time_domain_buffer);
+
+  vector<kiss_fft_cpx>& freq_domain_buffer = transform_freq_domain_buffer_;
 
   // Perform forward FFT transform
   kiss_fftr(forward_fft_, &time_domain_buffer[0], &freq_domain_buffer[0]);
@@ -74,7 +88,7 @@ void FFTFilterImpl::InverseTransform(const vector<float>& freq_signal,
       freq_signal.size() == fft_len_ + 2
           && "Frequency domain signal must match fft_len_+2");
 
-  vector<kiss_fft_cpx> freq_domain_buffer(fft_len_ / 2 + 1);
+  vector<kiss_fft_cpx>& freq_domain_buffer = transform_freq_domain_buffer_;
   vector<float>::const_iterator freq_in_itr = freq_signal.begin();
   for (int freq_c = 0; freq_c < freq_domain_buffer.size(); ++freq_c) {
     freq_domain_buffer[freq_c].r = *freq_in_itr;
@@ -112,9 +126,11 @@ void FFTFilterImpl::SetTimeDomainKernel(const std::vector<float>& kernel) {
             &kernel_freq_domain_buffer_[0]);
 
   kernel_defined_ = true;
+  kernel_half_precision_ = false;
 }
 
 void FFTFilterImpl::AddTimeDomainKernel(const vector<float>& kernel) {
+  ExpandHalfPrecisionKernel();
   vector<kiss_fft_cpx> temp_freq_domain_buffer(fft_len_ / 2 + 1);
 
   VectorCopyWithZeroPadding(kernel, &kernel_time_domain_buffer_);
@@ -141,9 +157,27 @@ void FFTFilterImpl::SetFreqDomainKernel(const std::vector<float>& kernel) {
   }
 
   kernel_defined_ = true;
+  kernel_half_precision_ = false;
+}
+
+void FFTFilterImpl::SetFreqDomainKernel(const vector<uint16_t>& half_kernel) {
+  assert(half_kernel.size() == fft_len_ + 2);
+  kernel_half_freq_domain_buffer_ = half_kernel;
+  kernel_defined_ = true;
+  kernel_half_precision_ = true;
+}
+
+void FFTFilterImpl::ExpandHalfPrecisionKernel() {
+  if (!kernel_half_precision_) {
+    return;
+  }
+  vector<float> kernel;
+  ConvertHalfToFloat(kernel_half_freq_domain_buffer_, &kernel);
+  SetFreqDomainKernel(kernel);
 }
 
 void FFTFilterImpl::AddFreqDomainKernel(const vector<float>& kernel) {
+  ExpandHalfPrecisionKernel();
   vector<kiss_fft_cpx> temp_freq_domain_buffer(fft_len_ / 2 + 1);
 
   vector<float>::const_iterator kernel_itr = kernel.begin();
@@ -163,17 +197,28 @@ void FFTFilterImpl::AddFreqDomainKernel(const vector<float>& kernel) {
 void FFTFilterImpl::VectorCopyWithZeroPadding(
     const vector<kiss_fft_scalar>& input,
     vector<kiss_fft_scalar>* output) const {
+  VectorCopyWithZeroPadding(input.data(), input.size(), output);
+}
+
+void FFTFilterImpl::VectorCopyWithZeroPadding(
+    const kiss_fft_scalar* input, int size,
+    vector<kiss_fft_scalar>* output) const {
   assert(output);
-  assert(input.size() <= output->size());
-  memcpy(&((*output)[0]), &input[0], sizeof(kiss_fft_scalar) * input.size());
-  memset(&((*output)[input.size()]), 0,
-         sizeof(kiss_fft_scalar) * (output->size() - input.size()));
+  assert(size <= output->size());
+  memcpy(&((*output)[0]), input, sizeof(kiss_fft_scalar) * size);
+  memset(&((*output)[size]), 0,
+         sizeof(kiss_fft_scalar) * (output->size() - size));
 }
 
 void FFTFilterImpl::AddSignalBlock(const vector<float>& signal_block) {
   assert(
       signal_block.size() == max_kernel_len_
           && "Signal block size must match filter length");
+  AddSignalBlock(&signal_block[0]);
+}
+
+void FFTFilterImpl::AddSignalBlock(const float* signal_block) {
+  assert(signal_block);
   assert(kernel_defined_ && "No suitable kernel defined");
 
   // Switch buffer selector
@@ -184,14 +229,20 @@ void FFTFilterImpl::AddSignalBlock(const vector<float>& signal_block) {
   vector<kiss_fft_cpx>& freq_domain_buffer =
       signal_freq_domain_buffer_[buffer_selector_];
 
-  VectorCopyWithZeroPadding(signal_block, &time_domain_buffer);
+  VectorCopyWithZeroPadding(signal_block, max_kernel_len_,
+                            &time_domain_buffer);
 
   // Perform forward FFT transform
   kiss_fftr(forward_fft_, &time_domain_buffer[0], &freq_domain_buffer[0]);
 
   // Complex vector product in frequency domain with transformed kernel.
-  ComplexVectorProduct(freq_domain_buffer, kernel_freq_domain_buffer_,
-                       &filtered_freq_domain_buffer_);
+  if (kernel_half_precision_) {
+    ComplexVectorProduct(freq_domain_buffer, kernel_half_freq_domain_buffer_,
+                         &filtered_freq_domain_buffer_);
+  } else {
+    ComplexVectorProduct(freq_domain_buffer, kernel_freq_domain_buffer_,
+                         &filtered_freq_domain_buffer_);
+  }
 
   // Perform inverse FFT transform of filtered_freq_domain_buffer_ and store result back in signal_time_domain_buffer_
   kiss_fftri(inverse_fft_, &filtered_freq_domain_buffer_[0],
@@ -218,6 +269,29 @@ void FFTFilterImpl::ComplexVectorProduct(const vector<kiss_fft_cpx>& input_a,
   }
 }
 
+void FFTFilterImpl::ComplexVectorProduct(const vector<kiss_fft_cpx>& input_a,
+                                         const vector<uint16_t>& half_input_b,
+                                         vector<kiss_fft_cpx>* result) const {
+  assert(result);
+  assert(2 * input_a.size() == half_input_b.size());
+
+  // Convert the kernel in chunks that stay in L1 cache.
+  static const int kChunkSize = 64;
+  float input_b[2 * kChunkSize];
+  result->resize(input_a.size());
+  for (int begin = 0; begin < input_a.size(); begin += kChunkSize) {
+    int size = std::min<int>(kChunkSize, input_a.size() - begin);
+    ConvertHalfToFloat(&half_input_b[2 * begin], 2 * size, input_b);
+    for (int i = 0; i < size; ++i) {
+      const kiss_fft_cpx& a = input_a[begin + i];
+      float b_real = input_b[2 * i];
+      float b_imag = input_b[2 * i + 1];
+      (*result)[begin + i].r = a.r * b_real - a.i * b_imag;
+      (*result)[begin + i].i = a.r * b_imag + a.i * b_real;
+    }
+  }
+}
+
 void FFTFilterImpl::GetResult(vector<float>* signal_block) {
   assert(signal_block);
   signal_block->resize(max_kernel_len_);
@@ -230,3 +304,10 @@ void FFTFilterImpl::GetResult(vector<float>* signal_block) {
   }
 }
 
+void FFTFilterImpl::ClearSignalHistory() {
+  for (int i = 0; i < 2; ++i) {
+    memset(&signal_time_domain_buffer_[i][0], 0,
+           sizeof(kiss_fft_scalar) * fft_len_);
+  }
+}
+
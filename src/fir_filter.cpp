@@ -0,0 +1,48 @@
+#include <assert.h>
+#include <cstring>
+
+#include "fir_filter.h"
+
+FIRFilter::FIRFilter(int max_kernel_len, int block_size)
+    : max_kernel_len_(max_kernel_len),
+      block_size_(block_size),
+      signal_buffer_(max_kernel_len - 1 + block_size, 0.0f) {
+  assert(max_kernel_len_ > 0 && block_size_ > 0);
+}
+
+FIRFilter::~FIRFilter() {
+}
+
+void FIRFilter::AddSignalBlock(const std::vector<float>& signal_block) {
+  assert(
+      signal_block.size() == block_size_
+          && "Signal block size must match block size");
+  int history_len = max_kernel_len_ - 1;
+  memmove(&signal_buffer_[0], &signal_buffer_[block_size_],
+          sizeof(float) * history_len);
+  memcpy(&signal_buffer_[history_len], &signal_block[0],
+         sizeof(float) * block_size_);
+}
+
+void FIRFilter::GetResult(const std::vector<float>& kernel,
+                          std::vector<float>* signal_block) const {
+  assert(signal_block);
+  assert(kernel.size() <= max_kernel_len_);
+  signal_block->assign(block_size_, 0.0f);
+
+  // Loop over taps first so that the inner loop runs over contiguous samples
+  // and vectorizes.
+  float* output = &(*signal_block)[0];
+  const float* current_block = &signal_buffer_[max_kernel_len_ - 1];
+  for (int tap = 0; tap < kernel.size(); ++tap) {
+    const float coefficient = kernel[tap];
+    const float* input = current_block - tap;
+    for (int i = 0; i < block_size_; ++i) {
+      output[i] += coefficient * input[i];
+    }
+  }
+}
+
+void FIRFilter::ClearSignalHistory() {
+  memset(&signal_buffer_[0], 0, sizeof(float) * signal_buffer_.size());
+}
@@ -0,0 +1,117 @@
+#include <assert.h>
+#include <cstring>
+
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+
+#include "half_float.h"
+
+uint16_t ConvertFloatToHalf(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t magnitude = bits & 0x7fffffff;
+
+  if (magnitude >= 0x7f800000) {
+    // Infinity stays infinity, NaN stays a quiet NaN.
+    return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+  }
+  if (magnitude >= 0x477ff000) {
+    return sign | 0x7c00;  // Rounds beyond the largest half, 65504.
+  }
+  if (magnitude < 0x38800000) {
+    // Subnormal half (below 2^-14) or zero.
+    if (magnitude < 0x33000000) {
+      return sign;
+    }
+    uint32_t exponent = magnitude >> 23;
+    uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+    uint32_t shift = 126 - exponent;
+    uint32_t half = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+      ++half;
+    }
+    return sign | half;
+  }
+
+  // Rebias the exponent from 127 to 15 and round off 13 mantissa bits. A
+  // carry into the exponent yields the correct next power of two.
+  uint32_t half = (magnitude - 0x38000000) >> 13;
+  uint32_t remainder = magnitude & 0x1fff;
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    ++half;
+  }
+  return sign | half;
+}
+
+float ConvertHalfToFloat(uint16_t value) {
+  uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1f;
+  uint32_t mantissa = value & 0x3ff;
+
+  uint32_t bits;
+  if (exponent == 0) {
+    // Zero or subnormal: mantissa * 2^-24.
+    float magnitude = mantissa * (1.0f / 16777216.0f);
+    memcpy(&bits, &magnitude, sizeof(bits));
+    bits |= sign;
+  } else if (exponent == 31) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+void ConvertFloatToHalf(const float* input, int size, uint16_t* output) {
+  assert(size == 0 || (input && output));
+  int i = 0;
+#ifdef __F16C__
+  for (; i + 8 <= size; i += 8) {
+    __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(input + i),
+                                   _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), half);
+  }
+#endif
+  for (; i < size; ++i) {
+    output[i] = ConvertFloatToHalf(input[i]);
+  }
+}
+
+void ConvertHalfToFloat(const uint16_t* input, int size, float* output) {
+  assert(size == 0 || (input && output));
+  int i = 0;
+#ifdef __F16C__
+  for (; i + 8 <= size; i += 8) {
+    __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input
+        + i));
+    _mm256_storeu_ps(output + i, _mm256_cvtph_ps(half));
+  }
+#endif
+  for (; i < size; ++i) {
+    output[i] = ConvertHalfToFloat(input[i]);
+  }
+}
+
+void ConvertFloatToHalf(const std::vector<float>& input,
+                        std::vector<uint16_t>* output) {
+  assert(output);
+  output->resize(input.size());
+  if (!input.empty()) {
+    ConvertFloatToHalf(&input[0], input.size(), &(*output)[0]);
+  }
+}
+
+void ConvertHalfToFloat(const std::vector<uint16_t>& input,
+                        std::vector<float>* output) {
+  assert(output);
+  output->resize(input.size());
+  if (!input.empty()) {
+    ConvertHalfToFloat(&input[0], input.size(), &(*output)[0]);
+  }
+}
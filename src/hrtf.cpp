@@ -1,45 +1,314 @@
-#include "hrtf_data.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
 #include "fft_filter.h"
+#include "half_float.h"
 #include "hrtf.h"
+#include "hrtf_data_source.h"
+#include "parametric_hrtf.h"
 #include "resampler.h"
+#include "thread_pool.h"
 #include "flann_nn_search.hpp"
 
-HRTF::HRTF(int sample_rate, int block_size)
+// Duration of the truncated minimum-phase HRTFs. Most of the energy of the
+// MIT KEMAR minimum-phase responses is contained in the first millisecond.
+static const float kMinimumPhaseFilterDurationSec = 0.0015f;
+
+namespace {
+
+// Stands in for a missing dataset with a single silent HRTF, so that an
+// invalid HRTF object can still be used without crashing.
+class SilentHRTFDataSource : public HRTFDataSource {
+ public:
+  explicit SilentHRTFDataSource(int sample_rate) {
+    identifier_ = "silent";
+    fir_length_ = 128;
+    sample_rate_ = sample_rate;
+    distance_ = 1.0f;
+    directions_.push_back(std::make_pair(0, 0));
+  }
+  virtual ~SilentHRTFDataSource() {
+  }
+
+  virtual bool ReadHRTF(int index, std::vector<float>* left,
+                        std::vector<float>* right) const {
+    assert(left && right && index == 0);
+    left->assign(fir_length_, 0.0f);
+    right->assign(fir_length_, 0.0f);
+    return true;
+  }
+};
+
+}  // namespace
+
+// Resamples, frequency transforms and decomposes a single HRTF pair per task.
+// Resampler and FFTFilter keep internal scratch buffers and are therefore
+// allocated once per worker.
+class HRTF::BankBuildTask : public ThreadPool::Task {
+ public:
+  BankBuildTask(HRTF* hrtf, const HRTFDataSource& data_source,
+                int num_workers, double resample_factor)
+      : hrtf_(hrtf),
+        data_source_(data_source),
+        failed_(false),
+        left_hrtf_float_(num_workers),
+        right_hrtf_float_(num_workers) {
+    for (int i = 0; i < num_workers; ++i) {
+      resamplers_.push_back(
+          new Resampler(data_source_.GetFIRLength(), resample_factor));
+      fft_filters_.push_back(new FFTFilter(hrtf_->block_size_));
+    }
+    // Zero-pad generously to limit time aliasing of the cepstrum.
+    int cepstrum_len = 1;
+    while (cepstrum_len < GetOutputLength() * 4) {
+      cepstrum_len *= 2;
+    }
+    for (int i = 0; i < num_workers; ++i) {
+      cepstrum_filters_.push_back(new FFTFilter(cepstrum_len));
+    }
+  }
+  virtual ~BankBuildTask() {
+    for (int i = 0; i < resamplers_.size(); ++i) {
+      delete resamplers_[i];
+      delete fft_filters_[i];
+      delete cepstrum_filters_[i];
+    }
+  }
+
+  int GetOutputLength() const {
+    return resamplers_[0]->GetOutputLength();
+  }
+
+  bool HasFailed() const {
+    return failed_;
+  }
+
+  virtual void Run(int hrtf_itr, int worker_index) {
+    std::vector<float>& left_hrtf_float = left_hrtf_float_[worker_index];
+    std::vector<float>& right_hrtf_float = right_hrtf_float_[worker_index];
+    Resampler* resampler = resamplers_[worker_index];
+    FFTFilter* fft_filter = fft_filters_[worker_index];
+
+    if (!data_source_.ReadHRTF(hrtf_itr, &left_hrtf_float,
+                               &right_hrtf_float)
+        || left_hrtf_float.size() != data_source_.GetFIRLength()
+        || right_hrtf_float.size() != data_source_.GetFIRLength()) {
+      std::cerr << "Error reading HRTF " << hrtf_itr << " of dataset "
+          << data_source_.GetIdentifier() << std::endl;
+      // Keeps the bank complete with a silent HRTF, the caller learns about
+      // the failure through HasFailed().
+      failed_ = true;
+      left_hrtf_float.assign(data_source_.GetFIRLength(), 0.0f);
+      right_hrtf_float.assign(data_source_.GetFIRLength(), 0.0f);
+    }
+
+    // Resample HRTF float vectors to match target sample rate.
+    ResampledHRTFPairT& time_domain =
+        hrtf_->hrtf_resampled_time_domain_[hrtf_itr];
+    resampler->Resample(left_hrtf_float, &time_domain.first);
+    resampler->Resample(right_hrtf_float, &time_domain.second);
+
+    ResampledHRTFPairT& freq_domain =
+        hrtf_->hrtf_resampled_freq_domain_[hrtf_itr];
+    fft_filter->ForwardTransform(time_domain.first, &freq_domain.first);
+    fft_filter->ForwardTransform(time_domain.second, &freq_domain.second);
+
+    ResampledHRTFPairT& min_phase =
+        hrtf_->hrtf_min_phase_time_domain_[hrtf_itr];
+    std::pair<float, float>& delays = hrtf_->hrtf_delays_[hrtf_itr];
+    FFTFilter* cepstrum_filter = cepstrum_filters_[worker_index];
+    DecomposeMinimumPhase(time_domain.first, cepstrum_filter, &min_phase.first,
+                          &delays.first);
+    DecomposeMinimumPhase(time_domain.second, cepstrum_filter,
+                          &min_phase.second, &delays.second);
+  }
+
+ private:
+  // Computes the truncated minimum-phase version of |hrtf| via the folded
+  // real cepstrum. The onset delay is the fractional lag maximizing the
+  // cross-correlation of both responses.
+  void DecomposeMinimumPhase(const std::vector<float>& hrtf,
+                             FFTFilter* cepstrum_filter,
+                             std::vector<float>* min_phase,
+                             float* delay) const {
+    std::vector<float> spectrum;
+    cepstrum_filter->ForwardTransform(hrtf, &spectrum);
+
+    float max_magnitude = 0.0f;
+    for (int i = 0; i < spectrum.size(); i += 2) {
+      spectrum[i] = sqrt(
+          spectrum[i] * spectrum[i] + spectrum[i + 1] * spectrum[i + 1]);
+      spectrum[i + 1] = 0.0f;
+      max_magnitude = fmax(max_magnitude, spectrum[i]);
+    }
+    // Limit the dynamic range to 100dB before taking the logarithm.
+    float min_magnitude = fmax(max_magnitude * 1e-5f, 1e-20f);
+    for (int i = 0; i < spectrum.size(); i += 2) {
+      spectrum[i] = log(fmax(spectrum[i], min_magnitude));
+    }
+
+    std::vector<float> cepstrum;
+    cepstrum_filter->InverseTransform(spectrum, &cepstrum);
+
+    // Fold the anti-causal part of the cepstrum onto the causal part. The
+    // first and the Nyquist coefficient have no mirror image and are kept.
+    int cepstrum_len = cepstrum.size();
+    float nyquist_coefficient = cepstrum[cepstrum_len / 2];
+    cepstrum.resize(cepstrum_len / 2);
+    for (int i = 1; i < cepstrum.size(); ++i) {
+      cepstrum[i] *= 2.0f;
+    }
+
+    // The forward transform takes at most half the transform length, the
+    // Nyquist coefficient adds a real (-1)^k to the log spectrum instead.
+    cepstrum_filter->ForwardTransform(cepstrum, &spectrum);
+    for (int i = 0; i < spectrum.size(); i += 2) {
+      spectrum[i] += (i / 2) % 2 ? -nyquist_coefficient : nyquist_coefficient;
+    }
+    for (int i = 0; i < spectrum.size(); i += 2) {
+      float magnitude = exp(spectrum[i]);
+      float phase = spectrum[i + 1];
+      spectrum[i] = magnitude * cos(phase);
+      spectrum[i + 1] = magnitude * sin(phase);
+    }
+    cepstrum_filter->InverseTransform(spectrum, min_phase);
+
+    // Truncate and fade out the tail.
+    int filter_size = hrtf_->min_phase_filter_size_;
+    min_phase->resize(filter_size);
+    int fade_len = filter_size / 8;
+    for (int i = 0; i < fade_len; ++i) {
+      float phase = M_PI / 2.0 * (i + 1) / fade_len;
+      (*min_phase)[filter_size - fade_len + i] *= cos(phase) * cos(phase);
+    }
+
+    int best_lag = 0;
+    std::vector<float> correlation(hrtf.size(), 0.0f);
+    for (int lag = 0; lag < hrtf.size(); ++lag) {
+      for (int i = 0; i < filter_size && i + lag < hrtf.size(); ++i) {
+        correlation[lag] += hrtf[i + lag] * (*min_phase)[i];
+      }
+      if (correlation[lag] > correlation[best_lag]) {
+        best_lag = lag;
+      }
+    }
+    // Parabolic interpolation around the correlation peak.
+    *delay = best_lag;
+    if (best_lag > 0 && best_lag + 1 < correlation.size()) {
+      float left = correlation[best_lag - 1];
+      float center = correlation[best_lag];
+      float right = correlation[best_lag + 1];
+      float denominator = left - 2.0f * center + right;
+      if (denominator < 0.0f) {
+        *delay += 0.5f * (left - right) / denominator;
+      }
+    }
+  }
+
+  HRTF* hrtf_;
+  const HRTFDataSource& data_source_;
+  std::atomic<bool> failed_;
+  std::vector<Resampler*> resamplers_;
+  std::vector<FFTFilter*> fft_filters_;
+  std::vector<FFTFilter*> cepstrum_filters_;
+  std::vector<std::vector<float> > left_hrtf_float_;
+  std::vector<std::vector<float> > right_hrtf_float_;
+};
+
+HRTF::HRTF(int sample_rate, int block_size, int num_threads)
     : sample_rate_(sample_rate),
       block_size_(block_size),
+      valid_(true),
+      num_hrtfs_(0),
+      distance_(0.0f),
       hrtf_index_(-1),
       hrtf_elevation_deg_(-1.0),
       hrtf_azimuth_deg_(-1.0),
       left_right_swap_(false),
-      filter_size_(-1) {
+      filter_size_(-1),
+      min_phase_filter_size_(-1),
+      half_float_freq_domain_(false) {
+  HRTFDataSource* data_source = HRTFDataSource::CreateDefault();
+  if (data_source) {
+    Init(*data_source, num_threads);
+    delete data_source;
+  } else {
+    std::cerr << "Library was built without HRTF dataset" << std::endl;
+    Init(SilentHRTFDataSource(sample_rate), num_threads);
+    valid_ = false;
+  }
+}
+
+HRTF::HRTF(const HRTFDataSource& data_source, int sample_rate, int block_size,
+           int num_threads)
+    : sample_rate_(sample_rate),
+      block_size_(block_size),
+      valid_(true),
+      num_hrtfs_(0),
+      distance_(0.0f),
+      hrtf_index_(-1),
+      hrtf_elevation_deg_(-1.0),
+      hrtf_azimuth_deg_(-1.0),
+      left_right_swap_(false),
+      filter_size_(-1),
+      min_phase_filter_size_(-1),
+      half_float_freq_domain_(false) {
+  Init(data_source, num_threads);
+}
+
+void HRTF::Init(const HRTFDataSource& data_source, int num_threads) {
+  assert(data_source.GetNumHRTFs() > 0);
+  num_hrtfs_ = data_source.GetNumHRTFs();
+  distance_ = data_source.GetDistance();
+  directions_.resize(num_hrtfs_);
+  for (int i = 0; i < num_hrtfs_; ++i) {
+    data_source.GetDirection(i, &directions_[i].first,
+                             &directions_[i].second);
+  }
+
   hrtf_nn_search_ = new FLANNNeighborSearch();
 
   InitNeighborSearch();
-  ResampleHRTFs();
-  FreqTransformHRTFs();
+  valid_ = BuildHRTFBank(data_source, num_threads);
   SetDirection(0.0f, 0.0f);
+  parametric_hrtf_ = new ParametricHRTF(*this);
+}
+
+bool HRTF::IsValid() const {
+  return valid_;
 }
 
 HRTF::~HRTF() {
   delete hrtf_nn_search_;
+  delete parametric_hrtf_;
 }
 
 void HRTF::InitNeighborSearch() {
   // Add orientations of right hemisphere
-  for (int i = 0; i < kHRTFDataSet.num_hrtfs; ++i) {
-    float elevation_deg = kHRTFDataSet.direction[i][0];
-    float azimuth_deg = kHRTFDataSet.direction[i][1];
+  for (int i = 0; i < num_hrtfs_; ++i) {
+    float elevation_deg = directions_[i].first;
+    float azimuth_deg = directions_[i].second;
     hrtf_nn_search_->AddHRTFDirection(elevation_deg, azimuth_deg, i);
   }
   hrtf_nn_search_->BuildIndex();
-}
 
-bool HRTF::SetDirection(float elevation_deg, float azimuth_deg) {
-  if (elevation_deg == hrtf_elevation_deg_
-      && azimuth_deg == hrtf_azimuth_deg_) {
-    return false;
+  // FindHRTF() works on whole degrees. Tabulating all queries of the right
+  // hemisphere keeps the FLANN search, which allocates, off the audio thread.
+  nearest_hrtf_table_.resize(181 * 181);
+  for (int elevation_deg = -90; elevation_deg <= 90; ++elevation_deg) {
+    for (int azimuth_deg = 0; azimuth_deg <= 180; ++azimuth_deg) {
+      nearest_hrtf_table_[(elevation_deg + 90) * 181 + azimuth_deg] =
+          hrtf_nn_search_->FindNearestHRTF(elevation_deg, azimuth_deg);
+    }
   }
+}
 
+int HRTF::FindHRTF(float elevation_deg, float azimuth_deg,
+                   bool* left_right_swap) const {
+  assert(left_right_swap);
   int new_elevation_deg = elevation_deg;
   int new_azimuth_deg = azimuth_deg;
   while (new_azimuth_deg < -180) {
@@ -49,23 +318,40 @@ bool HRTF::SetDirection(float elevation_deg, float azimuth_deg) {
     new_azimuth_deg -= 360;
   }
 
-  int hrtf_index = hrtf_nn_search_->FindNearestHRTF(new_elevation_deg,
-                                                    fabs(new_azimuth_deg));
-  assert(hrtf_index >= 0 && hrtf_index < kHRTFDataSet.num_hrtfs);
+  int hrtf_index;
+  if (new_elevation_deg >= -90 && new_elevation_deg <= 90) {
+    hrtf_index = nearest_hrtf_table_[(new_elevation_deg + 90) * 181
+        + abs(new_azimuth_deg)];
+  } else {
+    hrtf_index = hrtf_nn_search_->FindNearestHRTF(new_elevation_deg,
+                                                  fabs(new_azimuth_deg));
+  }
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
+  *left_right_swap = (new_azimuth_deg < 0.0f);
+  return hrtf_index;
+}
+
+bool HRTF::SetDirection(float elevation_deg, float azimuth_deg) {
+  if (elevation_deg == hrtf_elevation_deg_
+      && azimuth_deg == hrtf_azimuth_deg_) {
+    return false;
+  }
 
-  if (hrtf_index_ == hrtf_index) {
+  bool left_right_swap;
+  int hrtf_index = FindHRTF(elevation_deg, azimuth_deg, &left_right_swap);
+  if (hrtf_index_ == hrtf_index && left_right_swap_ == left_right_swap) {
     return false;
   }
   hrtf_index_ = hrtf_index;
+  left_right_swap_ = left_right_swap;
 
   // Right hemisphere
-  hrtf_elevation_deg_ = kHRTFDataSet.direction[hrtf_index][0];
-  hrtf_azimuth_deg_ = kHRTFDataSet.direction[hrtf_index][1];
-  left_right_swap_ = (new_azimuth_deg < 0.0f);
+  hrtf_elevation_deg_ = directions_[hrtf_index].first;
+  hrtf_azimuth_deg_ = directions_[hrtf_index].second;
 
   if (left_right_swap_) {
     // Left hemisphere corrections
-    hrtf_azimuth_deg_ = kHRTFDataSet.direction[hrtf_index][1] * -1;
+    hrtf_azimuth_deg_ = directions_[hrtf_index].second * -1;
   }
 
   return true;
@@ -78,93 +364,227 @@ void HRTF::GetDirection(float* elevation_deg, float* azimuth_deg) const {
 }
 
 const std::vector<float>& HRTF::GetLeftEarTimeHRTF() const {
-  assert(hrtf_index_ >= 0 && hrtf_index_ < kHRTFDataSet.num_hrtfs);
+  return GetLeftEarTimeHRTF(hrtf_index_, left_right_swap_);
+}
+const std::vector<float>& HRTF::GetLeftEarTimeHRTF(int hrtf_index,
+                                                   bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
   return
-      left_right_swap_ ?
-          hrtf_resampled_time_domain_[hrtf_index_].second :
-          hrtf_resampled_time_domain_[hrtf_index_].first;
+      left_right_swap ?
+          hrtf_resampled_time_domain_[hrtf_index].second :
+          hrtf_resampled_time_domain_[hrtf_index].first;
 }
 const std::vector<float>& HRTF::GetRightEarTimeHRTF() const {
-  assert(hrtf_index_ >= 0 && hrtf_index_ < kHRTFDataSet.num_hrtfs);
+  return GetRightEarTimeHRTF(hrtf_index_, left_right_swap_);
+}
+const std::vector<float>& HRTF::GetRightEarTimeHRTF(
+    int hrtf_index, bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
   return
-      left_right_swap_ ?
-          hrtf_resampled_time_domain_[hrtf_index_].first :
-          hrtf_resampled_time_domain_[hrtf_index_].second;
+      left_right_swap ?
+          hrtf_resampled_time_domain_[hrtf_index].first :
+          hrtf_resampled_time_domain_[hrtf_index].second;
 }
 
 const std::vector<float>& HRTF::GetLeftEarFreqHRTF() const {
-  assert(hrtf_index_ >= 0 && hrtf_index_ < kHRTFDataSet.num_hrtfs);
+  return GetLeftEarFreqHRTF(hrtf_index_, left_right_swap_);
+}
+const std::vector<float>& HRTF::GetLeftEarFreqHRTF(int hrtf_index,
+                                                   bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
+  assert(!half_float_freq_domain_);
   return
-      left_right_swap_ ?
-          hrtf_resampled_freq_domain_[hrtf_index_].second :
-          hrtf_resampled_freq_domain_[hrtf_index_].first;
+      left_right_swap ?
+          hrtf_resampled_freq_domain_[hrtf_index].second :
+          hrtf_resampled_freq_domain_[hrtf_index].first;
 }
 const std::vector<float>& HRTF::GetRightEarFreqHRTF() const {
-  assert(hrtf_index_ >= 0 && hrtf_index_ < kHRTFDataSet.num_hrtfs);
+  return GetRightEarFreqHRTF(hrtf_index_, left_right_swap_);
+}
+const std::vector<float>& HRTF::GetRightEarFreqHRTF(
+    int hrtf_index, bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
+  assert(!half_float_freq_domain_);
   return
-      left_right_swap_ ?
-          hrtf_resampled_freq_domain_[hrtf_index_].first :
-          hrtf_resampled_freq_domain_[hrtf_index_].second;
+      left_right_swap ?
+          hrtf_resampled_freq_domain_[hrtf_index].first :
+          hrtf_resampled_freq_domain_[hrtf_index].second;
 }
 
-float HRTF::GetDistance() const {
-  return kHRTFDataSet.distance;
+void HRTF::GetLeftEarFreqHRTF(int hrtf_index, bool left_right_swap,
+                              std::vector<float>* kernel) const {
+  assert(kernel);
+  if (half_float_freq_domain_) {
+    ConvertHalfToFloat(GetLeftEarHalfFloatFreqHRTF(hrtf_index,
+                                                   left_right_swap),
+                       kernel);
+  } else {
+    *kernel = GetLeftEarFreqHRTF(hrtf_index, left_right_swap);
+  }
 }
 
-int HRTF::GetFilterSize() const {
-  return filter_size_;
+void HRTF::GetRightEarFreqHRTF(int hrtf_index, bool left_right_swap,
+                               std::vector<float>* kernel) const {
+  assert(kernel);
+  if (half_float_freq_domain_) {
+    ConvertHalfToFloat(GetRightEarHalfFloatFreqHRTF(hrtf_index,
+                                                    left_right_swap),
+                       kernel);
+  } else {
+    *kernel = GetRightEarFreqHRTF(hrtf_index, left_right_swap);
+  }
 }
 
-void HRTF::ResampleHRTFs() {
-  double resample_factor = static_cast<double>(sample_rate_)
-      / static_cast<double>(kHRTFDataSet.sample_rate);
-  Resampler resampler(kHRTFDataSet.fir_length, resample_factor);
+void HRTF::ConvertFreqDomainBankToHalfFloat() {
+  if (half_float_freq_domain_) {
+    return;
+  }
+  hrtf_half_float_freq_domain_.resize(num_hrtfs_);
+  for (int i = 0; i < num_hrtfs_; ++i) {
+    ConvertFloatToHalf(hrtf_resampled_freq_domain_[i].first,
+                       &hrtf_half_float_freq_domain_[i].first);
+    ConvertFloatToHalf(hrtf_resampled_freq_domain_[i].second,
+                       &hrtf_half_float_freq_domain_[i].second);
+  }
+  std::vector<ResampledHRTFPairT>().swap(hrtf_resampled_freq_domain_);
+  half_float_freq_domain_ = true;
+}
 
-  filter_size_ = resampler.GetOutputLength();
+bool HRTF::IsFreqDomainBankHalfFloat() const {
+  return half_float_freq_domain_;
+}
 
-  std::vector<float> left_hrtf_float(kHRTFDataSet.fir_length);
-  std::vector<float> right_hrtf_float(kHRTFDataSet.fir_length);
+const std::vector<uint16_t>& HRTF::GetLeftEarHalfFloatFreqHRTF() const {
+  return GetLeftEarHalfFloatFreqHRTF(hrtf_index_, left_right_swap_);
+}
 
-  hrtf_resampled_time_domain_.resize(kHRTFDataSet.num_hrtfs);
-  for (int hrtf_itr = 0; hrtf_itr < kHRTFDataSet.num_hrtfs; ++hrtf_itr) {
-// Convert raw HRTF to float vector.
-    ConvertShortToFloatVector(&kHRTFDataSet.data[hrtf_itr][0][0],
-                              kHRTFDataSet.fir_length, &left_hrtf_float);
-    ConvertShortToFloatVector(&kHRTFDataSet.data[hrtf_itr][1][0],
-                              kHRTFDataSet.fir_length, &right_hrtf_float);
+const std::vector<uint16_t>& HRTF::GetRightEarHalfFloatFreqHRTF() const {
+  return GetRightEarHalfFloatFreqHRTF(hrtf_index_, left_right_swap_);
+}
 
-    // Resample HRTF float vectors to match target sample rate.
-    std::vector<float> left_hrtf_resampled_float;
-    resampler.Resample(left_hrtf_float, &left_hrtf_resampled_float);
-    std::vector<float> right_hrtf_resampled_float;
-    resampler.Resample(right_hrtf_float, &right_hrtf_resampled_float);
+const std::vector<uint16_t>& HRTF::GetLeftEarHalfFloatFreqHRTF(
+    int hrtf_index, bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
+  assert(half_float_freq_domain_);
+  return
+      left_right_swap ?
+          hrtf_half_float_freq_domain_[hrtf_index].second :
+          hrtf_half_float_freq_domain_[hrtf_index].first;
+}
 
-    // Assign resampled HRTFs to hrtf_resampled_;
-    hrtf_resampled_time_domain_[hrtf_itr].first.swap(left_hrtf_resampled_float);
-    hrtf_resampled_time_domain_[hrtf_itr].second.swap(
-        right_hrtf_resampled_float);
-  }
+const std::vector<uint16_t>& HRTF::GetRightEarHalfFloatFreqHRTF(
+    int hrtf_index, bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
+  assert(half_float_freq_domain_);
+  return
+      left_right_swap ?
+          hrtf_half_float_freq_domain_[hrtf_index].first :
+          hrtf_half_float_freq_domain_[hrtf_index].second;
 }
 
-void HRTF::FreqTransformHRTFs() {
-  FFTFilter fft_filter(block_size_);
-  hrtf_resampled_freq_domain_.resize(kHRTFDataSet.num_hrtfs);
-  for (int hrtf_itr = 0; hrtf_itr < kHRTFDataSet.num_hrtfs; ++hrtf_itr) {
-    fft_filter.ForwardTransform(hrtf_resampled_time_domain_[hrtf_itr].first,
-                                &hrtf_resampled_freq_domain_[hrtf_itr].first);
-    fft_filter.ForwardTransform(hrtf_resampled_time_domain_[hrtf_itr].second,
-                                &hrtf_resampled_freq_domain_[hrtf_itr].second);
-  }
+const std::vector<float>& HRTF::GetLeftEarMinimumPhaseHRTF() const {
+  return GetLeftEarMinimumPhaseHRTF(hrtf_index_, left_right_swap_);
+}
+const std::vector<float>& HRTF::GetLeftEarMinimumPhaseHRTF(
+    int hrtf_index, bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
+  return
+      left_right_swap ?
+          hrtf_min_phase_time_domain_[hrtf_index].second :
+          hrtf_min_phase_time_domain_[hrtf_index].first;
+}
+const std::vector<float>& HRTF::GetRightEarMinimumPhaseHRTF() const {
+  return GetRightEarMinimumPhaseHRTF(hrtf_index_, left_right_swap_);
+}
+const std::vector<float>& HRTF::GetRightEarMinimumPhaseHRTF(
+    int hrtf_index, bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
+  return
+      left_right_swap ?
+          hrtf_min_phase_time_domain_[hrtf_index].first :
+          hrtf_min_phase_time_domain_[hrtf_index].second;
 }
 
-void HRTF::ConvertShortToFloatVector(const short* input_ptr, int input_size,
-                                     std::vector<float>* output) {
-  assert(output != 0);
-  assert(input_ptr != 0);
-  output->resize(input_size);
-  const short* input_raw_ptr = input_ptr;
-  for (int i = 0; i < input_size; ++i, ++input_raw_ptr) {
-    (*output)[i] = (*input_raw_ptr) / static_cast<float>(0x7FFF);
-  }
+float HRTF::GetLeftEarDelay() const {
+  return GetLeftEarDelay(hrtf_index_, left_right_swap_);
+}
+float HRTF::GetLeftEarDelay(int hrtf_index,
+                            bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
+  return
+      left_right_swap ?
+          hrtf_delays_[hrtf_index].second :
+          hrtf_delays_[hrtf_index].first;
+}
+float HRTF::GetRightEarDelay() const {
+  return GetRightEarDelay(hrtf_index_, left_right_swap_);
+}
+float HRTF::GetRightEarDelay(int hrtf_index,
+                             bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
+  return
+      left_right_swap ?
+          hrtf_delays_[hrtf_index].first :
+          hrtf_delays_[hrtf_index].second;
+}
+
+const ParametricHRTF& HRTF::GetParametricHRTF() const {
+  return *parametric_hrtf_;
+}
+
+int HRTF::GetNumHRTFs() const {
+  return num_hrtfs_;
+}
+
+void HRTF::GetHRTFDirection(int hrtf_index, float* elevation_deg,
+                            float* azimuth_deg) const {
+  assert(elevation_deg && azimuth_deg);
+  assert(hrtf_index >= 0 && hrtf_index < num_hrtfs_);
+  *elevation_deg = directions_[hrtf_index].first;
+  *azimuth_deg = directions_[hrtf_index].second;
+}
+
+float HRTF::GetDistance() const {
+  return distance_;
+}
+
+int HRTF::GetSampleRate() const {
+  return sample_rate_;
 }
 
+int HRTF::GetHRTFIndex() const {
+  return hrtf_index_;
+}
+
+bool HRTF::GetLeftRightSwap() const {
+  return left_right_swap_;
+}
+
+int HRTF::GetFilterSize() const {
+  return filter_size_;
+}
+
+int HRTF::GetMinimumPhaseFilterSize() const {
+  return min_phase_filter_size_;
+}
+
+bool HRTF::BuildHRTFBank(const HRTFDataSource& data_source,
+                         int num_threads) {
+  double resample_factor = static_cast<double>(sample_rate_)
+      / static_cast<double>(data_source.GetSampleRate());
+
+  ThreadPool thread_pool(num_threads);
+  BankBuildTask build_task(this, data_source, thread_pool.GetNumWorkers(),
+                           resample_factor);
+
+  filter_size_ = build_task.GetOutputLength();
+  min_phase_filter_size_ = std::min<int>(
+      filter_size_, ceil(kMinimumPhaseFilterDurationSec * sample_rate_));
+
+  hrtf_resampled_time_domain_.resize(num_hrtfs_);
+  hrtf_resampled_freq_domain_.resize(num_hrtfs_);
+  hrtf_min_phase_time_domain_.resize(num_hrtfs_);
+  hrtf_delays_.resize(num_hrtfs_);
+  thread_pool.ParallelFor(num_hrtfs_, &build_task);
+  return !build_task.HasFailed();
+}
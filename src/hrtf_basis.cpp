@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+#include "hrtf.h"
+#include "hrtf_basis.h"
+
+namespace {
+
+// Cyclic Jacobi eigenvalue decomposition of the symmetric matrix |matrix|
+// (size x size, row major). On return the diagonal of |matrix| holds the
+// eigenvalues and the columns of |eigenvectors| the eigenvectors.
+void JacobiEigenDecomposition(int size, std::vector<double>* matrix,
+                              std::vector<double>* eigenvectors) {
+  std::vector<double>& a = *matrix;
+  std::vector<double>& v = *eigenvectors;
+  v.assign(size * size, 0.0);
+  for (int i = 0; i < size; ++i) {
+    v[i * size + i] = 1.0;
+  }
+
+  static const int kMaxSweeps = 50;
+  for (int sweep = 0; sweep < kMaxSweeps; ++sweep) {
+    double off_diagonal = 0.0;
+    double diagonal = 0.0;
+    for (int p = 0; p < size; ++p) {
+      diagonal += a[p * size + p] * a[p * size + p];
+      for (int q = p + 1; q < size; ++q) {
+        off_diagonal += a[p * size + q] * a[p * size + q];
+      }
+    }
+    if (off_diagonal <= 1e-24 * diagonal) {
+      break;
+    }
+
+    for (int p = 0; p < size; ++p) {
+      for (int q = p + 1; q < size; ++q) {
+        double apq = a[p * size + q];
+        if (fabs(apq) < 1e-30) {
+          continue;
+        }
+        double theta = (a[q * size + q] - a[p * size + p]) / (2.0 * apq);
+        double t = (theta >= 0.0 ? 1.0 : -1.0)
+            / (fabs(theta) + sqrt(theta * theta + 1.0));
+        double c = 1.0 / sqrt(t * t + 1.0);
+        double s = t * c;
+
+        for (int k = 0; k < size; ++k) {
+          double akp = a[k * size + p];
+          double akq = a[k * size + q];
+          a[k * size + p] = c * akp - s * akq;
+          a[k * size + q] = s * akp + c * akq;
+        }
+        for (int k = 0; k < size; ++k) {
+          double apk = a[p * size + k];
+          double aqk = a[q * size + k];
+          a[p * size + k] = c * apk - s * aqk;
+          a[q * size + k] = s * apk + c * aqk;
+        }
+        for (int k = 0; k < size; ++k) {
+          double vkp = v[k * size + p];
+          double vkq = v[k * size + q];
+          v[k * size + p] = c * vkp - s * vkq;
+          v[k * size + q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+HRTFBasis::HRTFBasis(const HRTF& hrtf, int num_basis_filters)
+    : filter_size_(hrtf.GetMinimumPhaseFilterSize()) {
+  assert(num_basis_filters > 0 && num_basis_filters <= filter_size_);
+  int num_hrtfs = hrtf.GetNumHRTFs();
+
+  // Both ears of all directions form the training set.
+  std::vector<const std::vector<float>*> hrtfs;
+  for (int i = 0; i < num_hrtfs; ++i) {
+    hrtfs.push_back(&hrtf.GetLeftEarMinimumPhaseHRTF(i, false));
+    hrtfs.push_back(&hrtf.GetRightEarMinimumPhaseHRTF(i, false));
+  }
+
+  mean_filter_.assign(filter_size_, 0.0f);
+  for (int i = 0; i < hrtfs.size(); ++i) {
+    for (int j = 0; j < filter_size_; ++j) {
+      mean_filter_[j] += (*hrtfs[i])[j] / hrtfs.size();
+    }
+  }
+
+  std::vector<double> covariance(filter_size_ * filter_size_, 0.0);
+  std::vector<double> centered(filter_size_);
+  for (int i = 0; i < hrtfs.size(); ++i) {
+    for (int j = 0; j < filter_size_; ++j) {
+      centered[j] = (*hrtfs[i])[j] - mean_filter_[j];
+    }
+    for (int j = 0; j < filter_size_; ++j) {
+      for (int k = j; k < filter_size_; ++k) {
+        covariance[j * filter_size_ + k] += centered[j] * centered[k];
+      }
+    }
+  }
+  for (int j = 0; j < filter_size_; ++j) {
+    for (int k = 0; k < j; ++k) {
+      covariance[j * filter_size_ + k] = covariance[k * filter_size_ + j];
+    }
+  }
+
+  std::vector<double> eigenvectors;
+  JacobiEigenDecomposition(filter_size_, &covariance, &eigenvectors);
+
+  std::vector<std::pair<double, int> > sorted_eigenvalues(filter_size_);
+  for (int i = 0; i < filter_size_; ++i) {
+    sorted_eigenvalues[i].first = fmax(covariance[i * filter_size_ + i], 0.0);
+    sorted_eigenvalues[i].second = i;
+  }
+  std::sort(sorted_eigenvalues.rbegin(), sorted_eigenvalues.rend());
+
+  eigenvalues_.resize(filter_size_);
+  for (int i = 0; i < filter_size_; ++i) {
+    eigenvalues_[i] = sorted_eigenvalues[i].first;
+  }
+
+  basis_filters_.resize(num_basis_filters);
+  for (int k = 0; k < num_basis_filters; ++k) {
+    int column = sorted_eigenvalues[k].second;
+    basis_filters_[k].resize(filter_size_);
+    for (int j = 0; j < filter_size_; ++j) {
+      basis_filters_[k][j] = eigenvectors[j * filter_size_ + column];
+    }
+  }
+
+  // Project the mean-free HRTFs onto the orthonormal basis.
+  weights_.resize(num_hrtfs);
+  for (int i = 0; i < num_hrtfs; ++i) {
+    WeightsT* ear_weights[2] = { &weights_[i].first, &weights_[i].second };
+    for (int ear = 0; ear < 2; ++ear) {
+      const std::vector<float>& ear_hrtf = *hrtfs[i * 2 + ear];
+      ear_weights[ear]->assign(num_basis_filters, 0.0f);
+      for (int k = 0; k < num_basis_filters; ++k) {
+        float weight = 0.0f;
+        for (int j = 0; j < filter_size_; ++j) {
+          weight += (ear_hrtf[j] - mean_filter_[j]) * basis_filters_[k][j];
+        }
+        (*ear_weights[ear])[k] = weight;
+      }
+    }
+  }
+}
+
+HRTFBasis::~HRTFBasis() {
+}
+
+int HRTFBasis::GetNumBasisFilters() const {
+  return basis_filters_.size();
+}
+
+int HRTFBasis::GetFilterSize() const {
+  return filter_size_;
+}
+
+const std::vector<float>& HRTFBasis::GetMeanFilter() const {
+  return mean_filter_;
+}
+
+const std::vector<float>& HRTFBasis::GetBasisFilter(int basis_index) const {
+  assert(basis_index >= 0 && basis_index < basis_filters_.size());
+  return basis_filters_[basis_index];
+}
+
+const std::vector<float>& HRTFBasis::GetLeftEarWeights(
+    int hrtf_index, bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < weights_.size());
+  return
+      left_right_swap ?
+          weights_[hrtf_index].second : weights_[hrtf_index].first;
+}
+
+const std::vector<float>& HRTFBasis::GetRightEarWeights(
+    int hrtf_index, bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < weights_.size());
+  return
+      left_right_swap ?
+          weights_[hrtf_index].first : weights_[hrtf_index].second;
+}
+
+float HRTFBasis::GetApproximationError(int num_basis_filters) const {
+  assert(num_basis_filters >= 0 && num_basis_filters <= eigenvalues_.size());
+  double total_energy = 0.0;
+  double residual_energy = 0.0;
+  for (int i = 0; i < eigenvalues_.size(); ++i) {
+    total_energy += eigenvalues_[i];
+    if (i >= num_basis_filters) {
+      residual_energy += eigenvalues_[i];
+    }
+  }
+  return total_energy > 0.0 ? residual_energy / total_energy : 0.0f;
+}
@@ -0,0 +1,398 @@
+#include <algorithm>
+#include <assert.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "hrtf_data_source.h"
+#include "wav_format.h"
+
+#ifdef MIT_KEMAR
+#include "hrtf_data.h"
+#endif
+
+using namespace std;
+
+namespace {
+
+static const char kBinaryMagic[4] = { 'H', 'R', 'T', 'F' };
+static const int kBinaryVersion = 1;
+// Upper bound of the identifier length accepted from binary files.
+static const int kMaxIdentifierLength = 4096;
+
+bool ReadLE32(FILE* file, int* value) {
+  unsigned char buffer[4];
+  if (fread(buffer, 1, 4, file) != 4) {
+    return false;
+  }
+  *value = DecodeLE32(buffer);
+  return true;
+}
+
+bool WriteLE32(int value, FILE* file) {
+  unsigned char buffer[4];
+  EncodeLE32(value, buffer);
+  return fwrite(buffer, 1, 4, file) == 4;
+}
+
+#ifdef MIT_KEMAR
+class CompiledHRTFDataSource : public HRTFDataSource {
+ public:
+  CompiledHRTFDataSource() {
+    identifier_ = kHRTFDataSet.identifier;
+    fir_length_ = kHRTFDataSet.fir_length;
+    sample_rate_ = kHRTFDataSet.sample_rate;
+    distance_ = kHRTFDataSet.distance;
+    directions_.resize(kHRTFDataSet.num_hrtfs);
+    for (int i = 0; i < kHRTFDataSet.num_hrtfs; ++i) {
+      directions_[i].first = kHRTFDataSet.direction[i][0];
+      directions_[i].second = kHRTFDataSet.direction[i][1];
+    }
+  }
+  virtual ~CompiledHRTFDataSource() {
+  }
+
+  virtual bool ReadHRTF(int index, vector<float>* left,
+                        vector<float>* right) const {
+    assert(left && right);
+    assert(index >= 0 && index < kHRTFDataSet.num_hrtfs);
+    ConvertShortToFloatVector(&kHRTFDataSet.data[index][0][0],
+                              kHRTFDataSet.fir_length, left);
+    ConvertShortToFloatVector(&kHRTFDataSet.data[index][1][0],
+                              kHRTFDataSet.fir_length, right);
+    return true;
+  }
+};
+#endif
+
+}  // namespace
+
+HRTFDataSource::HRTFDataSource()
+    : fir_length_(0),
+      sample_rate_(0),
+      distance_(0.0f) {
+}
+
+HRTFDataSource::~HRTFDataSource() {
+}
+
+const string& HRTFDataSource::GetIdentifier() const {
+  return identifier_;
+}
+
+int HRTFDataSource::GetNumHRTFs() const {
+  return directions_.size();
+}
+
+int HRTFDataSource::GetFIRLength() const {
+  return fir_length_;
+}
+
+int HRTFDataSource::GetSampleRate() const {
+  return sample_rate_;
+}
+
+float HRTFDataSource::GetDistance() const {
+  return distance_;
+}
+
+void HRTFDataSource::GetDirection(int index, int* elevation_deg,
+                                  int* azimuth_deg) const {
+  assert(elevation_deg && azimuth_deg);
+  assert(index >= 0 && index < directions_.size());
+  *elevation_deg = directions_[index].first;
+  *azimuth_deg = directions_[index].second;
+}
+
+HRTFDataSource* HRTFDataSource::CreateDefault() {
+#ifdef MIT_KEMAR
+  return new CompiledHRTFDataSource();
+#else
+  return 0;
+#endif
+}
+
+void HRTFDataSource::ConvertShortToFloatVector(const short* input_ptr,
+                                               int input_size,
+                                               vector<float>* output) {
+  assert(output != 0);
+  assert(input_ptr != 0);
+  output->resize(input_size);
+  const short* input_raw_ptr = input_ptr;
+  for (int i = 0; i < input_size; ++i, ++input_raw_ptr) {
+    (*output)[i] = PCM16ToFloat(*input_raw_ptr);
+  }
+}
+
+WavHRTFDataSource::WavHRTFDataSource() {
+}
+
+WavHRTFDataSource::~WavHRTFDataSource() {
+}
+
+bool WavHRTFDataSource::Open(const string& directory, float distance) {
+  struct HRTFFile {
+    int elevation_deg;
+    int azimuth_deg;
+    string file_name;
+    bool operator<(const HRTFFile& other) const {
+      return elevation_deg * 1000 + azimuth_deg
+          < other.elevation_deg * 1000 + other.azimuth_deg;
+    }
+  };
+  vector<HRTFFile> hrtf_files;
+
+  DIR* dataset_dir = opendir(directory.c_str());
+  if (!dataset_dir) {
+    cerr << "Cannot open HRTF directory: " << directory << endl;
+    return false;
+  }
+  struct dirent* elevation_entry;
+  while ((elevation_entry = readdir(dataset_dir)) != 0) {
+    int elevation_deg;
+    if (sscanf(elevation_entry->d_name, "elev%d", &elevation_deg) != 1) {
+      continue;
+    }
+    string elevation_dir = directory + "/" + elevation_entry->d_name;
+    DIR* hrtf_dir = opendir(elevation_dir.c_str());
+    if (!hrtf_dir) {
+      continue;
+    }
+    struct dirent* hrtf_entry;
+    while ((hrtf_entry = readdir(hrtf_dir)) != 0) {
+      HRTFFile hrtf_file;
+      char suffix[8];
+      if (sscanf(hrtf_entry->d_name, "H%de%d%7s", &hrtf_file.elevation_deg,
+                 &hrtf_file.azimuth_deg, suffix) != 3
+          || strcmp(suffix, "a.wav") != 0
+          || hrtf_file.elevation_deg != elevation_deg) {
+        continue;
+      }
+      hrtf_file.file_name = elevation_dir + "/" + hrtf_entry->d_name;
+      hrtf_files.push_back(hrtf_file);
+    }
+    closedir(hrtf_dir);
+  }
+  closedir(dataset_dir);
+
+  if (hrtf_files.empty()) {
+    cerr << "No HRTF files found in: " << directory << endl;
+    return false;
+  }
+  sort(hrtf_files.begin(), hrtf_files.end());
+
+  // All HRTFs have to share the format of the first one.
+  int sample_rate;
+  vector<float> left, right;
+  if (!ReadStereoWav(hrtf_files[0].file_name, &sample_rate, &left, &right)) {
+    return false;
+  }
+
+  identifier_ = directory;
+  fir_length_ = left.size();
+  sample_rate_ = sample_rate;
+  distance_ = distance;
+  directions_.resize(hrtf_files.size());
+  file_names_.resize(hrtf_files.size());
+  for (int i = 0; i < hrtf_files.size(); ++i) {
+    directions_[i].first = hrtf_files[i].elevation_deg;
+    directions_[i].second = hrtf_files[i].azimuth_deg;
+    file_names_[i] = hrtf_files[i].file_name;
+  }
+  return true;
+}
+
+bool WavHRTFDataSource::ReadHRTF(int index, vector<float>* left,
+                                 vector<float>* right) const {
+  assert(left && right);
+  assert(index >= 0 && index < file_names_.size());
+  int sample_rate;
+  if (!ReadStereoWav(file_names_[index], &sample_rate, left, right)) {
+    return false;
+  }
+  if (left->size() != fir_length_ || sample_rate != sample_rate_) {
+    cerr << "Invalid HRTF file: " << file_names_[index] << endl;
+    return false;
+  }
+  return true;
+}
+
+bool WavHRTFDataSource::ReadStereoWav(const string& file_name,
+                                      int* sample_rate, vector<float>* left,
+                                      vector<float>* right) {
+  assert(sample_rate && left && right);
+  // HRTF files are small and read at once.
+  FILE* file = fopen(file_name.c_str(), "rb");
+  if (!file) {
+    cerr << "Cannot open HRTF file: " << file_name << endl;
+    return false;
+  }
+  vector<unsigned char> contents;
+  bool valid = fseek(file, 0, SEEK_END) == 0;
+  long file_size = valid ? ftell(file) : -1;
+  valid = file_size > 0 && fseek(file, 0, SEEK_SET) == 0;
+  if (valid) {
+    contents.resize(file_size);
+    valid = fread(&contents[0], 1, file_size, file) == file_size;
+  }
+  fclose(file);
+
+  WavFormat format;
+  valid = valid && ParseWavHeader(&contents[0], contents.size(), &format)
+      && format.audio_format == kWavFormatPCM && format.num_channels == 2
+      && format.bits_per_sample == 16
+      && format.data_size <= contents.size() - format.data_offset;
+  if (!valid) {
+    cerr << "Invalid HRTF file: " << file_name << endl;
+    return false;
+  }
+  int num_frames = format.data_size / 4;
+  const unsigned char* frames = &contents[format.data_offset];
+  left->resize(num_frames);
+  right->resize(num_frames);
+  for (int i = 0; i < num_frames; ++i) {
+    (*left)[i] = PCM16ToFloat(DecodeLE16(&frames[i * 4]));
+    (*right)[i] = PCM16ToFloat(DecodeLE16(&frames[i * 4 + 2]));
+  }
+  *sample_rate = format.sample_rate;
+  return true;
+}
+
+BinaryHRTFDataSource::BinaryHRTFDataSource()
+    : file_descriptor_(-1),
+      data_offset_(0) {
+}
+
+BinaryHRTFDataSource::~BinaryHRTFDataSource() {
+  if (file_descriptor_ >= 0) {
+    close(file_descriptor_);
+  }
+}
+
+bool BinaryHRTFDataSource::Open(const string& file_name) {
+  if (file_descriptor_ >= 0) {
+    close(file_descriptor_);
+    file_descriptor_ = -1;
+  }
+  FILE* file = fopen(file_name.c_str(), "rb");
+  if (!file) {
+    cerr << "Cannot open HRTF file: " << file_name << endl;
+    return false;
+  }
+  char magic[4];
+  int version = 0;
+  int identifier_len = 0;
+  int num_hrtfs = 0;
+  int distance_bits = 0;
+  bool valid = fread(magic, 1, 4, file) == 4
+      && memcmp(magic, kBinaryMagic, 4) == 0 && ReadLE32(file, &version)
+      && version == kBinaryVersion && ReadLE32(file, &identifier_len)
+      && identifier_len >= 0 && identifier_len <= kMaxIdentifierLength;
+  if (valid) {
+    vector<char> identifier(identifier_len + 1, 0);
+    valid = fread(&identifier[0], 1, identifier_len, file) == identifier_len;
+    identifier_ = &identifier[0];
+  }
+  valid = valid && ReadLE32(file, &num_hrtfs) && ReadLE32(file, &fir_length_)
+      && ReadLE32(file, &sample_rate_) && ReadLE32(file, &distance_bits)
+      && num_hrtfs > 0 && fir_length_ > 0;
+  if (valid) {
+    memcpy(&distance_, &distance_bits, sizeof(distance_));
+    directions_.resize(num_hrtfs);
+    for (int i = 0; i < num_hrtfs && valid; ++i) {
+      valid = ReadLE32(file, &directions_[i].first)
+          && ReadLE32(file, &directions_[i].second);
+    }
+  }
+  if (valid) {
+    data_offset_ = ftell(file);
+    file_descriptor_ = open(file_name.c_str(), O_RDONLY);
+    valid = file_descriptor_ >= 0;
+  }
+  fclose(file);
+
+  if (!valid) {
+    cerr << "Invalid HRTF file: " << file_name << endl;
+    directions_.clear();
+    return false;
+  }
+  file_name_ = file_name;
+  return true;
+}
+
+bool BinaryHRTFDataSource::ReadHRTF(int index, vector<float>* left,
+                                    vector<float>* right) const {
+  assert(left && right);
+  assert(index >= 0 && index < directions_.size());
+  assert(file_descriptor_ >= 0);
+  long hrtf_bytes = 2L * 2L * fir_length_;
+  vector<unsigned char> buffer(hrtf_bytes);
+  if (pread(file_descriptor_, &buffer[0], hrtf_bytes,
+            data_offset_ + index * hrtf_bytes) != hrtf_bytes) {
+    cerr << "Truncated HRTF file: " << file_name_ << endl;
+    return false;
+  }
+  left->resize(fir_length_);
+  right->resize(fir_length_);
+  for (int i = 0; i < fir_length_; ++i) {
+    (*left)[i] = PCM16ToFloat(DecodeLE16(&buffer[i * 2]));
+    (*right)[i] = PCM16ToFloat(DecodeLE16(&buffer[(fir_length_ + i) * 2]));
+  }
+  return true;
+}
+
+bool BinaryHRTFDataSource::Write(const HRTFDataSource& data_source,
+                                 const string& file_name) {
+  FILE* file = fopen(file_name.c_str(), "wb");
+  if (!file) {
+    cerr << "Cannot create HRTF file: " << file_name << endl;
+    return false;
+  }
+  const string& identifier = data_source.GetIdentifier();
+  float distance = data_source.GetDistance();
+  int distance_bits;
+  memcpy(&distance_bits, &distance, sizeof(distance_bits));
+
+  bool valid = fwrite(kBinaryMagic, 1, 4, file) == 4
+      && WriteLE32(kBinaryVersion, file)
+      && WriteLE32(identifier.size(), file)
+      && fwrite(identifier.data(), 1, identifier.size(), file)
+          == identifier.size()
+      && WriteLE32(data_source.GetNumHRTFs(), file)
+      && WriteLE32(data_source.GetFIRLength(), file)
+      && WriteLE32(data_source.GetSampleRate(), file)
+      && WriteLE32(distance_bits, file);
+  for (int i = 0; i < data_source.GetNumHRTFs() && valid; ++i) {
+    int elevation_deg;
+    int azimuth_deg;
+    data_source.GetDirection(i, &elevation_deg, &azimuth_deg);
+    valid = WriteLE32(elevation_deg, file) && WriteLE32(azimuth_deg, file);
+  }
+
+  int fir_length = data_source.GetFIRLength();
+  vector<float> left;
+  vector<float> right;
+  vector<unsigned char> buffer(2 * 2 * fir_length);
+  for (int i = 0; i < data_source.GetNumHRTFs() && valid; ++i) {
+    valid = data_source.ReadHRTF(i, &left, &right);
+    if (!valid) {
+      break;
+    }
+    for (int j = 0; j < fir_length; ++j) {
+      EncodeLE16(FloatToPCM16(left[j]), &buffer[j * 2]);
+      EncodeLE16(FloatToPCM16(right[j]), &buffer[(fir_length + j) * 2]);
+    }
+    valid = fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size();
+  }
+  if (fclose(file) != 0) {
+    valid = false;
+  }
+  if (!valid) {
+    cerr << "Writing HRTF file failed: " << file_name << endl;
+  }
+  return valid;
+}
@@ -0,0 +1,147 @@
+#include <assert.h>
+#include <cmath>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "listener_geometry.h"
+
+namespace {
+
+const float kRadToDeg = 180.0f / M_PI;
+const float kHalfPi = M_PI / 2.0;
+const float kPi = M_PI;
+// Keeps atan2(0, 0) finite.
+const float kTinyFloat = 1e-30f;
+
+// Polynomial approximation of atan() on [0, 1] with an error below 1e-5
+// rad, Abramowitz and Stegun 4.4.49.
+const float kAtanC1 = 0.9998660f;
+const float kAtanC3 = -0.3302995f;
+const float kAtanC5 = 0.1801410f;
+const float kAtanC7 = -0.0851330f;
+const float kAtanC9 = 0.0208351f;
+
+// Same approximation as the SSE version so that the result does not
+// depend on the position of an entry in the batch.
+inline float FastAtan2(float y, float x) {
+  float abs_x = std::fabs(x);
+  float abs_y = std::fabs(y);
+  float max_xy = std::fmax(std::fmax(abs_x, abs_y), kTinyFloat);
+  float a = std::fmin(abs_x, abs_y) / max_xy;
+  float s = a * a;
+  float r = (((kAtanC9 * s + kAtanC7) * s + kAtanC5) * s + kAtanC3) * s * a
+      + kAtanC1 * a;
+  if (abs_y > abs_x) {
+    r = kHalfPi - r;
+  }
+  if (x < 0.0f) {
+    r = kPi - r;
+  }
+  return y < 0.0f ? -r : r;
+}
+
+#ifdef __SSE__
+inline __m128 Select(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline __m128 FastAtan2(__m128 y, __m128 x) {
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  __m128 abs_x = _mm_andnot_ps(sign_mask, x);
+  __m128 abs_y = _mm_andnot_ps(sign_mask, y);
+  __m128 max_xy = _mm_max_ps(_mm_max_ps(abs_x, abs_y),
+                             _mm_set1_ps(kTinyFloat));
+  __m128 a = _mm_div_ps(_mm_min_ps(abs_x, abs_y), max_xy);
+  __m128 s = _mm_mul_ps(a, a);
+  __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(kAtanC9), s),
+                        _mm_set1_ps(kAtanC7));
+  r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(kAtanC5));
+  r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(kAtanC3));
+  r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, s), a),
+                 _mm_mul_ps(_mm_set1_ps(kAtanC1), a));
+  r = Select(_mm_cmpgt_ps(abs_y, abs_x),
+             _mm_sub_ps(_mm_set1_ps(kHalfPi), r), r);
+  r = Select(_mm_cmplt_ps(x, _mm_setzero_ps()),
+             _mm_sub_ps(_mm_set1_ps(kPi), r), r);
+  return _mm_or_ps(r, _mm_and_ps(_mm_cmplt_ps(y, _mm_setzero_ps()),
+                                 sign_mask));
+}
+#endif
+
+// Rotation from world into listener coordinates, the transpose of the
+// rotation matrix of the listener orientation.
+void GetWorldToListenerRotation(const ListenerPose& listener,
+                                float rotation[3][3]) {
+  float w = listener.orientation[0];
+  float x = listener.orientation[1];
+  float y = listener.orientation[2];
+  float z = listener.orientation[3];
+  rotation[0][0] = 1.0f - 2.0f * (y * y + z * z);
+  rotation[0][1] = 2.0f * (x * y + w * z);
+  rotation[0][2] = 2.0f * (x * z - w * y);
+  rotation[1][0] = 2.0f * (x * y - w * z);
+  rotation[1][1] = 1.0f - 2.0f * (x * x + z * z);
+  rotation[1][2] = 2.0f * (y * z + w * x);
+  rotation[2][0] = 2.0f * (x * z + w * y);
+  rotation[2][1] = 2.0f * (y * z - w * x);
+  rotation[2][2] = 1.0f - 2.0f * (x * x + y * y);
+}
+
+}  // namespace
+
+ListenerPose::ListenerPose() {
+  position[0] = position[1] = position[2] = 0.0f;
+  orientation[0] = 1.0f;
+  orientation[1] = orientation[2] = orientation[3] = 0.0f;
+}
+
+void TransformToSpherical(const ListenerPose& listener, const float* x,
+                          const float* y, const float* z, int num_positions,
+                          float* elevation_deg, float* azimuth_deg,
+                          float* distance) {
+  assert(num_positions == 0 || (x && y && z));
+  assert(num_positions == 0 || (elevation_deg && azimuth_deg && distance));
+  float r[3][3];
+  GetWorldToListenerRotation(listener, r);
+  const float* p = listener.position;
+
+  int i = 0;
+#ifdef __SSE__
+  __m128 rad_to_deg = _mm_set1_ps(kRadToDeg);
+  for (; i + 4 <= num_positions; i += 4) {
+    __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), _mm_set1_ps(p[0]));
+    __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), _mm_set1_ps(p[1]));
+    __m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), _mm_set1_ps(p[2]));
+    __m128 lx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[0][0]), dx),
+                                      _mm_mul_ps(_mm_set1_ps(r[0][1]), dy)),
+                           _mm_mul_ps(_mm_set1_ps(r[0][2]), dz));
+    __m128 ly = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[1][0]), dx),
+                                      _mm_mul_ps(_mm_set1_ps(r[1][1]), dy)),
+                           _mm_mul_ps(_mm_set1_ps(r[1][2]), dz));
+    __m128 lz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(r[2][0]), dx),
+                                      _mm_mul_ps(_mm_set1_ps(r[2][1]), dy)),
+                           _mm_mul_ps(_mm_set1_ps(r[2][2]), dz));
+    __m128 horizontal = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(lx, lx),
+                                               _mm_mul_ps(ly, ly)));
+    _mm_storeu_ps(distance + i, _mm_sqrt_ps(
+        _mm_add_ps(_mm_mul_ps(horizontal, horizontal), _mm_mul_ps(lz, lz))));
+    _mm_storeu_ps(elevation_deg + i,
+                  _mm_mul_ps(FastAtan2(lz, horizontal), rad_to_deg));
+    _mm_storeu_ps(azimuth_deg + i, _mm_mul_ps(FastAtan2(lx, ly), rad_to_deg));
+  }
+#endif
+  for (; i < num_positions; ++i) {
+    float dx = x[i] - p[0];
+    float dy = y[i] - p[1];
+    float dz = z[i] - p[2];
+    float lx = r[0][0] * dx + r[0][1] * dy + r[0][2] * dz;
+    float ly = r[1][0] * dx + r[1][1] * dy + r[1][2] * dz;
+    float lz = r[2][0] * dx + r[2][1] * dy + r[2][2] * dz;
+    float horizontal = std::sqrt(lx * lx + ly * ly);
+    distance[i] = std::sqrt(horizontal * horizontal + lz * lz);
+    elevation_deg[i] = FastAtan2(lz, horizontal) * kRadToDeg;
+    azimuth_deg[i] = FastAtan2(lx, ly) * kRadToDeg;
+  }
+}
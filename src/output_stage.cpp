@@ -0,0 +1,97 @@
+#include <assert.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "output_stage.h"
+
+namespace {
+
+inline float MixFrame(const OutputStageInput& input, int i, bool left,
+                      float gain) {
+  const float* next = left ? input.next_left : input.next_right;
+  const float* previous = left ? input.previous_left : input.previous_right;
+  const float* reverb = left ? input.reverb_left : input.reverb_right;
+  float sample = next[i];
+  if (previous) {
+    sample = previous[i] + input.fade_in_window[i] * (sample - previous[i]);
+  }
+  sample *= gain;
+  if (reverb) {
+    sample += reverb[i];
+  }
+  return sample;
+}
+
+#ifdef __SSE__
+inline __m128 MixFrames(const float* next, const float* previous,
+                        const float* fade_in_window, const float* reverb,
+                        int i, __m128 gain) {
+  __m128 sample = _mm_loadu_ps(next + i);
+  if (previous) {
+    __m128 previous_sample = _mm_loadu_ps(previous + i);
+    __m128 fade_in = _mm_loadu_ps(fade_in_window + i);
+    sample = _mm_add_ps(previous_sample,
+                        _mm_mul_ps(fade_in,
+                                   _mm_sub_ps(sample, previous_sample)));
+  }
+  sample = _mm_mul_ps(sample, gain);
+  if (reverb) {
+    sample = _mm_add_ps(sample, _mm_loadu_ps(reverb + i));
+  }
+  return sample;
+}
+#endif
+
+}  // namespace
+
+void RenderOutputStage(const OutputStageInput& input, int num_frames,
+                       float* output_left, float* output_right,
+                       int output_stride) {
+  assert(input.next_left && input.next_right);
+  assert(!input.previous_left == !input.previous_right);
+  assert(!input.previous_left || input.fade_in_window);
+  assert(!input.reverb_left == !input.reverb_right);
+  assert(output_left && output_right && output_stride > 0);
+
+  float gain_step = (input.end_gain - input.start_gain) / num_frames;
+  int i = 0;
+#ifdef __SSE__
+  bool interleaved = (output_stride == 2 && output_right == output_left + 1);
+  __m128 gain = _mm_setr_ps(input.start_gain + gain_step,
+                            input.start_gain + 2.0f * gain_step,
+                            input.start_gain + 3.0f * gain_step,
+                            input.start_gain + 4.0f * gain_step);
+  __m128 gain_increment = _mm_set1_ps(4.0f * gain_step);
+  for (; i + 4 <= num_frames; i += 4) {
+    __m128 left = MixFrames(input.next_left, input.previous_left,
+                            input.fade_in_window, input.reverb_left, i, gain);
+    __m128 right = MixFrames(input.next_right, input.previous_right,
+                             input.fade_in_window, input.reverb_right, i,
+                             gain);
+    gain = _mm_add_ps(gain, gain_increment);
+    if (interleaved) {
+      _mm_storeu_ps(output_left + 2 * i, _mm_unpacklo_ps(left, right));
+      _mm_storeu_ps(output_left + 2 * i + 4, _mm_unpackhi_ps(left, right));
+    } else if (output_stride == 1) {
+      _mm_storeu_ps(output_left + i, left);
+      _mm_storeu_ps(output_right + i, right);
+    } else {
+      float left_frames[4];
+      float right_frames[4];
+      _mm_storeu_ps(left_frames, left);
+      _mm_storeu_ps(right_frames, right);
+      for (int j = 0; j < 4; ++j) {
+        output_left[(i + j) * output_stride] = left_frames[j];
+        output_right[(i + j) * output_stride] = right_frames[j];
+      }
+    }
+  }
+#endif
+  for (; i < num_frames; ++i) {
+    float gain = input.start_gain + gain_step * (i + 1);
+    output_left[i * output_stride] = MixFrame(input, i, true, gain);
+    output_right[i * output_stride] = MixFrame(input, i, false, gain);
+  }
+}
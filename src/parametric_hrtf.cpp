@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+
+#include "hrtf.h"
+#include "parametric_hrtf.h"
+
+namespace {
+
+// Frequency bands comparing the magnitude response below and above the
+// head shadow cutoff.
+const float kLowBandBeginHz = 500.0f;
+const float kLowBandEndHz = 1500.0f;
+const float kHighBandBeginHz = 5000.0f;
+const float kHighBandEndHz = 10000.0f;
+
+float GetMeanMagnitude(const std::vector<float>& spectrum, float bin_hz,
+                       float begin_hz, float end_hz) {
+  int num_bins = spectrum.size() / 2;
+  int begin = std::max(0, static_cast<int>(begin_hz / bin_hz));
+  int end = std::min(num_bins - 1, static_cast<int>(end_hz / bin_hz));
+  if (end < begin) {
+    return 0.0f;
+  }
+  float sum = 0.0f;
+  for (int i = begin; i <= end; ++i) {
+    sum += hypot(spectrum[2 * i], spectrum[2 * i + 1]);
+  }
+  return sum / (end - begin + 1);
+}
+
+// Coefficient of the one-pole lowpass (1 - a) / (1 - a z^-1) attenuating
+// |omega| by |attenuation| relative to DC.
+float GetOnePoleCoefficient(float attenuation, float omega) {
+  if (attenuation >= 1.0f) {
+    return 0.0f;
+  }
+  // Solves (1 - a)^2 = r^2 * (1 - 2a cos(omega) + a^2) for a in [0, 1).
+  double r2 = attenuation * attenuation;
+  double p = 1.0 - r2 * cos(omega);
+  double q = 1.0 - r2;
+  return (p - sqrt(fmax(p * p - q * q, 0.0))) / q;
+}
+
+}  // namespace
+
+ParametricHRTF::ParametricHRTF(const HRTF& hrtf) {
+  int num_hrtfs = hrtf.GetNumHRTFs();
+  std::vector<float> spectra[2];
+  hrtf.GetLeftEarFreqHRTF(0, false, &spectra[0]);
+  int num_bins = spectra[0].size() / 2;
+  float bin_hz = 0.5f * hrtf.GetSampleRate() / (num_bins - 1);
+  float shadow_hz = 0.5f * (kHighBandBeginHz + std::min(kHighBandEndHz,
+      0.5f * hrtf.GetSampleRate()));
+  float shadow_omega = 2.0f * M_PI * shadow_hz / hrtf.GetSampleRate();
+
+  // High to low band magnitude ratio of every ear, relative to the
+  // brightest ear of the bank.
+  std::vector<float> low_magnitude(2 * num_hrtfs);
+  std::vector<float> brightness(2 * num_hrtfs);
+  float max_brightness = 0.0f;
+  for (int i = 0; i < num_hrtfs; ++i) {
+    hrtf.GetLeftEarFreqHRTF(i, false, &spectra[0]);
+    hrtf.GetRightEarFreqHRTF(i, false, &spectra[1]);
+    for (int ear = 0; ear < 2; ++ear) {
+      float low = GetMeanMagnitude(spectra[ear], bin_hz, kLowBandBeginHz,
+                                   kLowBandEndHz);
+      float high = GetMeanMagnitude(spectra[ear], bin_hz, kHighBandBeginHz,
+                                    kHighBandEndHz);
+      low_magnitude[2 * i + ear] = low;
+      brightness[2 * i + ear] = low > 0.0f ? high / low : 0.0f;
+      max_brightness = fmax(max_brightness, brightness[2 * i + ear]);
+    }
+  }
+
+  // The gain carries the level difference below the head shadow cutoff,
+  // where the one-pole filter is transparent.
+  parameters_.resize(num_hrtfs);
+  for (int i = 0; i < num_hrtfs; ++i) {
+    EarParameters* ear_parameters[2] = { &parameters_[i].first,
+        &parameters_[i].second };
+    for (int ear = 0; ear < 2; ++ear) {
+      float attenuation = max_brightness > 0.0f ?
+          brightness[2 * i + ear] / max_brightness : 1.0f;
+      ear_parameters[ear]->gain = low_magnitude[2 * i + ear];
+      ear_parameters[ear]->shadow_coefficient = GetOnePoleCoefficient(
+          attenuation, shadow_omega);
+    }
+  }
+}
+
+ParametricHRTF::~ParametricHRTF() {
+}
+
+const ParametricHRTF::EarParameters& ParametricHRTF::GetLeftEarParameters(
+    int hrtf_index, bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < parameters_.size());
+  return
+      left_right_swap ?
+          parameters_[hrtf_index].second : parameters_[hrtf_index].first;
+}
+
+const ParametricHRTF::EarParameters& ParametricHRTF::GetRightEarParameters(
+    int hrtf_index, bool left_right_swap) const {
+  assert(hrtf_index >= 0 && hrtf_index < parameters_.size());
+  return
+      left_right_swap ?
+          parameters_[hrtf_index].first : parameters_[hrtf_index].second;
+}
@@ -20,6 +20,11 @@ Reberation::Reberation(int block_size, int sampling_rate, float reberation_time)
   reberation_output_right_.resize(block_size_, 0.0f);
 }
 
+Reberation::~Reberation() {
+  delete left_reberation_filter_;
+  delete right_reberation_filter_;
+}
+
 void Reberation::RenderImpulseResponse(int block_size, int sampling_rate,
                                        float reberation_time) {
   impulse_response_left_.resize(block_size, 0.0f);
@@ -50,13 +55,23 @@ void Reberation::AddReberation(const std::vector<float>& input,
   assert(output_left->size() == output_right->size());
   assert(input.size() == output_right->size());
 
+  const float* reberation_left;
+  const float* reberation_right;
+  ProcessReberation(input, &reberation_left, &reberation_right);
   for (int i = 0; i < input.size(); ++i) {
-    (*output_left)[i] += reberation_output_left_[reberation_output_read_pos_];
-    (*output_right)[i] += reberation_output_right_[reberation_output_read_pos_];
-    ++reberation_output_read_pos_;
+    (*output_left)[i] += reberation_left[i];
+    (*output_right)[i] += reberation_right[i];
   }
-  reberation_input_.insert(reberation_input_.end(), input.begin(), input.end());
+}
 
+void Reberation::ProcessReberation(const std::vector<float>& input,
+                                   const float** output_left,
+                                   const float** output_right) {
+  assert(output_left && output_right);
+  assert(block_size_ % input.size() == 0);
+
+  // The reverb output of a full input block is rendered on the next call so
+  // that the returned output stays valid until then.
   if (reberation_output_read_pos_ == block_size_) {
     left_reberation_filter_->AddSignalBlock(reberation_input_);
     right_reberation_filter_->AddSignalBlock(reberation_input_);
@@ -65,7 +80,12 @@ void Reberation::AddReberation(const std::vector<float>& input,
     right_reberation_filter_->GetResult(&reberation_output_right_);
     reberation_output_read_pos_ = 0;
   }
-  assert(reberation_output_read_pos_ < block_size_);
+
+  *output_left = &reberation_output_left_[reberation_output_read_pos_];
+  *output_right = &reberation_output_right_[reberation_output_read_pos_];
+  reberation_output_read_pos_ += input.size();
+  reberation_input_.insert(reberation_input_.end(), input.begin(), input.end());
+  assert(reberation_output_read_pos_ <= block_size_);
 }
 
 float Reberation::FloatRand() {
@@ -68,8 +68,9 @@ void Resampler::Resample(const vector<float>& input, vector<float>* output) {
       exit(1);
     }
   } else {
-    // Copy signal if resample factor is 1.0
+    // Copy signal if resample factor is 1.0, padded to GetOutputLength().
     output->assign(input.begin(), input.end());
+    output->resize(output_len_, 0.0f);
   }
 }
 
@@ -0,0 +1,217 @@
+#include <assert.h>
+#include <chrono>
+#include <pthread.h>
+#include <sched.h>
+
+#include "thread_pool.h"
+
+namespace {
+
+unsigned long long PackRange(int begin, int end) {
+  return (static_cast<unsigned long long>(begin) << 32)
+      | static_cast<unsigned int>(end);
+}
+
+void UnpackRange(unsigned long long range, int* begin, int* end) {
+  *begin = static_cast<int>(range >> 32);
+  *end = static_cast<int>(range & 0xffffffffULL);
+}
+
+// Polls of the completion counter before the calling thread starts to
+// yield its time slice.
+const int kMaxCompletionSpins = 4096;
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num_workers)
+    : num_workers_(num_workers),
+      worker_states_(0),
+      task_(0),
+      generation_(0),
+      pending_workers_(0),
+      shutdown_(false) {
+  if (num_workers_ <= 0) {
+    num_workers_ = std::thread::hardware_concurrency();
+  }
+  if (num_workers_ <= 0) {
+    num_workers_ = 1;
+  }
+  worker_states_ = new WorkerState[num_workers_];
+  for (int i = 0; i < num_workers_; ++i) {
+    worker_states_[i].range = PackRange(0, 0);
+    worker_states_[i].task_seconds = 0.0;
+    worker_states_[i].num_steals = 0;
+  }
+  stats_.wall_seconds = 0.0;
+  stats_.task_seconds = 0.0;
+  stats_.num_steals = 0;
+
+  for (int i = 1; i < num_workers_; ++i) {
+    threads_.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+  for (int i = 0; i < threads_.size(); ++i) {
+    threads_[i].join();
+  }
+  delete[] worker_states_;
+}
+
+int ThreadPool::GetNumWorkers() const {
+  return num_workers_;
+}
+
+bool ThreadPool::SetRealtimePriority() {
+  sched_param param;
+  param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+  bool success = true;
+  for (int i = 0; i < threads_.size(); ++i) {
+    if (pthread_setschedparam(threads_[i].native_handle(), SCHED_FIFO,
+                              &param) != 0) {
+      success = false;
+    }
+  }
+  return success;
+}
+
+void ThreadPool::ParallelFor(int num_tasks, Task* task) {
+  assert(task);
+  if (num_tasks <= 0) {
+    return;
+  }
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+  // Initial split into num_workers_ nearly equal contiguous ranges.
+  for (int i = 0; i < num_workers_; ++i) {
+    int begin = static_cast<long long>(num_tasks) * i / num_workers_;
+    int end = static_cast<long long>(num_tasks) * (i + 1) / num_workers_;
+    worker_states_[i].range = PackRange(begin, end);
+    worker_states_[i].task_seconds = 0.0;
+    worker_states_[i].num_steals = 0;
+  }
+  if (threads_.empty()) {
+    // A single worker runs on the calling thread without locking, which
+    // keeps ParallelFor() realtime safe.
+    task_ = task;
+    RunTasks(0);
+    task_ = 0;
+  } else {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = task;
+      pending_workers_ = threads_.size();
+      ++generation_;
+    }
+    work_cv_.notify_all();
+
+    RunTasks(0);
+
+    // The other workers finish at most one item after the calling thread
+    // runs out of work. Waiting for them without a lock keeps the caller
+    // from being descheduled behind a worker that holds the mutex.
+    for (int spin = 0;
+         pending_workers_.load(std::memory_order_acquire) > 0; ++spin) {
+      if (spin >= kMaxCompletionSpins) {
+        std::this_thread::yield();
+      }
+    }
+    task_ = 0;
+  }
+
+  stats_.wall_seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  stats_.task_seconds = 0.0;
+  stats_.num_steals = 0;
+  for (int i = 0; i < num_workers_; ++i) {
+    stats_.task_seconds += worker_states_[i].task_seconds;
+    stats_.num_steals += worker_states_[i].num_steals;
+  }
+}
+
+const ThreadPool::Stats& ThreadPool::GetLastStats() const {
+  return stats_;
+}
+
+void ThreadPool::WorkerLoop(int worker_index) {
+  int seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!shutdown_ && generation_ == seen_generation) {
+        work_cv_.wait(lock);
+      }
+      if (shutdown_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    RunTasks(worker_index);
+
+    pending_workers_.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+void ThreadPool::RunTasks(int worker_index) {
+  WorkerState& state = worker_states_[worker_index];
+  while (true) {
+    int task_index = PopTask(worker_index);
+    if (task_index < 0) {
+      task_index = StealTasks(worker_index);
+    }
+    if (task_index < 0) {
+      return;
+    }
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    task_->Run(task_index, worker_index);
+    state.task_seconds += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+int ThreadPool::PopTask(int worker_index) {
+  std::atomic<unsigned long long>& range = worker_states_[worker_index].range;
+  unsigned long long current = range.load();
+  while (true) {
+    int begin, end;
+    UnpackRange(current, &begin, &end);
+    if (begin >= end) {
+      return -1;
+    }
+    if (range.compare_exchange_weak(current, PackRange(begin + 1, end))) {
+      return begin;
+    }
+  }
+}
+
+int ThreadPool::StealTasks(int worker_index) {
+  for (int i = 1; i < num_workers_; ++i) {
+    int victim = (worker_index + i) % num_workers_;
+    std::atomic<unsigned long long>& range = worker_states_[victim].range;
+    unsigned long long current = range.load();
+    while (true) {
+      int begin, end;
+      UnpackRange(current, &begin, &end);
+      if (begin >= end) {
+        break;
+      }
+      int split = end - (end - begin + 1) / 2;
+      if (range.compare_exchange_weak(current, PackRange(begin, split))) {
+        // Run the first stolen item right away, publish the rest so that
+        // it can be stolen in turn.
+        worker_states_[worker_index].range = PackRange(split + 1, end);
+        ++worker_states_[worker_index].num_steals;
+        return split;
+      }
+    }
+  }
+  return -1;
+}
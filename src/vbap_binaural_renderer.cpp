@@ -0,0 +1,249 @@
+#include <assert.h>
+#include <cmath>
+
+#include "fft_filter.h"
+#include "hrtf.h"
+#include "vbap_binaural_renderer.h"
+
+VBAPBinauralRenderer::VBAPBinauralRenderer(const HRTF& hrtf, Layout layout,
+                                           int block_size)
+    : BinauralBusRenderer(hrtf, block_size) {
+  if (layout == kRing) {
+    AddSpeakerRing(0.0f, 8, 0.0f);
+    lowest_ring_size_ = 8;
+  } else {
+    AddSpeakerRing(-40.0f, 6, 0.0f);
+    lowest_ring_size_ = 6;
+    AddSpeakerRing(0.0f, 8, 0.0f);
+    AddSpeakerRing(40.0f, 6, 30.0f);
+    AddSpeakerRing(90.0f, 1, 0.0f);
+  }
+  num_speakers_ = speaker_directions_.size();
+
+  // Imaginary loudspeakers close the layout below and, for the ring, above.
+  // Both close the lowest ring.
+  AddSpeakerRing(-90.0f, 1, 0.0f);
+  if (layout == kRing) {
+    AddSpeakerRing(90.0f, 1, 0.0f);
+  }
+  Triangulate();
+
+  buses_.assign(num_speakers_, std::vector<float>(block_size_, 0.0f));
+  std::vector<float> kernel;
+  for (int i = 0; i < num_speakers_; ++i) {
+    float elevation_deg;
+    float azimuth_deg;
+    VectorToDirection(&speaker_directions_[i][0], &elevation_deg,
+                      &azimuth_deg);
+    bool left_right_swap;
+    int hrtf_index = hrtf_.FindHRTF(elevation_deg, azimuth_deg,
+                                    &left_right_swap);
+    FFTFilter* left_filter = new FFTFilter(block_size_);
+    hrtf_.GetLeftEarFreqHRTF(hrtf_index, left_right_swap, &kernel);
+    left_filter->SetFreqDomainKernel(kernel);
+    speaker_filters_[0].push_back(left_filter);
+    FFTFilter* right_filter = new FFTFilter(block_size_);
+    hrtf_.GetRightEarFreqHRTF(hrtf_index, left_right_swap, &kernel);
+    right_filter->SetFreqDomainKernel(kernel);
+    speaker_filters_[1].push_back(right_filter);
+  }
+}
+
+VBAPBinauralRenderer::~VBAPBinauralRenderer() {
+  for (int ear = 0; ear < 2; ++ear) {
+    for (int i = 0; i < speaker_filters_[ear].size(); ++i) {
+      delete speaker_filters_[ear][i];
+    }
+  }
+}
+
+int VBAPBinauralRenderer::GetNumSpeakers() const {
+  return num_speakers_;
+}
+
+void VBAPBinauralRenderer::AddSpeakerRing(float elevation_deg,
+                                          int num_speakers,
+                                          float azimuth_offset_deg) {
+  for (int i = 0; i < num_speakers; ++i) {
+    std::vector<float> direction(3);
+    DirectionToVector(elevation_deg,
+                      azimuth_offset_deg + 360.0f * i / num_speakers,
+                      &direction[0]);
+    speaker_directions_.push_back(direction);
+  }
+}
+
+void VBAPBinauralRenderer::Triangulate() {
+  // The faces of the convex hull of the loudspeaker directions. Layouts are
+  // small, so every triplet is tested against all other loudspeakers.
+  int num_directions = speaker_directions_.size();
+  const std::vector<std::vector<float> >& d = speaker_directions_;
+  for (int i = 0; i < num_directions; ++i) {
+    for (int j = i + 1; j < num_directions; ++j) {
+      for (int k = j + 1; k < num_directions; ++k) {
+        float normal[3] = {
+            (d[j][1] - d[i][1]) * (d[k][2] - d[i][2])
+                - (d[j][2] - d[i][2]) * (d[k][1] - d[i][1]),
+            (d[j][2] - d[i][2]) * (d[k][0] - d[i][0])
+                - (d[j][0] - d[i][0]) * (d[k][2] - d[i][2]),
+            (d[j][0] - d[i][0]) * (d[k][1] - d[i][1])
+                - (d[j][1] - d[i][1]) * (d[k][0] - d[i][0]) };
+        float offset = normal[0] * d[i][0] + normal[1] * d[i][1]
+            + normal[2] * d[i][2];
+        if (offset < 0.0f) {
+          for (int n = 0; n < 3; ++n) {
+            normal[n] = -normal[n];
+          }
+          offset = -offset;
+        }
+        if (offset < 1e-6f) {
+          continue;  // Degenerate or through the center.
+        }
+        bool is_face = true;
+        for (int l = 0; l < num_directions && is_face; ++l) {
+          if (l == i || l == j || l == k) {
+            continue;
+          }
+          float distance = normal[0] * d[l][0] + normal[1] * d[l][1]
+              + normal[2] * d[l][2] - offset;
+          is_face = distance < 1e-6f;
+        }
+        if (!is_face) {
+          continue;
+        }
+
+        Triangle triangle;
+        triangle.speakers[0] = i;
+        triangle.speakers[1] = j;
+        triangle.speakers[2] = k;
+        const std::vector<float>* rows[3] = { &d[i], &d[j], &d[k] };
+        float m[3][3];
+        for (int r = 0; r < 3; ++r) {
+          for (int c = 0; c < 3; ++c) {
+            m[r][c] = (*rows[r])[c];
+          }
+        }
+        float determinant = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+            - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+            + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        for (int r = 0; r < 3; ++r) {
+          for (int c = 0; c < 3; ++c) {
+            // Cofactor of m[c][r] over the determinant.
+            int r0 = (c + 1) % 3, r1 = (c + 2) % 3;
+            int c0 = (r + 1) % 3, c1 = (r + 2) % 3;
+            triangle.inverse_base[r][c] = (m[r0][c0] * m[r1][c1]
+                - m[r0][c1] * m[r1][c0]) / determinant;
+          }
+        }
+        triangles_.push_back(triangle);
+      }
+    }
+  }
+  assert(!triangles_.empty());
+}
+
+void VBAPBinauralRenderer::GetSpeakerGains(float elevation_deg,
+                                           float azimuth_deg,
+                                           std::vector<float>* gains) const {
+  assert(gains);
+  float p[3];
+  DirectionToVector(elevation_deg, azimuth_deg, p);
+
+  // Pick the triangle with the largest minimum gain, which is non-negative
+  // for the triangle containing the direction.
+  int best_triangle = 0;
+  float best_gains[3] = { 0.0f, 0.0f, 0.0f };
+  float best_min_gain = -HUGE_VALF;
+  for (int t = 0; t < triangles_.size(); ++t) {
+    float g[3];
+    for (int c = 0; c < 3; ++c) {
+      g[c] = p[0] * triangles_[t].inverse_base[0][c]
+          + p[1] * triangles_[t].inverse_base[1][c]
+          + p[2] * triangles_[t].inverse_base[2][c];
+    }
+    float min_gain = fmin(g[0], fmin(g[1], g[2]));
+    if (min_gain > best_min_gain) {
+      best_min_gain = min_gain;
+      best_triangle = t;
+      for (int c = 0; c < 3; ++c) {
+        best_gains[c] = g[c];
+      }
+    }
+  }
+
+  gains->assign(num_speakers_, 0.0f);
+  for (int c = 0; c < 3; ++c) {
+    int speaker = triangles_[best_triangle].speakers[c];
+    float gain = fmax(best_gains[c], 0.0f);
+    if (speaker < num_speakers_) {
+      (*gains)[speaker] += gain;
+    } else {
+      // The ring closed by an imaginary loudspeaker plays its share, so
+      // that directions at the poles do not fall silent.
+      for (int i = 0; i < lowest_ring_size_; ++i) {
+        (*gains)[i] += gain / lowest_ring_size_;
+      }
+    }
+  }
+  float power = 0.0f;
+  for (int i = 0; i < num_speakers_; ++i) {
+    power += (*gains)[i] * (*gains)[i];
+  }
+  if (power > 0.0f) {
+    float scale = 1.0f / sqrt(power);
+    for (int i = 0; i < num_speakers_; ++i) {
+      (*gains)[i] *= scale;
+    }
+  }
+}
+
+int VBAPBinauralRenderer::AddSource() {
+  Source source;
+  source.gains.assign(num_speakers_, 0.0f);
+  source.target_gains.assign(num_speakers_, 0.0f);
+  sources_.push_back(source);
+  return sources_.size() - 1;
+}
+
+void VBAPBinauralRenderer::SetSourceDirection(int source_id,
+                                              float elevation_deg,
+                                              float azimuth_deg,
+                                              float distance) {
+  assert(source_id >= 0 && source_id < sources_.size());
+  Source& source = sources_[source_id];
+  GetSpeakerGains(elevation_deg, azimuth_deg, &source.target_gains);
+  float damping = GetDistanceDamping(distance);
+  for (int i = 0; i < num_speakers_; ++i) {
+    source.target_gains[i] *= damping;
+  }
+}
+
+void VBAPBinauralRenderer::AddSourceBlock(int source_id,
+                                          const std::vector<float>& input) {
+  assert(source_id >= 0 && source_id < sources_.size());
+  Source& source = sources_[source_id];
+  for (int i = 0; i < num_speakers_; ++i) {
+    MixWithGainRamp(input, source.gains[i], source.target_gains[i],
+                    &buses_[i]);
+    source.gains[i] = source.target_gains[i];
+  }
+}
+
+void VBAPBinauralRenderer::ProcessBlock(std::vector<float>* output_left,
+                                        std::vector<float>* output_right) {
+  assert(output_left && output_right);
+  std::vector<float>* outputs[2] = { output_left, output_right };
+  for (int ear = 0; ear < 2; ++ear) {
+    outputs[ear]->assign(block_size_, 0.0f);
+    for (int i = 0; i < num_speakers_; ++i) {
+      speaker_filters_[ear][i]->AddSignalBlock(buses_[i]);
+      speaker_filters_[ear][i]->GetResult(&filtered_bus_);
+      for (int j = 0; j < block_size_; ++j) {
+        (*outputs[ear])[j] += filtered_bus_[j];
+      }
+    }
+  }
+  for (int i = 0; i < num_speakers_; ++i) {
+    buses_[i].assign(block_size_, 0.0f);
+  }
+}
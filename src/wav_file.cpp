@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "wav_file.h"
+#include "wav_format.h"
+
+using namespace std;
+
+namespace {
+
+const int kHeaderSize = 44;
+
+// Converts |num_samples| samples that are |input_stride| bytes apart.
+void DecodeSamples(const unsigned char* input, int input_stride,
+                   int audio_format, int bytes_per_sample, int num_samples,
+                   float* output, int output_stride) {
+  if (audio_format == kWavFormatFloat) {
+    for (int i = 0; i < num_samples; ++i, input += input_stride) {
+      unsigned int bits = DecodeLE32(input);
+      memcpy(&output[i * output_stride], &bits, 4);
+    }
+  } else if (bytes_per_sample == 2) {
+    for (int i = 0; i < num_samples; ++i, input += input_stride) {
+      output[i * output_stride] = PCM16ToFloat(DecodeLE16(input));
+    }
+  } else {
+    for (int i = 0; i < num_samples; ++i, input += input_stride) {
+      output[i * output_stride] = DecodeLE24(input) * (1.0f / 8388608.0f);
+    }
+  }
+}
+
+// Writes the header of a float WAV file with |data_size| bytes of samples.
+bool WriteFloatHeader(FILE* file, int sample_rate, int num_channels,
+                      long long data_size) {
+  // Sizes beyond the 32-bit RIFF limit are clamped, WavReader then reads
+  // up to the end of the file.
+  unsigned int clamped_size = min<long long>(data_size,
+                                             0xFFFFFFFFLL - kHeaderSize);
+  unsigned char header[kHeaderSize];
+  memcpy(header, "RIFF", 4);
+  EncodeLE32(kHeaderSize - 8 + clamped_size, header + 4);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  EncodeLE32(16, header + 16);
+  EncodeLE16(kWavFormatFloat, header + 20);
+  EncodeLE16(num_channels, header + 22);
+  EncodeLE32(sample_rate, header + 24);
+  EncodeLE32(sample_rate * num_channels * 4, header + 28);
+  EncodeLE16(num_channels * 4, header + 32);
+  EncodeLE16(32, header + 34);
+  memcpy(header + 36, "data", 4);
+  EncodeLE32(clamped_size, header + 40);
+  return fseek(file, 0, SEEK_SET) == 0
+      && fwrite(header, 1, kHeaderSize, file) == kHeaderSize;
+}
+
+}  // namespace
+
+WavReader::WavReader()
+    : map_(0),
+      map_size_(0),
+      released_size_(0),
+      data_(0),
+      audio_format_(0),
+      bytes_per_sample_(0),
+      sample_rate_(0),
+      num_channels_(0),
+      num_frames_(0) {
+}
+
+WavReader::~WavReader() {
+  Close();
+}
+
+bool WavReader::Open(const string& file_name) {
+  Close();
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    cerr << "Cannot open WAV file: " << file_name << endl;
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    void* map = mmap(0, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      map_ = static_cast<unsigned char*>(map);
+      map_size_ = file_stat.st_size;
+      madvise(map_, map_size_, MADV_SEQUENTIAL);
+    }
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  if (!map_ || !ParseHeader()) {
+    cerr << "Unsupported or invalid WAV file: " << file_name << endl;
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void WavReader::Close() {
+  if (map_) {
+    munmap(map_, map_size_);
+  }
+  map_ = 0;
+  map_size_ = 0;
+  released_size_ = 0;
+  data_ = 0;
+  num_channels_ = 0;
+  num_frames_ = 0;
+}
+
+int WavReader::GetSampleRate() const {
+  return sample_rate_;
+}
+
+int WavReader::GetNumChannels() const {
+  return num_channels_;
+}
+
+int WavReader::GetNumFrames() const {
+  return num_frames_;
+}
+
+void WavReader::ReadChannel(int channel, int frame, int num_frames,
+                            float* output) const {
+  assert(channel >= 0 && channel < num_channels_);
+  assert(frame >= 0 && num_frames >= 0 && output);
+  int num_valid_frames = max(0, min(num_frames, num_frames_ - frame));
+  if (num_valid_frames > 0) {
+    int block_align = num_channels_ * bytes_per_sample_;
+    DecodeSamples(data_ + static_cast<size_t>(frame) * block_align
+                      + channel * bytes_per_sample_,
+                  block_align, audio_format_, bytes_per_sample_,
+                  num_valid_frames, output, 1);
+  }
+  fill(output + num_valid_frames, output + num_frames, 0.0f);
+}
+
+void WavReader::ReadFrames(int frame, int num_frames, float* output) const {
+  assert(frame >= 0 && num_frames >= 0 && output);
+  int num_valid_frames = max(0, min(num_frames, num_frames_ - frame));
+  if (num_valid_frames > 0) {
+    DecodeSamples(data_ + static_cast<size_t>(frame) * num_channels_
+                      * bytes_per_sample_,
+                  bytes_per_sample_, audio_format_, bytes_per_sample_,
+                  num_valid_frames * num_channels_, output, 1);
+  }
+  fill(output + num_valid_frames * num_channels_,
+       output + num_frames * num_channels_, 0.0f);
+}
+
+void WavReader::ReleaseFrames(int frame) {
+  assert(frame >= 0);
+  if (!map_) {
+    return;
+  }
+  size_t page_size = sysconf(_SC_PAGESIZE);
+  size_t offset = data_ - map_ + static_cast<size_t>(min(frame, num_frames_))
+      * num_channels_ * bytes_per_sample_;
+  offset -= offset % page_size;
+  if (offset > released_size_) {
+    madvise(map_ + released_size_, offset - released_size_, MADV_DONTNEED);
+    released_size_ = offset;
+  }
+}
+
+bool WavReader::ParseHeader() {
+  WavFormat format;
+  if (!ParseWavHeader(map_, map_size_, &format)) {
+    return false;
+  }
+  audio_format_ = format.audio_format;
+  num_channels_ = format.num_channels;
+  sample_rate_ = format.sample_rate;
+  if (num_channels_ <= 0 || sample_rate_ <= 0
+      || !((audio_format_ == kWavFormatPCM
+            && (format.bits_per_sample == 16 || format.bits_per_sample == 24))
+           || (audio_format_ == kWavFormatFloat
+               && format.bits_per_sample == 32))) {
+    return false;
+  }
+  bytes_per_sample_ = format.bits_per_sample / 8;
+  // Truncated files hold fewer bytes than the chunk size claims. A zero
+  // size, left by a writer that was not closed, and the clamped size of
+  // files beyond 4 GB read up to the end of the file.
+  size_t data_size = format.data_size;
+  if (data_size > map_size_ - format.data_offset || data_size == 0
+      || data_size == 0xFFFFFFFFu - kHeaderSize) {
+    data_size = map_size_ - format.data_offset;
+  }
+  data_ = map_ + format.data_offset;
+  num_frames_ = data_size / (num_channels_ * bytes_per_sample_);
+  return true;
+}
+
+WavWriter::WavWriter(int frames_per_buffer, int num_buffers)
+    : frames_per_buffer_(frames_per_buffer),
+      sample_rate_(0),
+      num_channels_(0),
+      file_(0),
+      buffers_(num_buffers),
+      fill_buffer_(-1),
+      fill_size_(0),
+      num_samples_(0),
+      closing_(false),
+      write_failed_(false) {
+  assert(frames_per_buffer > 0 && num_buffers > 0);
+}
+
+WavWriter::~WavWriter() {
+  Close();
+}
+
+bool WavWriter::Open(const string& file_name, int sample_rate,
+                     int num_channels) {
+  assert(num_channels > 0);
+  Close();
+  file_ = fopen(file_name.c_str(), "wb");
+  if (!file_ || !WriteFloatHeader(file_, sample_rate, num_channels, 0)) {
+    cerr << "Cannot create WAV file: " << file_name << endl;
+    if (file_) {
+      fclose(file_);
+      file_ = 0;
+    }
+    return false;
+  }
+  file_name_ = file_name;
+  sample_rate_ = sample_rate;
+  num_channels_ = num_channels;
+  num_samples_ = 0;
+  write_failed_ = false;
+  closing_ = false;
+  free_buffers_.clear();
+  for (int i = 0; i < buffers_.size(); ++i) {
+    buffers_[i].resize(frames_per_buffer_ * num_channels_);
+    free_buffers_.push_back(i);
+  }
+  thread_ = thread(&WavWriter::WriterLoop, this);
+  return true;
+}
+
+bool WavWriter::Write(const float* frames, int num_frames) {
+  assert(file_ && frames);
+  int buffer_size = frames_per_buffer_ * num_channels_;
+  int num_samples = num_frames * num_channels_;
+  while (num_samples > 0) {
+    if (fill_buffer_ < 0) {
+      unique_lock<mutex> lock(mutex_);
+      while (free_buffers_.empty()) {
+        free_cv_.wait(lock);
+      }
+      fill_buffer_ = free_buffers_.back();
+      free_buffers_.pop_back();
+      fill_size_ = 0;
+    }
+    int num_copied = min(num_samples, buffer_size - fill_size_);
+    copy(frames, frames + num_copied, &buffers_[fill_buffer_][fill_size_]);
+    fill_size_ += num_copied;
+    frames += num_copied;
+    num_samples -= num_copied;
+    if (fill_size_ == buffer_size) {
+      QueueBuffer();
+    }
+  }
+  lock_guard<mutex> lock(mutex_);
+  return !write_failed_;
+}
+
+bool WavWriter::Close() {
+  if (!file_) {
+    return true;
+  }
+  if (fill_buffer_ >= 0) {
+    QueueBuffer();
+  }
+  {
+    lock_guard<mutex> lock(mutex_);
+    closing_ = true;
+  }
+  queue_cv_.notify_one();
+  thread_.join();
+
+  bool success = !write_failed_
+      && WriteFloatHeader(file_, sample_rate_, num_channels_,
+                          num_samples_ * 4);
+  success = fclose(file_) == 0 && success;
+  file_ = 0;
+  if (!success) {
+    cerr << "Cannot write WAV file: " << file_name_ << endl;
+  }
+  return success;
+}
+
+void WavWriter::QueueBuffer() {
+  assert(fill_buffer_ >= 0);
+  {
+    lock_guard<mutex> lock(mutex_);
+    queue_.push_back(make_pair(fill_buffer_, fill_size_));
+  }
+  queue_cv_.notify_one();
+  num_samples_ += fill_size_;
+  fill_buffer_ = -1;
+  fill_size_ = 0;
+}
+
+void WavWriter::WriterLoop() {
+  vector<unsigned char> bytes(4 * frames_per_buffer_ * num_channels_);
+  while (true) {
+    pair<int, int> item;
+    {
+      unique_lock<mutex> lock(mutex_);
+      while (queue_.empty() && !closing_) {
+        queue_cv_.wait(lock);
+      }
+      if (queue_.empty()) {
+        return;
+      }
+      item = queue_.front();
+      queue_.pop_front();
+    }
+
+    // Encodes explicitly to keep the byte order independent of the host.
+    const vector<float>& buffer = buffers_[item.first];
+    for (int i = 0; i < item.second; ++i) {
+      unsigned int bits;
+      memcpy(&bits, &buffer[i], 4);
+      EncodeLE32(bits, &bytes[4 * i]);
+    }
+    bool success = fwrite(&bytes[0], 1, 4 * item.second, file_)
+        == 4 * item.second;
+    {
+      lock_guard<mutex> lock(mutex_);
+      write_failed_ = write_failed_ || !success;
+      free_buffers_.push_back(item.first);
+    }
+    free_cv_.notify_one();
+  }
+}
+
+bool ReadWavFile(const string& file_name, int* sample_rate,
+                 int* num_channels, vector<float>* samples) {
+  assert(sample_rate && num_channels && samples);
+  WavReader reader;
+  if (!reader.Open(file_name)) {
+    return false;
+  }
+  *sample_rate = reader.GetSampleRate();
+  *num_channels = reader.GetNumChannels();
+  samples->resize(static_cast<size_t>(reader.GetNumFrames())
+                  * reader.GetNumChannels());
+  if (!samples->empty()) {
+    reader.ReadFrames(0, reader.GetNumFrames(), &(*samples)[0]);
+  }
+  return true;
+}
+
+bool WriteWavFile(const string& file_name, int sample_rate, int num_channels,
+                  const vector<float>& samples) {
+  assert(num_channels > 0);
+  WavWriter writer(4096, 2);
+  if (!writer.Open(file_name, sample_rate, num_channels)) {
+    return false;
+  }
+  if (!samples.empty()) {
+    writer.Write(&samples[0], samples.size() / num_channels);
+  }
+  return writer.Close();
+}
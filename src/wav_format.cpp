@@ -0,0 +1,79 @@
+#include <assert.h>
+#include <cmath>
+#include <cstring>
+
+#include "wav_format.h"
+
+int DecodeLE16(const unsigned char* data) {
+  return static_cast<short>(data[0] | (data[1] << 8));
+}
+
+int DecodeLE24(const unsigned char* data) {
+  // Shifts the sign bit of the 24-bit value into bit 31.
+  return static_cast<int>((data[0] << 8) | (data[1] << 16)
+      | (static_cast<unsigned int>(data[2]) << 24)) >> 8;
+}
+
+int DecodeLE32(const unsigned char* data) {
+  return static_cast<int>(data[0] | (data[1] << 8) | (data[2] << 16)
+      | (static_cast<unsigned int>(data[3]) << 24));
+}
+
+void EncodeLE16(int value, unsigned char* data) {
+  data[0] = value & 0xFF;
+  data[1] = (value >> 8) & 0xFF;
+}
+
+void EncodeLE32(int value, unsigned char* data) {
+  unsigned int unsigned_value = value;
+  for (int i = 0; i < 4; ++i) {
+    data[i] = (unsigned_value >> (8 * i)) & 0xFF;
+  }
+}
+
+float PCM16ToFloat(int value) {
+  return value * (1.0f / 32768.0f);
+}
+
+int FloatToPCM16(float value) {
+  long sample = lrint(value * 32768.0f);
+  return sample < -32768 ? -32768 : (sample > 32767 ? 32767 : sample);
+}
+
+bool ParseWavHeader(const unsigned char* data, size_t size,
+                    WavFormat* format) {
+  assert(data && format);
+  if (size < 12 || memcmp(data, "RIFF", 4) != 0
+      || memcmp(data + 8, "WAVE", 4) != 0) {
+    return false;
+  }
+  bool format_found = false;
+  size_t offset = 12;
+  while (offset + 8 <= size) {
+    const unsigned char* chunk = data + offset;
+    size_t chunk_size = static_cast<unsigned int>(DecodeLE32(chunk + 4));
+    offset += 8;
+    if (memcmp(chunk, "fmt ", 4) == 0) {
+      if (chunk_size < 16 || offset + chunk_size > size) {
+        return false;
+      }
+      const unsigned char* fmt = data + offset;
+      format->audio_format = DecodeLE16(fmt) & 0xFFFF;
+      format->num_channels = DecodeLE16(fmt + 2);
+      format->sample_rate = DecodeLE32(fmt + 4);
+      format->bits_per_sample = DecodeLE16(fmt + 14);
+      if (format->audio_format == kWavFormatExtensible && chunk_size >= 26) {
+        // The first two bytes of the sub format GUID hold the format code.
+        format->audio_format = DecodeLE16(fmt + 24);
+      }
+      format_found = true;
+    } else if (memcmp(chunk, "data", 4) == 0) {
+      format->data_offset = offset;
+      format->data_size = chunk_size;
+      return format_found;
+    }
+    // Chunks are padded to an even number of bytes.
+    offset += chunk_size + (chunk_size & 1);
+  }
+  return false;
+}
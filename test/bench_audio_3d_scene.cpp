@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "audio_3d.h"
+#include "audio_3d_scene.h"
+
+using namespace std;
+
+// Renders |num_sources| sources of which every fourth moves and switches its
+// HRTF each block, and reports the block time and the scheduler overhead of
+// the work-stealing renderer for an increasing number of threads and both
+// summation modes.
+int main(int argc, char** argv) {
+  int sample_rate = 48000;
+  int block_size = 256;
+  int num_sources = 64;
+  int num_blocks = 200;
+  if (argc > 1) {
+    num_sources = atoi(argv[1]);
+  }
+
+  vector<vector<float> > inputs(num_sources, vector<float>(block_size));
+  vector<float> output(2 * block_size);
+  double realtime_ms = 1000.0 * block_size / sample_rate;
+  for (int mode = 0; mode < 2; ++mode) {
+    for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+      Audio3DScene scene(sample_rate, block_size);
+      scene.SetNumThreads(num_threads);
+      scene.SetSummationMode(mode == 0 ? Audio3DScene::kTimeDomainSummation
+          : Audio3DScene::kFrequencyDomainSummation);
+      for (int i = 0; i < num_sources; ++i) {
+        scene.AddSource();
+        scene.GetSource(i)->SetDirection(0.0f, i * 5 % 360 - 180.0f, 2.0f);
+      }
+
+      double wall_ms = 0.0;
+      double max_wall_ms = 0.0;
+      double overhead_ms = 0.0;
+      int num_steals = 0;
+      for (int block = 0; block < num_blocks; ++block) {
+        for (int i = 0; i < num_sources; ++i) {
+          for (int j = 0; j < block_size; ++j) {
+            inputs[i][j] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+          }
+          if (i % 4 == 0) {
+            scene.GetSource(i)->SetDirection(0.0f,
+                                             (block * 10 + i) % 360 - 180.0f,
+                                             2.0f);
+          }
+        }
+        scene.ProcessBlock(inputs, &output[0]);
+
+        const ThreadPool::Stats& stats = scene.GetSchedulerStats();
+        wall_ms += 1000.0 * stats.wall_seconds;
+        max_wall_ms = max(max_wall_ms, 1000.0 * stats.wall_seconds);
+        overhead_ms += 1000.0 * (stats.wall_seconds
+            - stats.task_seconds / scene.GetNumThreads());
+        num_steals += stats.num_steals;
+      }
+      cout << (mode == 0 ? "Time" : "Frequency") << " domain summation"
+          << " Threads: " << scene.GetNumThreads() << " Sources: "
+          << num_sources << " Render time per block: "
+          << wall_ms / num_blocks << " ms Worst block: " << max_wall_ms
+          << " ms Scheduler overhead per block: "
+          << overhead_ms / num_blocks << " ms Steals per block: "
+          << static_cast<double>(num_steals) / num_blocks
+          << " (realtime budget " << realtime_ms << " ms)" << endl;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,46 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "hrtf.h"
+
+// Reports the HRTF bank construction time for every number of worker
+// threads from 1 to the number of hardware threads.
+int main(int argc, char** argv) {
+  int sample_rate = 48000;
+  int block_size = 256;
+  int num_runs = 5;
+  if (argc > 1) {
+    sample_rate = atoi(argv[1]);
+  }
+  if (argc > 2) {
+    block_size = atoi(argv[2]);
+  }
+
+  int max_threads = std::thread::hardware_concurrency();
+  if (max_threads <= 0) {
+    max_threads = 1;
+  }
+
+  double single_thread_ms = 0.0;
+  for (int num_threads = 1; num_threads <= max_threads; ++num_threads) {
+    double total_ms = 0.0;
+    for (int run = 0; run < num_runs; ++run) {
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      HRTF hrtf(sample_rate, block_size, num_threads);
+      std::chrono::steady_clock::time_point end =
+          std::chrono::steady_clock::now();
+      total_ms += std::chrono::duration<double, std::milli>(end - start)
+          .count();
+    }
+    double mean_ms = total_ms / num_runs;
+    if (num_threads == 1) {
+      single_thread_ms = mean_ms;
+    }
+    std::cout << "Threads: " << num_threads << " Build time: " << mean_ms
+        << " ms Speedup: " << single_thread_ms / mean_ms << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "basis_binaural_renderer.h"
+#include "hrtf.h"
+#include "hrtf_basis.h"
+
+using namespace std;
+
+// Reports the approximation error of the HRTF principal-component basis for
+// an increasing number of basis filters, and the time to render a block of
+// |num_sources| moving sources through the basis renderer.
+int main(int argc, char** argv) {
+  int sample_rate = 48000;
+  int block_size = 256;
+  int num_sources = 64;
+  int num_blocks = 200;
+  if (argc > 1) {
+    num_sources = atoi(argv[1]);
+  }
+
+  HRTF hrtf(sample_rate, block_size);
+  int filter_size = hrtf.GetMinimumPhaseFilterSize();
+
+  HRTFBasis full_basis(hrtf, filter_size);
+  cout << "Minimum-phase filter size: " << filter_size << endl;
+  for (int k = 1; k <= filter_size; k *= 2) {
+    cout << "Basis filters: " << k << " Relative error: "
+        << full_basis.GetApproximationError(k) << endl;
+  }
+
+  vector<float> input(block_size);
+  vector<float> left;
+  vector<float> right;
+  for (int k = 4; k <= 32; k *= 2) {
+    HRTFBasis basis(hrtf, k);
+    BasisBinauralRenderer renderer(hrtf, basis, block_size);
+    for (int i = 0; i < num_sources; ++i) {
+      renderer.AddSource();
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int block = 0; block < num_blocks; ++block) {
+      for (int i = 0; i < num_sources; ++i) {
+        for (int j = 0; j < block_size; ++j) {
+          input[j] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+        }
+        renderer.SetSourceDirection(i, 0.0f, (block + i * 7) % 360 - 180.0f,
+                                    2.0f);
+        renderer.AddSourceBlock(i, input);
+      }
+      renderer.ProcessBlock(&left, &right);
+    }
+    chrono::steady_clock::time_point end = chrono::steady_clock::now();
+    double block_ms = chrono::duration<double, milli>(end - start).count()
+        / num_blocks;
+    double realtime_ms = 1000.0 * block_size / sample_rate;
+    cout << "Basis filters: " << k << " Sources: " << num_sources
+        << " Block time: " << block_ms << " ms (" << 100.0 * block_ms
+        / realtime_ms << "% of realtime)" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "listener_geometry.h"
+
+using namespace std;
+
+// Compares the batch transform of |num_sources| source positions with one
+// scalar atan2()/sqrt() conversion per source.
+int main(int argc, char** argv) {
+  int num_sources = 4096;
+  int num_runs = 1000;
+  if (argc > 1) {
+    num_sources = atoi(argv[1]);
+  }
+
+  vector<float> x(num_sources), y(num_sources), z(num_sources);
+  for (int i = 0; i < num_sources; ++i) {
+    x[i] = 20.0f * rand() / RAND_MAX - 10.0f;
+    y[i] = 20.0f * rand() / RAND_MAX - 10.0f;
+    z[i] = 20.0f * rand() / RAND_MAX - 10.0f;
+  }
+  vector<float> elevation(num_sources), azimuth(num_sources),
+      distance(num_sources);
+  ListenerPose listener;
+  listener.position[0] = 0.5f;
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int run = 0; run < num_runs; ++run) {
+    for (int i = 0; i < num_sources; ++i) {
+      float dx = x[i] - listener.position[0];
+      float horizontal = sqrt(dx * dx + y[i] * y[i]);
+      distance[i] = sqrt(horizontal * horizontal + z[i] * z[i]);
+      elevation[i] = atan2(z[i], horizontal) * 180.0f / M_PI;
+      azimuth[i] = atan2(dx, y[i]) * 180.0f / M_PI;
+    }
+  }
+  double scalar_us = chrono::duration<double, micro>(
+      chrono::steady_clock::now() - start).count() / num_runs;
+
+  start = chrono::steady_clock::now();
+  for (int run = 0; run < num_runs; ++run) {
+    TransformToSpherical(listener, &x[0], &y[0], &z[0], num_sources,
+                         &elevation[0], &azimuth[0], &distance[0]);
+  }
+  double batch_us = chrono::duration<double, micro>(
+      chrono::steady_clock::now() - start).count() / num_runs;
+
+  cout << "Sources: " << num_sources << " Scalar: " << scalar_us
+      << " us Batch: " << batch_us << " us per block" << endl;
+  return 0;
+}
@@ -1,7 +1,7 @@
 
+#include <algorithm>
 #include <assert.h>
 #include <iostream>
-#include <vector>
 
 #include <termios.h>
 #include <unistd.h>
@@ -17,6 +17,8 @@ static float elevation_deg = 0;
 static float azimuth_deg = 0;
 static float distance = 1;
 
+static const float silence[2 * kFramesPerBuffer] = { 0.0f };
+
 static int AudioCallback( const void *inputBuffer, void *outputBuffer,
                          unsigned long framesPerBuffer,
                          const PaStreamCallbackTimeInfo* timeInfo,
@@ -25,7 +27,6 @@ static int AudioCallback( const void *inputBuffer, void *outputBuffer,
 {
     float *out = (float*)outputBuffer;
     const float *in = (const float*)inputBuffer;
-    unsigned int i;
     (void) timeInfo; /* Prevent unused variable warnings. */
     (void) statusFlags;
     Audio3DSource* audio_3d = reinterpret_cast<Audio3DSource*>(userData);
@@ -33,26 +34,26 @@ static int AudioCallback( const void *inputBuffer, void *outputBuffer,
 
     audio_3d->SetDirection(elevation_deg, azimuth_deg, distance);
 
-    std::vector<float> input(framesPerBuffer, 0.0f);
-    if( inputBuffer != 0 )
+    // Renders straight from the stereo input, downmixed to mono, into the
+    // interleaved output buffer without allocating. The host may pick any
+    // buffer size, ProcessFrames() rebuffers into blocks.
+    unsigned long frame = 0;
+    while( frame < framesPerBuffer )
     {
-        for( i=0; i<framesPerBuffer; i++ )
+        unsigned long num_frames = framesPerBuffer - frame;
+        const float *block_in;
+        if( in != 0 )
         {
-        	float left_sample = (*in++);
-        	float right_sample = (*in++);
-        	input[i] = (left_sample + right_sample) / 2.0;  // Mono downmix
+            block_in = in + 2 * frame;
         }
-    }
-
-    std::vector<float> output_left;
-    std::vector<float> output_right;
-    audio_3d->ProcessBlock(input, &output_left, &output_right);
-
-    assert(output_left.size()==framesPerBuffer);
-    assert(output_right.size()==framesPerBuffer);
-    for (int i=0; i<framesPerBuffer; ++i) {
-    	(*out++) = output_left[i];
-    	(*out++) = output_right[i];
+        else
+        {
+            num_frames = std::min<unsigned long>(num_frames, kFramesPerBuffer);
+            block_in = silence;
+        }
+        audio_3d->ProcessFrames(block_in, 2, num_frames, out + 2 * frame,
+                                out + 2 * frame + 1, 2);
+        frame += num_frames;
     }
 
     return paContinue;
@@ -95,7 +96,7 @@ int main(void)
               &inputParameters,
               &outputParameters,
               kSampleRate,
-              kFramesPerBuffer,
+              paFramesPerBufferUnspecified,
               paClipOff,
               AudioCallback,
               &audio_3d);
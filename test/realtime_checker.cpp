@@ -0,0 +1,152 @@
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+#include "gtest/gtest.h"
+#include "realtime_checker.h"
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void __libc_free(void* ptr);
+}
+
+namespace {
+
+const int kMaxViolations = 8;
+const int kMaxStackDepth = 32;
+
+struct Violation {
+  const char* call;
+  void* stack[kMaxStackDepth];
+  int stack_depth;
+};
+
+// Per-thread state, plain old data so that accessing it never allocates.
+__thread bool realtime_thread = false;
+__thread bool recording = false;
+__thread int num_violations = 0;
+__thread Violation violations[kMaxViolations];
+
+void CheckRealtimeCall(const char* call) {
+  if (!realtime_thread || recording) {
+    return;
+  }
+  recording = true;
+  if (num_violations < kMaxViolations) {
+    Violation& violation = violations[num_violations];
+    violation.call = call;
+    violation.stack_depth = backtrace(violation.stack, kMaxStackDepth);
+  }
+  ++num_violations;
+  recording = false;
+}
+
+typedef int (*MutexLockFunction)(pthread_mutex_t*);
+MutexLockFunction real_pthread_mutex_lock = 0;
+MutexLockFunction real_pthread_mutex_trylock = 0;
+
+}  // namespace
+
+ScopedRealtimeSection::ScopedRealtimeSection() {
+  // The first backtrace() loads libgcc, which allocates.
+  void* stack[1];
+  backtrace(stack, 1);
+  num_violations = 0;
+  realtime_thread = true;
+}
+
+ScopedRealtimeSection::~ScopedRealtimeSection() {
+  realtime_thread = false;
+  int num_recorded = std::min(num_violations, kMaxViolations);
+  for (int i = 0; i < num_recorded; ++i) {
+    const Violation& violation = violations[i];
+    std::ostringstream trace;
+    char** symbols = backtrace_symbols(violation.stack,
+                                       violation.stack_depth);
+    for (int j = 0; j < violation.stack_depth; ++j) {
+      trace << "  " << (symbols ? symbols[j] : "?") << "\n";
+    }
+    free(symbols);
+    ADD_FAILURE() << violation.call << " on a realtime thread:\n"
+        << trace.str();
+  }
+  if (num_violations > num_recorded) {
+    ADD_FAILURE() << num_violations - num_recorded
+        << " more realtime violations";
+  }
+  num_violations = 0;
+}
+
+int ScopedRealtimeSection::GetNumViolations() const {
+  return num_violations;
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+  CheckRealtimeCall("malloc()");
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) {
+  CheckRealtimeCall("calloc()");
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  CheckRealtimeCall("realloc()");
+  return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+  __libc_free(ptr);
+}
+
+// Resolved lazily; dlsym() itself does not go through these symbols.
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+  CheckRealtimeCall("pthread_mutex_lock()");
+  if (!real_pthread_mutex_lock) {
+    real_pthread_mutex_lock = reinterpret_cast<MutexLockFunction>(
+        dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+  }
+  return real_pthread_mutex_lock(mutex);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* mutex) {
+  CheckRealtimeCall("pthread_mutex_trylock()");
+  if (!real_pthread_mutex_trylock) {
+    real_pthread_mutex_trylock = reinterpret_cast<MutexLockFunction>(
+        dlsym(RTLD_NEXT, "pthread_mutex_trylock"));
+  }
+  return real_pthread_mutex_trylock(mutex);
+}
+
+}  // extern "C"
+
+void* operator new(size_t size) {
+  CheckRealtimeCall("operator new");
+  void* ptr = __libc_malloc(size > 0 ? size : 1);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  __libc_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  __libc_free(ptr);
+}
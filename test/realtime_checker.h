@@ -0,0 +1,23 @@
+#ifndef REALTIME_CHECKER_H_
+#define REALTIME_CHECKER_H_
+
+// Test-only detection of realtime-unsafe calls. Linking realtime_checker.cpp
+// into a test interposes malloc(), calloc(), realloc(), operator new and
+// pthread_mutex_lock(). While a ScopedRealtimeSection is alive on a thread,
+// every such call on that thread is recorded with its stack trace and
+// reported as a non-fatal gtest failure when the section ends. Requires
+// glibc and dynamic linking; link with -rdynamic for symbolized traces.
+class ScopedRealtimeSection {
+ public:
+  ScopedRealtimeSection();
+  ~ScopedRealtimeSection();
+
+  // Number of violations recorded so far in this section.
+  int GetNumViolations() const;
+
+ private:
+  ScopedRealtimeSection(const ScopedRealtimeSection&);
+  void operator=(const ScopedRealtimeSection&);
+};
+
+#endif  // REALTIME_CHECKER_H_
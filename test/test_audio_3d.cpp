@@ -0,0 +1,957 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "audio_3d.h"
+#include "audio_3d_scene.h"
+#include "fft_filter.h"
+#include "gtest/gtest.h"
+#include "hrtf.h"
+#include "output_stage.h"
+
+using namespace std;
+
+static const int kSampleRate = 44100;
+static const int kBlockSize = 256;
+
+// Renders a 500 Hz sine from the right and switches through all quality
+// tiers. A click shows up as a jump between neighboring samples well above
+// the slope of the sine.
+TEST(Audio3DSourceTest, QualityTierSwitchesAreSmooth) {
+  Audio3DSource source(kSampleRate, kBlockSize);
+  source.SetDirection(0.0f, 60.0f, 1.0f);
+
+  const Audio3DSource::QualityTier tiers[] = { Audio3DSource::kFullHRTF,
+      Audio3DSource::kTruncatedHRTF, Audio3DSource::kParametric,
+      Audio3DSource::kFullHRTF, Audio3DSource::kParametric,
+      Audio3DSource::kTruncatedHRTF, Audio3DSource::kFullHRTF };
+  const int kNumTiers = sizeof(tiers) / sizeof(tiers[0]);
+  const int kWarmUpBlocks = 40;
+  const int kBlocksPerTier = 10;
+
+  vector<float> input(kBlockSize);
+  vector<float> left;
+  vector<float> right;
+  int sample = 0;
+  float max_left = 0.0f;
+  float max_right = 0.0f;
+  float max_step_left = 0.0f;
+  float max_step_right = 0.0f;
+  float last_left = 0.0f;
+  float last_right = 0.0f;
+  float tier_energy[kNumTiers][2];
+
+  for (int block = 0; block < kWarmUpBlocks + kNumTiers * kBlocksPerTier;
+       ++block) {
+    int tier = (block - kWarmUpBlocks) / kBlocksPerTier;
+    if (block >= kWarmUpBlocks && (block - kWarmUpBlocks) % kBlocksPerTier
+        == 0) {
+      source.SetQualityTier(tiers[tier]);
+      EXPECT_EQ(tiers[tier], source.GetQualityTier());
+      tier_energy[tier][0] = 0.0f;
+      tier_energy[tier][1] = 0.0f;
+    }
+    for (int i = 0; i < kBlockSize; ++i, ++sample) {
+      input[i] = 0.5f * sin(2.0 * M_PI * 500.0 * sample / kSampleRate);
+    }
+    source.ProcessBlock(input, &left, &right);
+    ASSERT_EQ(kBlockSize, left.size());
+    ASSERT_EQ(kBlockSize, right.size());
+    if (block < kWarmUpBlocks) {
+      last_left = left.back();
+      last_right = right.back();
+      continue;
+    }
+    for (int i = 0; i < kBlockSize; ++i) {
+      max_left = fmax(max_left, fabs(left[i]));
+      max_right = fmax(max_right, fabs(right[i]));
+      max_step_left = fmax(max_step_left, fabs(left[i] - last_left));
+      max_step_right = fmax(max_step_right, fabs(right[i] - last_right));
+      last_left = left[i];
+      last_right = right[i];
+      tier_energy[tier][0] += left[i] * left[i];
+      tier_energy[tier][1] += right[i] * right[i];
+    }
+  }
+
+  EXPECT_GT(max_left, 0.0f);
+  EXPECT_LT(max_step_left, 0.15f * max_left);
+  EXPECT_LT(max_step_right, 0.15f * max_right);
+
+  // All tiers lateralize to the right at a similar level.
+  for (int tier = 0; tier < kNumTiers; ++tier) {
+    EXPECT_GT(tier_energy[tier][1], tier_energy[tier][0]);
+    float level_db = 10.0f * log10(tier_energy[tier][1]
+        / tier_energy[0][1]);
+    EXPECT_LT(fabs(level_db), 6.0f);
+  }
+}
+
+// A scene renders the sum of its sources, identical to standalone sources.
+// The reverb is linear, so one shared reverb of the summed sends matches
+// the per-source reverbs.
+// Compares the fused output stage with separate crossfade, gain ramp and
+// reverb passes for interleaved, planar and strided output. The odd number
+// of frames covers the scalar tail of the vectorized loop.
+// Power spectrum per ear of a source rendering white noise in
+// |quality_tier|, averaged over the blocks after the filters filled up.
+static void RenderNoiseSpectrum(Audio3DSource::QualityTier quality_tier,
+                                float azimuth_deg,
+                                vector<float> power_spectrum[2]) {
+  Audio3DSource source(kSampleRate, kBlockSize);
+  source.SetReverbSendLevel(0.0f);
+  source.SetDirection(0.0f, azimuth_deg, 1.0f);
+  source.SetQualityTier(quality_tier);
+
+  FFTFilter fft_filter(kBlockSize);
+  vector<float> input(kBlockSize);
+  vector<float> output[2];
+  vector<float> spectrum;
+  srand(1);
+  for (int ear = 0; ear < 2; ++ear) {
+    power_spectrum[ear].assign(kBlockSize + 1, 0.0f);
+  }
+  for (int block = 0; block < 80; ++block) {
+    for (int i = 0; i < kBlockSize; ++i) {
+      input[i] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+    }
+    source.ProcessBlock(input, &output[0], &output[1]);
+    for (int ear = 0; block >= 8 && ear < 2; ++ear) {
+      fft_filter.ForwardTransform(output[ear], &spectrum);
+      for (int bin = 0; bin <= kBlockSize; ++bin) {
+        power_spectrum[ear][bin] += spectrum[2 * bin] * spectrum[2 * bin]
+            + spectrum[2 * bin + 1] * spectrum[2 * bin + 1];
+      }
+    }
+  }
+}
+
+// The truncated minimum-phase tier keeps the magnitude response of the
+// full HRTF. Compared up to 4 kHz, above which the linear interpolation of
+// the fractional interaural delay rolls off the truncated tier.
+TEST(Audio3DSourceTest, MinimumPhaseMagnitudeMatchesFullHRTF) {
+  const int kMaxBin = 4000 * 2 * kBlockSize / kSampleRate;
+  for (int azimuth = -150; azimuth <= 150; azimuth += 60) {
+    vector<float> full[2];
+    vector<float> min_phase[2];
+    RenderNoiseSpectrum(Audio3DSource::kFullHRTF, azimuth, full);
+    RenderNoiseSpectrum(Audio3DSource::kTruncatedHRTF, azimuth, min_phase);
+    for (int ear = 0; ear < 2; ++ear) {
+      float max_power = *max_element(full[ear].begin(), full[ear].end());
+      float distance_db = 0.0f;
+      int num_bins = 0;
+      for (int bin = 0; bin <= kMaxBin; ++bin) {
+        if (full[ear][bin] > 1e-4f * max_power) {
+          distance_db += fabs(10.0f * log10(min_phase[ear][bin]
+              / full[ear][bin]));
+          ++num_bins;
+        }
+      }
+      EXPECT_LT(distance_db / num_bins, 1.0f) << "azimuth " << azimuth
+          << " ear " << ear;
+    }
+  }
+}
+
+TEST(OutputStageTest, MatchesSeparatePasses) {
+  const int kNumFrames = 37;
+  vector<float> next_left(kNumFrames), next_right(kNumFrames);
+  vector<float> previous_left(kNumFrames), previous_right(kNumFrames);
+  vector<float> fade_in(kNumFrames);
+  vector<float> reverb_left(kNumFrames), reverb_right(kNumFrames);
+  for (int i = 0; i < kNumFrames; ++i) {
+    next_left[i] = sin(0.3f * i);
+    next_right[i] = cos(0.2f * i);
+    previous_left[i] = 0.5f - 0.01f * i;
+    previous_right[i] = -0.25f + 0.02f * i;
+    fade_in[i] = static_cast<float>(i) / (kNumFrames - 1);
+    reverb_left[i] = 0.001f * i;
+    reverb_right[i] = -0.002f * i;
+  }
+
+  OutputStageInput stage;
+  stage.next_left = &next_left[0];
+  stage.next_right = &next_right[0];
+  stage.previous_left = &previous_left[0];
+  stage.previous_right = &previous_right[0];
+  stage.fade_in_window = &fade_in[0];
+  stage.reverb_left = &reverb_left[0];
+  stage.reverb_right = &reverb_right[0];
+  stage.start_gain = 1.0f;
+  stage.end_gain = 0.5f;
+
+  vector<float> expected_left(kNumFrames), expected_right(kNumFrames);
+  for (int i = 0; i < kNumFrames; ++i) {
+    float gain = 1.0f - 0.5f * (i + 1) / kNumFrames;
+    expected_left[i] = (previous_left[i] * (1.0f - fade_in[i])
+        + next_left[i] * fade_in[i]) * gain + reverb_left[i];
+    expected_right[i] = (previous_right[i] * (1.0f - fade_in[i])
+        + next_right[i] * fade_in[i]) * gain + reverb_right[i];
+  }
+
+  vector<float> interleaved(2 * kNumFrames);
+  RenderOutputStage(stage, kNumFrames, &interleaved[0], &interleaved[1], 2);
+  vector<float> left(kNumFrames), right(kNumFrames);
+  RenderOutputStage(stage, kNumFrames, &left[0], &right[0], 1);
+  vector<float> strided(3 * kNumFrames);
+  RenderOutputStage(stage, kNumFrames, &strided[0], &strided[2], 3);
+  for (int i = 0; i < kNumFrames; ++i) {
+    EXPECT_NEAR(expected_left[i], interleaved[2 * i], 1e-6f);
+    EXPECT_NEAR(expected_right[i], interleaved[2 * i + 1], 1e-6f);
+    EXPECT_NEAR(expected_left[i], left[i], 1e-6f);
+    EXPECT_NEAR(expected_right[i], right[i], 1e-6f);
+    EXPECT_NEAR(expected_left[i], strided[3 * i], 1e-6f);
+    EXPECT_NEAR(expected_right[i], strided[3 * i + 2], 1e-6f);
+  }
+
+  // Without crossfade and reverb only the gain ramp remains.
+  stage.previous_left = 0;
+  stage.previous_right = 0;
+  stage.reverb_left = 0;
+  stage.reverb_right = 0;
+  RenderOutputStage(stage, kNumFrames, &left[0], &right[0], 1);
+  for (int i = 0; i < kNumFrames; ++i) {
+    float gain = 1.0f - 0.5f * (i + 1) / kNumFrames;
+    EXPECT_NEAR(next_left[i] * gain, left[i], 1e-6f);
+    EXPECT_NEAR(next_right[i] * gain, right[i], 1e-6f);
+  }
+}
+
+TEST(Audio3DSourceTest, InterleavedOutputMatchesPlanar) {
+  Audio3DSource planar_source(kSampleRate, kBlockSize);
+  Audio3DSource interleaved_source(kSampleRate, kBlockSize);
+  vector<float> input(kBlockSize);
+  vector<float> left, right;
+  vector<float> interleaved(2 * kBlockSize);
+  for (int block = 0; block < 6; ++block) {
+    // Moving away exercises the damping ramp.
+    planar_source.SetDirection(0.0f, 20.0f * block, 1.0f + block);
+    interleaved_source.SetDirection(0.0f, 20.0f * block, 1.0f + block);
+    for (int i = 0; i < kBlockSize; ++i) {
+      input[i] = sin(0.05f * (block * kBlockSize + i));
+    }
+    planar_source.ProcessBlock(input, &left, &right);
+    interleaved_source.ProcessBlock(input, &interleaved[0]);
+    for (int i = 0; i < kBlockSize; ++i) {
+      ASSERT_EQ(left[i], interleaved[2 * i]);
+      ASSERT_EQ(right[i], interleaved[2 * i + 1]);
+    }
+  }
+}
+
+TEST(Audio3DSceneTest, MixesSources) {
+  const int kNumSources = 3;
+  Audio3DScene scene(kSampleRate, kBlockSize);
+  vector<Audio3DSource*> references;
+  for (int i = 0; i < kNumSources; ++i) {
+    EXPECT_EQ(i, scene.AddSource());
+    references.push_back(new Audio3DSource(kSampleRate, kBlockSize));
+  }
+  ASSERT_EQ(kNumSources, scene.GetNumSources());
+
+  vector<vector<float> > inputs(kNumSources, vector<float>(kBlockSize));
+  vector<float> interleaved(2 * kBlockSize);
+  vector<float> planar_left(kBlockSize);
+  vector<float> planar_right(kBlockSize);
+  vector<float> left;
+  vector<float> right;
+  for (int block = 0; block < 8; ++block) {
+    vector<float> expected_left(kBlockSize, 0.0f);
+    vector<float> expected_right(kBlockSize, 0.0f);
+    for (int i = 0; i < kNumSources; ++i) {
+      float azimuth = -90.0f + 90.0f * i + 5.0f * block;
+      scene.GetSource(i)->SetDirection(10.0f, azimuth, 1.0f + i);
+      references[i]->SetDirection(10.0f, azimuth, 1.0f + i);
+      for (int j = 0; j < kBlockSize; ++j) {
+        inputs[i][j] = sin(0.01f * (i + 1) * (block * kBlockSize + j));
+      }
+      references[i]->ProcessBlock(inputs[i], &left, &right);
+      for (int j = 0; j < kBlockSize; ++j) {
+        expected_left[j] += left[j];
+        expected_right[j] += right[j];
+      }
+    }
+
+    if (block % 2 == 0) {
+      scene.ProcessBlock(inputs, &interleaved[0]);
+      for (int j = 0; j < kBlockSize; ++j) {
+        planar_left[j] = interleaved[2 * j];
+        planar_right[j] = interleaved[2 * j + 1];
+      }
+    } else {
+      scene.ProcessBlock(inputs, &planar_left[0], &planar_right[0]);
+    }
+    for (int j = 0; j < kBlockSize; ++j) {
+      EXPECT_NEAR(expected_left[j], planar_left[j], 1e-5f);
+      EXPECT_NEAR(expected_right[j], planar_right[j], 1e-5f);
+    }
+  }
+  for (int i = 0; i < kNumSources; ++i) {
+    delete references[i];
+  }
+}
+
+// Renders a scene spanning several source chunks and returns the
+// concatenated interleaved output.
+static vector<float> RenderScene(int num_threads) {
+  const int kNumSources = 19;
+  const int kNumBlocks = 4;
+  Audio3DScene scene(kSampleRate, kBlockSize);
+  scene.SetNumThreads(num_threads);
+  for (int i = 0; i < kNumSources; ++i) {
+    scene.AddSource();
+    scene.GetSource(i)->SetDirection(0.0f, 19.0f * i - 170.0f,
+                                     1.0f + 0.1f * i);
+  }
+
+  vector<vector<float> > inputs(kNumSources, vector<float>(kBlockSize));
+  vector<float> output(2 * kBlockSize * kNumBlocks);
+  for (int block = 0; block < kNumBlocks; ++block) {
+    for (int i = 0; i < kNumSources; ++i) {
+      for (int j = 0; j < kBlockSize; ++j) {
+        inputs[i][j] = sin(0.003f * (i + 1) * (block * kBlockSize + j));
+      }
+    }
+    scene.ProcessBlock(inputs, &output[2 * kBlockSize * block]);
+  }
+  return output;
+}
+
+TEST(Audio3DSceneTest, OutputIndependentOfThreadCount) {
+  vector<float> reference = RenderScene(1);
+  const int num_threads[] = { 2, 3, 4 };
+  for (int t = 0; t < 3; ++t) {
+    vector<float> output = RenderScene(num_threads[t]);
+    ASSERT_EQ(reference.size(), output.size());
+    for (int i = 0; i < output.size(); ++i) {
+      ASSERT_EQ(reference[i], output[i]) << num_threads[t] << " threads";
+    }
+  }
+}
+
+// Moves sources on even blocks and switches quality tiers on odd blocks so
+// that both kinds of crossfade show up. The distance changes on every block.
+static vector<float> RenderMovingScene(
+    Audio3DScene::SummationMode summation_mode, bool half_float_bank) {
+  const int kNumSources = 4;
+  const int kNumBlocks = 12;
+  const Audio3DSource::QualityTier tiers[] = { Audio3DSource::kFullHRTF,
+      Audio3DSource::kTruncatedHRTF, Audio3DSource::kFullHRTF,
+      Audio3DSource::kParametric };
+  Audio3DScene scene(kSampleRate, kBlockSize);
+  scene.SetSummationMode(summation_mode);
+  if (half_float_bank) {
+    scene.UseHalfFloatHRTFBank();
+  }
+  for (int i = 0; i < kNumSources; ++i) {
+    scene.AddSource();
+  }
+
+  vector<vector<float> > inputs(kNumSources, vector<float>(kBlockSize));
+  vector<float> output(2 * kBlockSize * kNumBlocks);
+  for (int block = 0; block < kNumBlocks; ++block) {
+    for (int i = 0; i < kNumSources; ++i) {
+      Audio3DSource* source = scene.GetSource(i);
+      float distance = 1.0f + i + (block % 3 == 0 ? 0.0f : 0.7f * block);
+      source->SetDirection(10.0f * i, 30.0f * (block - block % 2) - 90.0f * i,
+                           distance);
+      if (block % 2 == 1 && i > 0) {
+        source->SetQualityTier(tiers[(block / 2 + i) % 4]);
+      }
+      for (int j = 0; j < kBlockSize; ++j) {
+        inputs[i][j] = sin(0.02f * (i + 1) * (block * kBlockSize + j));
+      }
+    }
+    scene.ProcessBlock(inputs, &output[2 * kBlockSize * block]);
+  }
+  return output;
+}
+
+TEST(Audio3DSceneTest, FrequencyDomainSummationMatchesTimeDomain) {
+  for (int half_float_bank = 0; half_float_bank < 2; ++half_float_bank) {
+    vector<float> expected = RenderMovingScene(
+        Audio3DScene::kTimeDomainSummation, half_float_bank);
+    vector<float> output = RenderMovingScene(
+        Audio3DScene::kFrequencyDomainSummation, half_float_bank);
+    ASSERT_EQ(expected.size(), output.size());
+    float max_level = 0.0f;
+    for (int i = 0; i < expected.size(); ++i) {
+      max_level = max(max_level, fabs(expected[i]));
+    }
+    ASSERT_GT(max_level, 0.01f);
+    for (int i = 0; i < expected.size(); ++i) {
+      EXPECT_NEAR(expected[i], output[i], 1e-5f * max_level) << i;
+    }
+  }
+}
+
+// Renders the same signal through the vector, interleaved stereo and planar
+// multichannel input overloads. Stereo input carries the signal on both
+// channels, so the mono downmix matches the vector input.
+TEST(Audio3DSourceTest, HostBufferInputMatchesVectorInput) {
+  Audio3DSource vector_source(kSampleRate, kBlockSize);
+  Audio3DSource interleaved_source(kSampleRate, kBlockSize);
+  Audio3DSource planar_source(kSampleRate, kBlockSize);
+  vector<float> input(kBlockSize);
+  vector<float> stereo_input(2 * kBlockSize);
+  vector<float> third_channel(kBlockSize);
+  vector<float> left, right;
+  vector<float> interleaved_output(2 * kBlockSize);
+  vector<float> planar_left(kBlockSize), planar_right(kBlockSize);
+  for (int block = 0; block < 4; ++block) {
+    vector_source.SetDirection(0.0f, -30.0f * block, 2.0f);
+    interleaved_source.SetDirection(0.0f, -30.0f * block, 2.0f);
+    planar_source.SetDirection(0.0f, -30.0f * block, 2.0f);
+    for (int i = 0; i < kBlockSize; ++i) {
+      input[i] = sin(0.07f * (block * kBlockSize + i));
+      stereo_input[2 * i] = input[i];
+      stereo_input[2 * i + 1] = input[i];
+      third_channel[i] = input[i];
+    }
+    const float* input_channels[] = { &input[0], &third_channel[0],
+                                      &input[0] };
+
+    vector_source.ProcessBlock(input, &left, &right);
+    interleaved_source.ProcessBlock(&stereo_input[0], 2,
+                                    &interleaved_output[0],
+                                    &interleaved_output[1], 2);
+    planar_source.ProcessBlock(input_channels, 3, &planar_left[0],
+                               &planar_right[0], 1);
+    for (int i = 0; i < kBlockSize; ++i) {
+      EXPECT_NEAR(left[i], interleaved_output[2 * i], 1e-6f);
+      EXPECT_NEAR(right[i], interleaved_output[2 * i + 1], 1e-6f);
+      EXPECT_NEAR(left[i], planar_left[i], 1e-6f);
+      EXPECT_NEAR(right[i], planar_right[i], 1e-6f);
+    }
+  }
+}
+
+TEST(Audio3DSceneTest, InterleavedInputMatchesVectorInput) {
+  const int kNumSources = 3;
+  Audio3DScene vector_scene(kSampleRate, kBlockSize);
+  Audio3DScene interleaved_scene(kSampleRate, kBlockSize);
+  for (int i = 0; i < kNumSources; ++i) {
+    vector_scene.AddSource();
+    interleaved_scene.AddSource();
+    vector_scene.GetSource(i)->SetDirection(0.0f, 60.0f * i, 1.5f);
+    interleaved_scene.GetSource(i)->SetDirection(0.0f, 60.0f * i, 1.5f);
+  }
+
+  vector<vector<float> > inputs(kNumSources, vector<float>(kBlockSize));
+  vector<float> interleaved_input(kNumSources * kBlockSize);
+  vector<float> expected(2 * kBlockSize);
+  vector<float> output(2 * kBlockSize);
+  for (int block = 0; block < 4; ++block) {
+    for (int i = 0; i < kNumSources; ++i) {
+      for (int j = 0; j < kBlockSize; ++j) {
+        inputs[i][j] = sin(0.01f * (i + 2) * (block * kBlockSize + j));
+        interleaved_input[j * kNumSources + i] = inputs[i][j];
+      }
+    }
+    vector_scene.ProcessBlock(inputs, &expected[0]);
+    interleaved_scene.ProcessBlock(&interleaved_input[0], &output[0],
+                                   &output[1], 2);
+    for (int i = 0; i < 2 * kBlockSize; ++i) {
+      ASSERT_EQ(expected[i], output[i]);
+    }
+  }
+}
+
+// Feeds the scene in host buffers of varying size. The output must equal
+// the block-wise output delayed by the FIFO latency.
+TEST(Audio3DSceneTest, VariableHostBufferSizesMatchBlockOutput) {
+  const int kNumSources = 2;
+  const int kNumBlocks = 6;
+  const int kNumFrames = kNumBlocks * kBlockSize;
+  Audio3DScene block_scene(kSampleRate, kBlockSize);
+  Audio3DScene fifo_scene(kSampleRate, kBlockSize);
+  for (int i = 0; i < kNumSources; ++i) {
+    block_scene.AddSource();
+    fifo_scene.AddSource();
+    block_scene.GetSource(i)->SetDirection(0.0f, 90.0f * i - 45.0f, 1.5f);
+    fifo_scene.GetSource(i)->SetDirection(0.0f, 90.0f * i - 45.0f, 1.5f);
+  }
+
+  vector<float> input(kNumSources * kNumFrames);
+  for (int i = 0; i < kNumFrames; ++i) {
+    for (int j = 0; j < kNumSources; ++j) {
+      input[i * kNumSources + j] = sin(0.02f * (j + 1) * i);
+    }
+  }
+  vector<float> expected(2 * kNumFrames);
+  for (int block = 0; block < kNumBlocks; ++block) {
+    block_scene.ProcessBlock(&input[block * kBlockSize * kNumSources],
+                             &expected[2 * block * kBlockSize],
+                             &expected[2 * block * kBlockSize + 1], 2);
+  }
+
+  const int kHostBufferSizes[] = { 1, 100, 0, 256, 511, 37, 64 };
+  vector<float> output(2 * kNumFrames);
+  int frame = 0;
+  for (int i = 0; frame < kNumFrames; ++i) {
+    int num_frames = min(kHostBufferSizes[i % 7], kNumFrames - frame);
+    fifo_scene.ProcessFrames(&input[frame * kNumSources], num_frames,
+                             &output[2 * frame], &output[2 * frame + 1], 2);
+    frame += num_frames;
+  }
+
+  int latency = fifo_scene.GetFifoLatency();
+  ASSERT_EQ(kBlockSize, latency);
+  for (int i = 0; i < 2 * latency; ++i) {
+    ASSERT_EQ(0.0f, output[i]);
+  }
+  for (int i = 2 * latency; i < 2 * kNumFrames; ++i) {
+    ASSERT_EQ(expected[i - 2 * latency], output[i]);
+  }
+}
+
+TEST(Audio3DSourceTest, VariableHostBufferSizesMatchBlockOutput) {
+  const int kNumBlocks = 5;
+  const int kNumFrames = kNumBlocks * kBlockSize;
+  Audio3DSource block_source(kSampleRate, kBlockSize);
+  Audio3DSource fifo_source(kSampleRate, kBlockSize);
+  block_source.SetDirection(10.0f, 70.0f, 2.0f);
+  fifo_source.SetDirection(10.0f, 70.0f, 2.0f);
+
+  vector<float> input(2 * kNumFrames);
+  for (int i = 0; i < 2 * kNumFrames; ++i) {
+    input[i] = sin(0.05f * i);
+  }
+  vector<float> expected(2 * kNumFrames);
+  for (int block = 0; block < kNumBlocks; ++block) {
+    block_source.ProcessBlock(&input[2 * block * kBlockSize], 2,
+                              &expected[2 * block * kBlockSize],
+                              &expected[2 * block * kBlockSize + 1], 2);
+  }
+
+  vector<float> output(2 * kNumFrames);
+  int frame = 0;
+  for (int i = 0; frame < kNumFrames; ++i) {
+    int num_frames = min(1 + (i * 97) % 300, kNumFrames - frame);
+    fifo_source.ProcessFrames(&input[2 * frame], 2, num_frames,
+                              &output[2 * frame], &output[2 * frame + 1], 2);
+    frame += num_frames;
+  }
+
+  int latency = fifo_source.GetFifoLatency();
+  for (int i = 2 * latency; i < 2 * kNumFrames; ++i) {
+    ASSERT_EQ(expected[i - 2 * latency], output[i]);
+  }
+}
+
+TEST(Audio3DSourceTest, SetPositionMatchesSetDirection) {
+  Audio3DSource position_source(kSampleRate, kBlockSize);
+  Audio3DSource direction_source(kSampleRate, kBlockSize);
+  position_source.SetPosition(2.0f, 0.0f, 0.0f);
+  direction_source.SetDirection(0.0f, 90.0f, 2.0f);
+
+  vector<float> input(kBlockSize);
+  vector<float> position_left, position_right;
+  vector<float> direction_left, direction_right;
+  for (int block = 0; block < 3; ++block) {
+    for (int i = 0; i < kBlockSize; ++i) {
+      input[i] = sin(0.03f * (block * kBlockSize + i));
+    }
+    position_source.ProcessBlock(input, &position_left, &position_right);
+    direction_source.ProcessBlock(input, &direction_left, &direction_right);
+    for (int i = 0; i < kBlockSize; ++i) {
+      EXPECT_NEAR(direction_left[i], position_left[i], 1e-5f);
+      EXPECT_NEAR(direction_right[i], position_right[i], 1e-5f);
+    }
+  }
+}
+
+// A listener turned 90 degrees to the left hears a source in front of the
+// room on its right.
+TEST(Audio3DSceneTest, ListenerPoseRotatesSources) {
+  Audio3DScene pose_scene(kSampleRate, kBlockSize);
+  Audio3DScene direction_scene(kSampleRate, kBlockSize);
+  pose_scene.AddSource();
+  direction_scene.AddSource();
+
+  ListenerPose listener;
+  listener.position[1] = -1.0f;
+  listener.orientation[0] = cos(M_PI / 4.0);
+  listener.orientation[3] = sin(M_PI / 4.0);
+  pose_scene.SetListenerPose(listener);
+  pose_scene.SetSourcePosition(0, 0.0f, 2.0f, 0.0f);
+  direction_scene.GetSource(0)->SetDirection(0.0f, 90.0f, 3.0f);
+
+  vector<vector<float> > inputs(1, vector<float>(kBlockSize));
+  vector<float> pose_output(2 * kBlockSize);
+  vector<float> direction_output(2 * kBlockSize);
+  for (int block = 0; block < 3; ++block) {
+    for (int i = 0; i < kBlockSize; ++i) {
+      inputs[0][i] = sin(0.03f * (block * kBlockSize + i));
+    }
+    pose_scene.ProcessBlock(inputs, &pose_output[0]);
+    direction_scene.ProcessBlock(inputs, &direction_output[0]);
+    for (int i = 0; i < 2 * kBlockSize; ++i) {
+      EXPECT_NEAR(direction_output[i], pose_output[i], 1e-5f);
+    }
+  }
+}
+
+// At 3.43 m the sound travels 10 ms, i.e. 441 samples at 44.1 kHz.
+TEST(Audio3DSourceTest, PropagationDelayShiftsOutput) {
+  const int kNumBlocks = 6;
+  const int kDelay = 441;
+  Audio3DSource source(kSampleRate, kBlockSize);
+  Audio3DSource delayed_source(kSampleRate, kBlockSize);
+  source.SetDirection(0.0f, 30.0f, 3.43f);
+  delayed_source.SetDirection(0.0f, 30.0f, 3.43f);
+  delayed_source.SetMaxDistance(20.0f);
+  EXPECT_EQ(20.0f, delayed_source.GetMaxDistance());
+
+  vector<float> input(kBlockSize);
+  vector<float> left, right, delayed_left, delayed_right;
+  vector<float> output, delayed_output;
+  for (int block = 0; block < kNumBlocks; ++block) {
+    for (int i = 0; i < kBlockSize; ++i) {
+      input[i] = sin(0.05f * (block * kBlockSize + i));
+    }
+    source.ProcessBlock(input, &left, &right);
+    delayed_source.ProcessBlock(input, &delayed_left, &delayed_right);
+    output.insert(output.end(), left.begin(), left.end());
+    delayed_output.insert(delayed_output.end(), delayed_left.begin(),
+                          delayed_left.end());
+  }
+  for (int i = kDelay + 2 * kBlockSize; i < kNumBlocks * kBlockSize; ++i) {
+    EXPECT_NEAR(output[i - kDelay], delayed_output[i], 1e-3f);
+  }
+}
+
+// Two sources play a 500 Hz sine and cosine from the same direction at
+// different levels. With a single voice the louder one plays; swapping the
+// levels virtualizes one source and resumes the other, which must not
+// click. The parametric tier has no HRTF onset that would smooth a hard
+// switch.
+TEST(Audio3DSceneTest, MaxVoicesSwitchesSmoothly) {
+  Audio3DScene scene(kSampleRate, kBlockSize);
+  for (int i = 0; i < 2; ++i) {
+    scene.AddSource();
+    scene.GetSource(i)->SetDirection(0.0f, 60.0f, 1.0f);
+    scene.GetSource(i)->SetQualityTier(Audio3DSource::kParametric);
+  }
+  scene.SetMaxVoices(1);
+  EXPECT_EQ(1, scene.GetMaxVoices());
+
+  const int kWarmUpBlocks = 20;
+  const int kSwapBlock = 30;
+  vector<vector<float> > inputs(2, vector<float>(kBlockSize));
+  vector<float> output(2 * kBlockSize);
+  int sample = 0;
+  float max_right = 0.0f;
+  float max_step_right = 0.0f;
+  float last_right = 0.0f;
+  for (int block = 0; block < 40; ++block) {
+    float level[2] = { 0.5f, 0.25f };
+    if (block >= kSwapBlock) {
+      swap(level[0], level[1]);
+    }
+    for (int i = 0; i < kBlockSize; ++i, ++sample) {
+      inputs[0][i] = level[0] * sin(2.0 * M_PI * 500.0 * sample
+          / kSampleRate);
+      inputs[1][i] = level[1] * cos(2.0 * M_PI * 500.0 * sample
+          / kSampleRate);
+    }
+    scene.ProcessBlock(inputs, &output[0]);
+    EXPECT_EQ(1, scene.GetNumVirtualSources());
+    if (block == kSwapBlock - 1 || block == kSwapBlock + 1) {
+      EXPECT_EQ(block > kSwapBlock, scene.GetSource(0)->IsVirtual());
+      EXPECT_EQ(block < kSwapBlock, scene.GetSource(1)->IsVirtual());
+    }
+    for (int i = 0; i < kBlockSize; ++i) {
+      float right = output[2 * i + 1];
+      if (block >= kWarmUpBlocks) {
+        max_right = fmax(max_right, fabs(right));
+        max_step_right = fmax(max_step_right, fabs(right - last_right));
+      }
+      last_right = right;
+    }
+  }
+  EXPECT_GT(max_right, 0.0f);
+  EXPECT_LT(max_step_right, 0.1f * max_right);
+}
+
+// A source turning virtual plays the filter tails of its fade-out. Turning
+// audible again, it starts from silence at the direction it moved to while
+// virtual in every quality tier, like a source that never played, instead
+// of playing the tails of the blocks before it turned virtual or gliding
+// from the previous HRTF.
+TEST(Audio3DSourceTest, ResumedVirtualSourceStartsFromSilence) {
+  HRTF hrtf(kSampleRate, kBlockSize);
+  const Audio3DSource::QualityTier tiers[] = { Audio3DSource::kFullHRTF,
+      Audio3DSource::kTruncatedHRTF, Audio3DSource::kParametric };
+  for (int tier = 0; tier < 3; ++tier) {
+    Audio3DSource source(hrtf, kBlockSize);
+    Audio3DSource reference(hrtf, kBlockSize);
+    source.SetDirection(0.0f, 60.0f, 1.0f);
+    reference.SetDirection(0.0f, -60.0f, 1.0f);
+    source.SetQualityTier(tiers[tier]);
+    reference.SetQualityTier(tiers[tier]);
+    vector<float> input(kBlockSize);
+    vector<float> silence(kBlockSize, 0.0f);
+    vector<float> left, right;
+    vector<float> reference_left, reference_right;
+    for (int block = 0; block < 4; ++block) {
+      for (int i = 0; i < kBlockSize; ++i) {
+        input[i] = 0.5f * sin(0.1f * (block * kBlockSize + i));
+      }
+      source.ProcessBlock(input, &left, &right);
+      reference.ProcessBlock(silence, &reference_left, &reference_right);
+    }
+    source.SetVirtual(true);
+    reference.SetVirtual(true);
+    source.ProcessBlock(input, &left, &right);
+    reference.ProcessBlock(silence, &reference_left, &reference_right);
+    EXPECT_FALSE(source.IsVirtual());
+    source.ProcessBlock(input, &left, &right);
+    reference.ProcessBlock(silence, &reference_left, &reference_right);
+    EXPECT_TRUE(source.IsVirtual());
+    float tail_level = 0.0f;
+    for (int i = 0; i < kBlockSize; ++i) {
+      tail_level = fmax(tail_level, fabs(left[i]) + fabs(right[i]));
+    }
+    EXPECT_GT(tail_level, 0.0f) << "tier " << tier;
+
+    source.SetDirection(0.0f, -60.0f, 1.0f);
+    source.ProcessBlock(input, &left, &right);
+    reference.ProcessBlock(silence, &reference_left, &reference_right);
+    EXPECT_TRUE(source.IsVirtual());
+
+    source.SetVirtual(false);
+    reference.SetVirtual(false);
+    for (int block = 0; block < 3; ++block) {
+      for (int i = 0; i < kBlockSize; ++i) {
+        input[i] = 0.5f * sin(0.1f * (block * kBlockSize + i));
+      }
+      source.ProcessBlock(input, &left, &right);
+      reference.ProcessBlock(input, &reference_left, &reference_right);
+      EXPECT_FALSE(source.IsVirtual());
+      for (int i = 0; i < kBlockSize; ++i) {
+        ASSERT_NEAR(reference_left[i], left[i], 1e-6f)
+            << "tier " << tier << " block " << block << " sample " << i;
+        ASSERT_NEAR(reference_right[i], right[i], 1e-6f)
+            << "tier " << tier << " block " << block << " sample " << i;
+      }
+    }
+  }
+}
+
+TEST(Audio3DSceneTest, SilentAndDistantSourcesTurnVirtual) {
+  Audio3DScene scene(kSampleRate, kBlockSize);
+  for (int i = 0; i < 3; ++i) {
+    scene.AddSource();
+  }
+  scene.GetSource(0)->SetDirection(0.0f, 0.0f, 1.0f);
+  scene.GetSource(1)->SetDirection(0.0f, 0.0f, 1.0f);
+  scene.GetSource(2)->SetDirection(0.0f, 0.0f, 1000.0f);
+  scene.SetAudibilityThreshold(0.01f);
+
+  vector<vector<float> > inputs(3, vector<float>(kBlockSize, 0.0f));
+  for (int i = 0; i < kBlockSize; ++i) {
+    inputs[0][i] = 0.5f * sin(0.1f * i);
+    inputs[2][i] = inputs[0][i];
+  }
+  vector<float> output(2 * kBlockSize);
+  for (int block = 0; block < 2; ++block) {
+    scene.ProcessBlock(inputs, &output[0]);
+  }
+  EXPECT_EQ(2, scene.GetNumVirtualSources());
+  EXPECT_FALSE(scene.GetSource(0)->IsVirtual());
+  EXPECT_TRUE(scene.GetSource(1)->IsVirtual());
+  EXPECT_TRUE(scene.GetSource(2)->IsVirtual());
+
+  scene.SetAudibilityThreshold(0.0f);
+  scene.ProcessBlock(inputs, &output[0]);
+  EXPECT_EQ(0, scene.GetNumVirtualSources());
+  EXPECT_FALSE(scene.GetSource(2)->IsVirtual());
+}
+
+// A budget far below any render time steps the quality down to the lowest
+// level, a budget far above it steps back up.
+TEST(Audio3DSceneTest, CPUBudgetGovernorStepsDownAndUp) {
+  const int kNumSources = 4;
+  Audio3DScene scene(kSampleRate, kBlockSize);
+  for (int i = 0; i < kNumSources; ++i) {
+    scene.AddSource();
+    scene.GetSource(i)->SetDirection(0.0f, 30.0f * i, 1.0f + 10.0f * i);
+  }
+  vector<vector<float> > inputs(kNumSources, vector<float>(kBlockSize));
+  for (int i = 0; i < kNumSources; ++i) {
+    for (int j = 0; j < kBlockSize; ++j) {
+      inputs[i][j] = sin(0.01f * (i + 1) * j);
+    }
+  }
+  vector<float> output(2 * kBlockSize);
+
+  scene.SetCPUBudget(1e-9f);
+  for (int block = 0; block < 6; ++block) {
+    scene.ProcessBlock(inputs, &output[0]);
+  }
+  const Audio3DScene::GovernorStats& stats = scene.GetGovernorStats();
+  EXPECT_EQ(4, stats.quality_level);
+  EXPECT_EQ(4, stats.num_step_downs);
+  EXPECT_EQ(6, stats.num_blocks_over_budget);
+  EXPECT_GT(stats.last_render_seconds, 0.0);
+  // Sources 2 and 3 are the distant half.
+  scene.ProcessBlock(inputs, &output[0]);
+  EXPECT_EQ(Audio3DSource::kTruncatedHRTF,
+            scene.GetSource(0)->GetGovernorQualityTierLimit());
+  EXPECT_EQ(Audio3DSource::kTruncatedHRTF,
+            scene.GetSource(1)->GetGovernorQualityTierLimit());
+  EXPECT_EQ(Audio3DSource::kParametric,
+            scene.GetSource(2)->GetGovernorQualityTierLimit());
+  EXPECT_EQ(Audio3DSource::kParametric,
+            scene.GetSource(3)->GetGovernorQualityTierLimit());
+  EXPECT_EQ(Audio3DSource::kFullHRTF, scene.GetSource(3)->GetQualityTier());
+
+  scene.SetCPUBudget(1e6f);
+  for (int block = 0; block < 100; ++block) {
+    scene.ProcessBlock(inputs, &output[0]);
+  }
+  EXPECT_EQ(0, stats.quality_level);
+  EXPECT_EQ(4, stats.num_step_ups);
+  scene.ProcessBlock(inputs, &output[0]);
+  for (int i = 0; i < kNumSources; ++i) {
+    EXPECT_EQ(Audio3DSource::kFullHRTF,
+              scene.GetSource(i)->GetGovernorQualityTierLimit());
+  }
+}
+
+// The governor degrades the sources without overwriting their own
+// settings, which apply again once the governor stepped back up.
+TEST(Audio3DSceneTest, CPUBudgetGovernorKeepsSourceSettings) {
+  const int kNumSources = 4;
+  Audio3DScene scene(kSampleRate, kBlockSize);
+  for (int i = 0; i < kNumSources; ++i) {
+    scene.AddSource();
+    scene.GetSource(i)->SetDirection(0.0f, 30.0f * i, 1.0f + 10.0f * i);
+  }
+  Audio3DSource* source = scene.GetSource(3);
+  source->SetHRTFSwitchHysteresis(10.0f);
+  source->SetReverbSendMuted(true);
+  source->LimitQualityTier(Audio3DSource::kTruncatedHRTF);
+  scene.GetSource(0)->SetHRTFSwitchHysteresis(2.0f);
+
+  vector<vector<float> > inputs(kNumSources,
+                                vector<float>(kBlockSize, 0.1f));
+  vector<float> output(2 * kBlockSize);
+  scene.SetCPUBudget(1e-9f);
+  for (int block = 0; block < 6; ++block) {
+    scene.ProcessBlock(inputs, &output[0]);
+  }
+  EXPECT_EQ(4, scene.GetGovernorStats().quality_level);
+  EXPECT_EQ(Audio3DSource::kParametric,
+            source->GetGovernorQualityTierLimit());
+
+  scene.SetCPUBudget(1e6f);
+  for (int block = 0; block < 100; ++block) {
+    scene.ProcessBlock(inputs, &output[0]);
+  }
+  EXPECT_EQ(0, scene.GetGovernorStats().quality_level);
+  EXPECT_EQ(Audio3DSource::kFullHRTF, source->GetGovernorQualityTierLimit());
+  EXPECT_EQ(10.0f, source->GetHRTFSwitchHysteresis());
+  EXPECT_TRUE(source->IsReverbSendMuted());
+  EXPECT_EQ(Audio3DSource::kTruncatedHRTF, source->GetQualityTierLimit());
+  EXPECT_EQ(2.0f, scene.GetSource(0)->GetHRTFSwitchHysteresis());
+  EXPECT_FALSE(scene.GetSource(0)->IsReverbSendMuted());
+  EXPECT_EQ(Audio3DSource::kFullHRTF,
+            scene.GetSource(0)->GetQualityTierLimit());
+}
+
+// Turns all sources at once with two switches per block. The loudest source
+// switches first, the rest follow over the next blocks, after which the
+// output matches a scene switching all sources immediately.
+TEST(Audio3DSceneTest, HRTFSwitchesAreStaggered) {
+  const int kNumSources = 6;
+  Audio3DScene scene(kSampleRate, kBlockSize);
+  Audio3DScene reference_scene(kSampleRate, kBlockSize);
+  for (int i = 0; i < kNumSources; ++i) {
+    scene.AddSource();
+    reference_scene.AddSource();
+    scene.GetSource(i)->SetDirection(0.0f, 20.0f * i, 2.0f);
+    reference_scene.GetSource(i)->SetDirection(0.0f, 20.0f * i, 2.0f);
+  }
+  scene.SetMaxHRTFSwitchesPerBlock(2);
+  EXPECT_EQ(2, scene.GetMaxHRTFSwitchesPerBlock());
+
+  vector<vector<float> > inputs(kNumSources, vector<float>(kBlockSize));
+  vector<float> output(2 * kBlockSize);
+  vector<float> reference_output(2 * kBlockSize);
+  for (int block = 0; block < 10; ++block) {
+    if (block == 4) {
+      for (int i = 0; i < kNumSources; ++i) {
+        scene.GetSource(i)->SetDirection(0.0f, 20.0f * i + 45.0f, 2.0f);
+        reference_scene.GetSource(i)->SetDirection(0.0f, 20.0f * i + 45.0f,
+                                                   2.0f);
+      }
+    }
+    for (int i = 0; i < kNumSources; ++i) {
+      float level = (i == 4) ? 1.0f : 0.1f;
+      for (int j = 0; j < kBlockSize; ++j) {
+        inputs[i][j] = level * sin(0.02f * (i + 1) * (block * kBlockSize
+            + j));
+      }
+    }
+    scene.ProcessBlock(inputs, &output[0]);
+    reference_scene.ProcessBlock(inputs, &reference_output[0]);
+    EXPECT_EQ(0, reference_scene.GetNumDeferredHRTFSwitches());
+
+    if (block < 3) {
+      // Initial directions, also staggered.
+      continue;
+    }
+    if (block == 4) {
+      EXPECT_EQ(kNumSources - 2, scene.GetNumDeferredHRTFSwitches());
+      EXPECT_FALSE(scene.GetSource(4)->IsHRTFSwitchPending());
+      EXPECT_EQ(0.0f, scene.GetSource(4)->GetHRTFDirectionError());
+    } else if (block == 5) {
+      EXPECT_EQ(kNumSources - 4, scene.GetNumDeferredHRTFSwitches());
+    } else {
+      EXPECT_EQ(0, scene.GetNumDeferredHRTFSwitches());
+    }
+    if (block >= 8) {
+      for (int i = 0; i < 2 * kBlockSize; ++i) {
+        ASSERT_NEAR(reference_output[i], output[i], 1e-5f);
+      }
+    }
+  }
+  for (int i = 0; i < kNumSources; ++i) {
+    EXPECT_FALSE(scene.GetSource(i)->IsHRTFSwitchPending());
+  }
+}
+
+// The FDN reverb keeps ringing long after the direct sound and the short
+// convolution reverb have died away.
+TEST(Audio3DSceneTest, FDNReverbRendersLongTail) {
+  float tail_energy[2];
+  for (int mode = 0; mode < 2; ++mode) {
+    Audio3DScene scene(kSampleRate, kBlockSize);
+    if (mode == 1) {
+      // The decay time is kept until the FDN reverb is allocated.
+      scene.SetFDNReverbTime(2.0f, 1.0f);
+      scene.SetReverbMode(Audio3DScene::kFDNReverb);
+    }
+    scene.AddSource();
+    scene.GetSource(0)->SetDirection(0.0f, 30.0f, 2.0f);
+
+    vector<vector<float> > inputs(1, vector<float>(kBlockSize));
+    vector<float> output(2 * kBlockSize);
+    tail_energy[mode] = 0.0f;
+    for (int block = 0; block < 40; ++block) {
+      for (int i = 0; i < kBlockSize; ++i) {
+        inputs[0][i] = block < 4 ? 0.5f * sin(0.05f * i) : 0.0f;
+      }
+      scene.ProcessBlock(inputs, &output[0]);
+      for (int i = 0; block >= 30 && i < output.size(); ++i) {
+        tail_energy[mode] += output[i] * output[i];
+      }
+    }
+    EXPECT_EQ(mode == 1 ? Audio3DScene::kFDNReverb
+              : Audio3DScene::kConvolutionReverb, scene.GetReverbMode());
+  }
+  EXPECT_GT(tail_energy[1], 1e-4f);
+  EXPECT_GT(tail_energy[1], 100.0f * tail_energy[0]);
+}
@@ -0,0 +1,154 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "ambisonic_binaural_renderer.h"
+#include "basis_binaural_renderer.h"
+#include "gtest/gtest.h"
+#include "hrtf.h"
+#include "hrtf_basis.h"
+#include "vbap_binaural_renderer.h"
+
+using namespace std;
+
+static const int kBlockSize = 256;
+
+static void GetNoiseBlock(vector<float>* block) {
+  block->resize(kBlockSize);
+  for (int i = 0; i < kBlockSize; ++i) {
+    (*block)[i] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+  }
+}
+
+static float Energy(const vector<float>& signal) {
+  float energy = 0.0f;
+  for (int i = 0; i < signal.size(); ++i) {
+    energy += signal[i] * signal[i];
+  }
+  return energy;
+}
+
+// Renders noise from the left and from the right and checks that the near
+// ear is louder.
+static void ExpectLateralization(BinauralBusRenderer* renderer) {
+  int left_source = renderer->AddSource();
+  int right_source = renderer->AddSource();
+  renderer->SetSourceDirection(left_source, 0.0f, -90.0f, 1.0f);
+  renderer->SetSourceDirection(right_source, 0.0f, 90.0f, 1.0f);
+
+  vector<float> input;
+  vector<float> silence(kBlockSize, 0.0f);
+  vector<float> left;
+  vector<float> right;
+  float energy[2][2] = { { 0.0f, 0.0f }, { 0.0f, 0.0f } };
+  for (int source = 0; source < 2; ++source) {
+    for (int block = 0; block < 8; ++block) {
+      GetNoiseBlock(&input);
+      renderer->AddSourceBlock(left_source, source == 0 ? input : silence);
+      renderer->AddSourceBlock(right_source, source == 1 ? input : silence);
+      renderer->ProcessBlock(&left, &right);
+      ASSERT_EQ(kBlockSize, left.size());
+      ASSERT_EQ(kBlockSize, right.size());
+      energy[source][0] += Energy(left);
+      energy[source][1] += Energy(right);
+    }
+  }
+  EXPECT_GT(energy[0][0], 2.0f * energy[0][1]);
+  EXPECT_GT(energy[1][1], 2.0f * energy[1][0]);
+}
+
+TEST(BinauralBusRendererTest, BasisLateralization) {
+  HRTF hrtf(44100, kBlockSize);
+  HRTFBasis basis(hrtf, 16);
+  BasisBinauralRenderer renderer(hrtf, basis, kBlockSize);
+  ExpectLateralization(&renderer);
+}
+
+TEST(BinauralBusRendererTest, AmbisonicLateralization) {
+  HRTF hrtf(44100, kBlockSize);
+  for (int order = 1; order <= 3; ++order) {
+    AmbisonicBinauralRenderer renderer(hrtf, order, kBlockSize);
+    EXPECT_EQ((order + 1) * (order + 1), renderer.GetNumChannels());
+    ExpectLateralization(&renderer);
+  }
+}
+
+// Turning the head towards a source must sound like the source in front.
+TEST(BinauralBusRendererTest, AmbisonicHeadRotation) {
+  HRTF hrtf(44100, kBlockSize);
+  AmbisonicBinauralRenderer rotated(hrtf, 3, kBlockSize);
+  AmbisonicBinauralRenderer reference(hrtf, 3, kBlockSize);
+  int rotated_source = rotated.AddSource();
+  int reference_source = reference.AddSource();
+  rotated.SetSourceDirection(rotated_source, 20.0f, 50.0f, 1.0f);
+  rotated.SetHeadRotation(50.0f, 20.0f, 0.0f);
+  reference.SetSourceDirection(reference_source, 0.0f, 0.0f, 1.0f);
+
+  vector<float> input;
+  vector<float> rotated_left, rotated_right;
+  vector<float> reference_left, reference_right;
+  for (int block = 0; block < 8; ++block) {
+    GetNoiseBlock(&input);
+    rotated.AddSourceBlock(rotated_source, input);
+    reference.AddSourceBlock(reference_source, input);
+    rotated.ProcessBlock(&rotated_left, &rotated_right);
+    reference.ProcessBlock(&reference_left, &reference_right);
+    if (block < 2) {
+      continue;  // Rotation crossfade and filter tails.
+    }
+    for (int i = 0; i < kBlockSize; ++i) {
+      EXPECT_NEAR(reference_left[i], rotated_left[i], 1e-3f);
+      EXPECT_NEAR(reference_right[i], rotated_right[i], 1e-3f);
+    }
+  }
+}
+
+TEST(BinauralBusRendererTest, VBAPLateralization) {
+  HRTF hrtf(44100, kBlockSize);
+  VBAPBinauralRenderer ring(hrtf, VBAPBinauralRenderer::kRing, kBlockSize);
+  ExpectLateralization(&ring);
+  VBAPBinauralRenderer dome(hrtf, VBAPBinauralRenderer::kDome, kBlockSize);
+  ExpectLateralization(&dome);
+}
+
+TEST(BinauralBusRendererTest, VBAPGains) {
+  HRTF hrtf(44100, kBlockSize);
+  VBAPBinauralRenderer dome(hrtf, VBAPBinauralRenderer::kDome, kBlockSize);
+  ASSERT_EQ(21, dome.GetNumSpeakers());
+
+  vector<float> gains;
+  // Directly on the front loudspeaker of the horizontal ring.
+  dome.GetSpeakerGains(0.0f, 0.0f, &gains);
+  EXPECT_NEAR(1.0f, gains[6], 1e-4f);
+
+  // At the nadir the imaginary loudspeaker is spread over the lowest ring.
+  dome.GetSpeakerGains(-90.0f, 0.0f, &gains);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_NEAR(1.0f / sqrt(6.0f), gains[i], 1e-4f);
+  }
+
+  for (float elevation = -90.0f; elevation <= 90.0f; elevation += 15.0f) {
+    for (float azimuth = -180.0f; azimuth < 180.0f; azimuth += 25.0f) {
+      dome.GetSpeakerGains(elevation, azimuth, &gains);
+      float power = 0.0f;
+      int num_active = 0;
+      for (int i = 0; i < gains.size(); ++i) {
+        EXPECT_GE(gains[i], 0.0f);
+        power += gains[i] * gains[i];
+        num_active += gains[i] > 0.0f;
+      }
+      EXPECT_NEAR(1.0f, power, 1e-4f);
+      EXPECT_LE(num_active, elevation < -40.0f ? 6 : 3);
+    }
+  }
+
+  VBAPBinauralRenderer ring(hrtf, VBAPBinauralRenderer::kRing, kBlockSize);
+  for (float elevation = -90.0f; elevation <= 90.0f; elevation += 180.0f) {
+    for (float azimuth = -180.0f; azimuth < 180.0f; azimuth += 25.0f) {
+      ring.GetSpeakerGains(elevation, azimuth, &gains);
+      for (int i = 0; i < gains.size(); ++i) {
+        EXPECT_NEAR(1.0f / sqrt(8.0f), gains[i], 1e-4f);
+      }
+    }
+  }
+}
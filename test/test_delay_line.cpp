@@ -0,0 +1,69 @@
+#include <cmath>
+#include <vector>
+
+#include "delay_line.h"
+#include "gtest/gtest.h"
+
+using namespace std;
+
+static const int kBlockSize = 64;
+
+TEST(FractionalDelayLineTest, IntegerDelayIsExact) {
+  FractionalDelayLine delay_line(1000, kBlockSize);
+  vector<float> input(10 * kBlockSize);
+  for (int i = 0; i < input.size(); ++i) {
+    input[i] = sin(0.3f * i) + 0.1f * (i % 7);
+  }
+  vector<float> output(input.size());
+  for (int block = 0; block < 10; ++block) {
+    delay_line.Process(&input[block * kBlockSize], 123.0f,
+                       &output[block * kBlockSize]);
+  }
+  for (int i = 123; i < input.size(); ++i) {
+    EXPECT_NEAR(input[i - 123], output[i], 1e-6f);
+  }
+}
+
+// A sine read through a ramped fractional delay must match the analytically
+// delayed sine, which includes its Doppler shift.
+TEST(FractionalDelayLineTest, RampedDelayMatchesDelayedSine) {
+  const int kNumBlocks = 40;
+  const float kOmega = 0.05f;
+  FractionalDelayLine delay_line(400, kBlockSize);
+  vector<float> input(kBlockSize);
+  vector<float> output(kBlockSize);
+  float previous_delay = 0.0f;
+  for (int block = 0; block < kNumBlocks; ++block) {
+    float delay = 200.0f + 150.0f * sin(0.2f * block) + 0.37f;
+    for (int i = 0; i < kBlockSize; ++i) {
+      input[i] = sin(kOmega * (block * kBlockSize + i));
+    }
+    delay_line.Process(&input[0], delay, &output[0]);
+    if (block > 4) {
+      for (int i = 0; i < kBlockSize; ++i) {
+        float tap_delay = previous_delay
+            + (delay - previous_delay) * (i + 1) / kBlockSize;
+        EXPECT_NEAR(sin(kOmega * (block * kBlockSize + i - tap_delay)),
+                    output[i], 1e-4f);
+      }
+    }
+    previous_delay = delay;
+  }
+}
+
+TEST(FractionalDelayLineTest, MaxDelayClampsWithinCapacity) {
+  FractionalDelayLine delay_line(500, kBlockSize);
+  delay_line.SetMaxDelay(10);
+  EXPECT_EQ(10, delay_line.GetMaxDelay());
+  EXPECT_EQ(500, delay_line.GetMaxDelayCapacity());
+
+  vector<float> input(kBlockSize);
+  vector<float> output(kBlockSize);
+  for (int i = 0; i < kBlockSize; ++i) {
+    input[i] = i;
+  }
+  delay_line.Process(&input[0], 300.0f, &output[0]);
+  for (int i = 10; i < kBlockSize; ++i) {
+    EXPECT_NEAR(input[i - 10], output[i], 1e-4f);
+  }
+}
@@ -0,0 +1,111 @@
+#include <cmath>
+#include <vector>
+
+#include "fdn_reverb.h"
+#include "gtest/gtest.h"
+
+using namespace std;
+
+static const int kSampleRate = 48000;
+static const int kBlockSize = 256;
+
+// Renders the impulse response of |reverb| for |seconds|.
+static void RenderImpulseResponse(FDNReverb* reverb, float seconds,
+                                  vector<float>* left, vector<float>* right) {
+  vector<float> input(kBlockSize, 0.0f);
+  input[0] = 1.0f;
+  int num_blocks = seconds * kSampleRate / kBlockSize;
+  left->clear();
+  right->clear();
+  for (int block = 0; block < num_blocks; ++block) {
+    const float* block_left;
+    const float* block_right;
+    reverb->ProcessReberation(input, &block_left, &block_right);
+    left->insert(left->end(), block_left, block_left + kBlockSize);
+    right->insert(right->end(), block_right, block_right + kBlockSize);
+    input[0] = 0.0f;
+  }
+}
+
+// Energy in dB of |signal| between |begin| and |end| seconds. |order| 0
+// measures the signal, 1 its first difference to emphasize high
+// frequencies and -1 the sum of neighbouring samples for low frequencies.
+static float EnergyDB(const vector<float>& signal, float begin, float end,
+                      int order) {
+  double energy = 1e-30;
+  for (int i = begin * kSampleRate; i < end * kSampleRate; ++i) {
+    double value = signal[i];
+    if (order != 0) {
+      value = signal[i] - order * signal[i - 1];
+    }
+    energy += value * value;
+  }
+  return 10.0 * log10(energy);
+}
+
+TEST(FDNReverbTest, DecayMatchesReberationTime) {
+  for (int num_lines = 8; num_lines <= 16; num_lines *= 2) {
+    FDNReverb reverb(kBlockSize, kSampleRate, 1.0f, num_lines);
+    EXPECT_EQ(num_lines, reverb.GetNumLines());
+    ASSERT_EQ(num_lines, reverb.GetDelays().size());
+    for (int i = 1; i < num_lines; ++i) {
+      EXPECT_GT(reverb.GetDelays()[i], reverb.GetDelays()[i - 1]);
+    }
+
+    vector<float> left, right;
+    RenderImpulseResponse(&reverb, 1.0f, &left, &right);
+    // 60 dB per second.
+    EXPECT_NEAR(-30.0f, EnergyDB(left, 0.7f, 0.8f, 0)
+                - EnergyDB(left, 0.2f, 0.3f, 0), 2.0f);
+    EXPECT_NEAR(-30.0f, EnergyDB(right, 0.7f, 0.8f, 0)
+                - EnergyDB(right, 0.2f, 0.3f, 0), 2.0f);
+
+    // The ears receive different sign patterns of the lines.
+    double cross = 0.0, left_energy = 0.0, right_energy = 0.0;
+    for (int i = 0.1f * kSampleRate; i < left.size(); ++i) {
+      cross += left[i] * right[i];
+      left_energy += left[i] * left[i];
+      right_energy += right[i] * right[i];
+    }
+    EXPECT_LT(fabs(cross) / sqrt(left_energy * right_energy), 0.2);
+  }
+}
+
+TEST(FDNReverbTest, HighFrequenciesDecayFaster) {
+  FDNReverb reverb(kBlockSize, kSampleRate, 2.0f, 8);
+  reverb.SetReberationTime(2.0f, 0.25f);
+  vector<float> left, right;
+  RenderImpulseResponse(&reverb, 0.6f, &left, &right);
+  float low_decay = EnergyDB(left, 0.5f, 0.6f, -1)
+      - EnergyDB(left, 0.1f, 0.2f, -1);
+  float high_decay = EnergyDB(left, 0.5f, 0.6f, 1)
+      - EnergyDB(left, 0.1f, 0.2f, 1);
+  // 60 dB per 2 seconds at DC, 60 dB per 0.25 seconds at Nyquist. The
+  // difference filters only roughly separate the bands.
+  EXPECT_LT(low_decay, -10.0f);
+  EXPECT_GT(low_decay, -20.0f);
+  EXPECT_LT(high_decay, low_decay - 6.0f);
+}
+
+TEST(FDNReverbTest, ShortBlocks) {
+  // Blocks of varying size render the same response as full blocks.
+  FDNReverb full(kBlockSize, kSampleRate, 0.5f, 16);
+  FDNReverb split(kBlockSize, kSampleRate, 0.5f, 16);
+  vector<float> full_left, full_right;
+  RenderImpulseResponse(&full, 0.1f, &full_left, &full_right);
+
+  vector<float> split_left;
+  vector<float> input;
+  for (int size = 1; split_left.size() < full_left.size(); size = size % 64
+       + 7) {
+    input.assign(min<int>(size, full_left.size() - split_left.size()), 0.0f);
+    if (split_left.empty()) {
+      input[0] = 1.0f;
+    }
+    const float* left;
+    const float* right;
+    split.ProcessReberation(input, &left, &right);
+    split_left.insert(split_left.end(), left, left + input.size());
+  }
+  EXPECT_EQ(full_left, split_left);
+}
@@ -4,6 +4,7 @@
 
 #include "gtest/gtest.h"
 #include "fft_filter.h"
+#include "half_float.h"
 
 using namespace std;
 
@@ -74,3 +75,65 @@ TEST(FFTFilterTest, TransformTest) {
   }
 }
 
+
+TEST(FFTFilterTest, HalfFloatConversion) {
+  EXPECT_EQ(0x0000, ConvertFloatToHalf(0.0f));
+  EXPECT_EQ(0x3c00, ConvertFloatToHalf(1.0f));
+  EXPECT_EQ(0xc000, ConvertFloatToHalf(-2.0f));
+  EXPECT_EQ(0x7bff, ConvertFloatToHalf(65504.0f));
+  EXPECT_EQ(0x7c00, ConvertFloatToHalf(1e6f));
+  EXPECT_EQ(0x0001, ConvertFloatToHalf(5.9604645e-8f));
+  // Ties round to even.
+  EXPECT_EQ(0x3c00, ConvertFloatToHalf(1.0f + 1.0f / 2048.0f));
+  EXPECT_EQ(0x3c02, ConvertFloatToHalf(1.0f + 3.0f / 2048.0f));
+
+  // Every finite half survives the round trip, in the scalar and the
+  // vectorized conversion.
+  vector<uint16_t> halves;
+  for (int i = 0; i < 65536; ++i) {
+    if ((i & 0x7c00) != 0x7c00) {
+      halves.push_back(i);
+    }
+  }
+  vector<float> floats;
+  ConvertHalfToFloat(halves, &floats);
+  vector<uint16_t> round_trip;
+  ConvertFloatToHalf(floats, &round_trip);
+  for (int i = 0; i < halves.size(); ++i) {
+    EXPECT_EQ(ConvertHalfToFloat(halves[i]), floats[i]);
+    EXPECT_EQ(halves[i], round_trip[i]);
+  }
+}
+
+TEST(FFTFilterTest, HalfFloatKernel) {
+  int filter_size = 64;
+  FFTFilter float_filter(filter_size);
+  FFTFilter half_filter(filter_size);
+
+  vector<float> kernel(filter_size);
+  for (int i = 0; i < filter_size; ++i) {
+    kernel[i] = exp(-0.1f * i) * cos(0.7f * i);
+  }
+  vector<float> freq_kernel;
+  float_filter.ForwardTransform(kernel, &freq_kernel);
+  vector<uint16_t> half_kernel;
+  ConvertFloatToHalf(freq_kernel, &half_kernel);
+  float_filter.SetFreqDomainKernel(freq_kernel);
+  half_filter.SetFreqDomainKernel(half_kernel);
+
+  vector<float> signal_block(filter_size);
+  vector<float> float_result;
+  vector<float> half_result;
+  for (int block = 0; block < 4; ++block) {
+    for (int i = 0; i < filter_size; ++i) {
+      signal_block[i] = sin(0.05f * (block * filter_size + i));
+    }
+    float_filter.AddSignalBlock(signal_block);
+    float_filter.GetResult(&float_result);
+    half_filter.AddSignalBlock(signal_block);
+    half_filter.GetResult(&half_result);
+    for (int i = 0; i < filter_size; ++i) {
+      EXPECT_NEAR(float_result[i], half_result[i], 1e-2f);
+    }
+  }
+}
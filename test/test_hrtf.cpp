@@ -0,0 +1,169 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "fft_filter.h"
+#include "half_float.h"
+#include "hrtf.h"
+#include "hrtf_basis.h"
+
+using namespace std;
+
+static float Energy(const vector<float>& signal) {
+  float energy = 0.0f;
+  for (int i = 0; i < signal.size(); ++i) {
+    energy += signal[i] * signal[i];
+  }
+  return energy;
+}
+
+// Mean absolute log-spectral distance in dB, ignoring bins more than 40dB
+// below the peak of |reference|.
+static float LogSpectralDistance(const vector<float>& reference,
+                                 const vector<float>& signal) {
+  FFTFilter fft_filter(256);
+  vector<float> reference_spectrum;
+  vector<float> signal_spectrum;
+  fft_filter.ForwardTransform(reference, &reference_spectrum);
+  fft_filter.ForwardTransform(signal, &signal_spectrum);
+
+  vector<float> reference_magnitude;
+  vector<float> signal_magnitude;
+  float max_magnitude = 0.0f;
+  for (int i = 0; i < reference_spectrum.size(); i += 2) {
+    reference_magnitude.push_back(hypot(reference_spectrum[i],
+                                        reference_spectrum[i + 1]));
+    signal_magnitude.push_back(hypot(signal_spectrum[i],
+                                     signal_spectrum[i + 1]));
+    max_magnitude = fmax(max_magnitude, reference_magnitude.back());
+  }
+  float distance = 0.0f;
+  int num_bins = 0;
+  for (int i = 0; i < reference_magnitude.size(); ++i) {
+    if (reference_magnitude[i] > max_magnitude * 0.01f) {
+      distance += fabs(20.0f * log10(signal_magnitude[i]
+          / reference_magnitude[i]));
+      ++num_bins;
+    }
+  }
+  return distance / num_bins;
+}
+
+TEST(HRTFTest, MinimumPhaseDecomposition) {
+  HRTF hrtf(48000, 256);
+  EXPECT_LT(hrtf.GetMinimumPhaseFilterSize(), hrtf.GetFilterSize());
+
+  for (int azimuth = -180; azimuth <= 180; azimuth += 30) {
+    hrtf.SetDirection(0.0f, azimuth);
+    const vector<float>* full[2] = { &hrtf.GetLeftEarTimeHRTF(),
+        &hrtf.GetRightEarTimeHRTF() };
+    const vector<float>* min_phase[2] = { &hrtf.GetLeftEarMinimumPhaseHRTF(),
+        &hrtf.GetRightEarMinimumPhaseHRTF() };
+    float delay[2] = { hrtf.GetLeftEarDelay(), hrtf.GetRightEarDelay() };
+
+    for (int ear = 0; ear < 2; ++ear) {
+      ASSERT_EQ(hrtf.GetMinimumPhaseFilterSize(), min_phase[ear]->size());
+      EXPECT_GE(delay[ear], 0.0f);
+      EXPECT_LT(delay[ear], hrtf.GetFilterSize());
+
+      // Truncation keeps most of the energy.
+      EXPECT_NEAR(Energy(*min_phase[ear]) / Energy(*full[ear]), 1.0f, 0.1f);
+
+      EXPECT_LT(LogSpectralDistance(*full[ear], *min_phase[ear]), 1.0f);
+    }
+
+    // The ear facing away from the source receives the sound later.
+    if (azimuth > 0 && azimuth < 180) {
+      EXPECT_GT(delay[0], delay[1]);
+    } else if (azimuth < 0 && azimuth > -180) {
+      EXPECT_LT(delay[0], delay[1]);
+    }
+  }
+}
+
+TEST(HRTFTest, PrincipalComponentBasis) {
+  HRTF hrtf(48000, 256);
+  int filter_size = hrtf.GetMinimumPhaseFilterSize();
+  HRTFBasis basis(hrtf, 16);
+  ASSERT_EQ(16, basis.GetNumBasisFilters());
+  ASSERT_EQ(filter_size, basis.GetFilterSize());
+
+  // The error decreases with the basis size and vanishes at full rank.
+  for (int k = 1; k <= filter_size; ++k) {
+    EXPECT_LE(basis.GetApproximationError(k),
+              basis.GetApproximationError(k - 1) + 1e-6f);
+  }
+  EXPECT_NEAR(0.0f, basis.GetApproximationError(filter_size), 1e-4f);
+  EXPECT_LT(basis.GetApproximationError(16), 0.1f);
+
+  // Reconstruct a few directions from their weights.
+  for (int azimuth = -150; azimuth <= 150; azimuth += 60) {
+    bool left_right_swap;
+    int hrtf_index = hrtf.FindHRTF(0.0f, azimuth, &left_right_swap);
+    const vector<float>& reference = hrtf.GetLeftEarMinimumPhaseHRTF(
+        hrtf_index, left_right_swap);
+    const vector<float>& weights = basis.GetLeftEarWeights(hrtf_index,
+                                                           left_right_swap);
+    vector<float> reconstruction = basis.GetMeanFilter();
+    for (int k = 0; k < basis.GetNumBasisFilters(); ++k) {
+      for (int j = 0; j < filter_size; ++j) {
+        reconstruction[j] += weights[k] * basis.GetBasisFilter(k)[j];
+      }
+    }
+    vector<float> residual(filter_size);
+    for (int j = 0; j < filter_size; ++j) {
+      residual[j] = reference[j] - reconstruction[j];
+    }
+    EXPECT_LT(Energy(residual), 0.1f * Energy(reference));
+  }
+}
+
+// Measures the error of filtering with the half precision frequency-domain
+// bank instead of the float bank.
+TEST(HRTFTest, HalfFloatBankError) {
+  const int kBlockSize = 256;
+  HRTF float_hrtf(48000, kBlockSize);
+  HRTF half_hrtf(48000, kBlockSize);
+  half_hrtf.ConvertFreqDomainBankToHalfFloat();
+  ASSERT_TRUE(half_hrtf.IsFreqDomainBankHalfFloat());
+
+  vector<vector<float> > noise(4, vector<float>(kBlockSize));
+  for (int block = 0; block < noise.size(); ++block) {
+    for (int i = 0; i < kBlockSize; ++i) {
+      noise[block][i] = static_cast<float>(rand()) / RAND_MAX - 0.5f;
+    }
+  }
+
+  FFTFilter float_filter(kBlockSize);
+  FFTFilter half_filter(kBlockSize);
+  vector<float> float_result;
+  vector<float> half_result;
+  float max_error_db = -200.0f;
+  for (int i = 0; i < float_hrtf.GetNumHRTFs(); ++i) {
+    EXPECT_EQ(float_hrtf.GetLeftEarFreqHRTF(i, false).size(),
+              half_hrtf.GetLeftEarHalfFloatFreqHRTF(i, false).size());
+    float_filter.SetFreqDomainKernel(float_hrtf.GetLeftEarFreqHRTF(i, false));
+    half_filter.SetFreqDomainKernel(
+        half_hrtf.GetLeftEarHalfFloatFreqHRTF(i, false));
+    float signal_energy = 0.0f;
+    float error_energy = 0.0f;
+    for (int block = 0; block < noise.size(); ++block) {
+      float_filter.AddSignalBlock(noise[block]);
+      float_filter.GetResult(&float_result);
+      half_filter.AddSignalBlock(noise[block]);
+      half_filter.GetResult(&half_result);
+      for (int j = 0; j < kBlockSize; ++j) {
+        float error = half_result[j] - float_result[j];
+        signal_energy += float_result[j] * float_result[j];
+        error_energy += error * error;
+      }
+    }
+    max_error_db = fmax(max_error_db,
+                        10.0f * log10(error_energy / signal_energy));
+  }
+  cout << "Worst half precision bank error: " << max_error_db << " dB"
+      << endl;
+  EXPECT_LT(max_error_db, -60.0f);
+}
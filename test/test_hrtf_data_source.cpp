@@ -0,0 +1,106 @@
+#include <cstdio>
+#include <unistd.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "hrtf.h"
+#include "hrtf_data_source.h"
+
+using namespace std;
+
+static void ExpectEqualDataSources(const HRTFDataSource& a,
+                                   const HRTFDataSource& b) {
+  ASSERT_EQ(a.GetNumHRTFs(), b.GetNumHRTFs());
+  ASSERT_EQ(a.GetFIRLength(), b.GetFIRLength());
+  EXPECT_EQ(a.GetSampleRate(), b.GetSampleRate());
+  EXPECT_FLOAT_EQ(a.GetDistance(), b.GetDistance());
+
+  vector<float> a_left, a_right, b_left, b_right;
+  for (int i = 0; i < a.GetNumHRTFs(); ++i) {
+    int a_elevation, a_azimuth, b_elevation, b_azimuth;
+    a.GetDirection(i, &a_elevation, &a_azimuth);
+    b.GetDirection(i, &b_elevation, &b_azimuth);
+    EXPECT_EQ(a_elevation, b_elevation);
+    EXPECT_EQ(a_azimuth, b_azimuth);
+
+    ASSERT_TRUE(a.ReadHRTF(i, &a_left, &a_right));
+    ASSERT_TRUE(b.ReadHRTF(i, &b_left, &b_right));
+    EXPECT_EQ(a_left, b_left);
+    EXPECT_EQ(a_right, b_right);
+  }
+}
+
+TEST(HRTFDataSourceTest, WavMatchesCompiledDataset) {
+  HRTFDataSource* compiled = HRTFDataSource::CreateDefault();
+  if (!compiled) {
+    return;  // Built without compiled-in dataset.
+  }
+
+  WavHRTFDataSource wav;
+  ASSERT_TRUE(wav.Open(HRTF_DATA_DIR, compiled->GetDistance()));
+  ExpectEqualDataSources(*compiled, wav);
+  delete compiled;
+}
+
+TEST(HRTFDataSourceTest, BinaryRoundTrip) {
+  WavHRTFDataSource wav;
+  ASSERT_TRUE(wav.Open(HRTF_DATA_DIR, 1.4f));
+  EXPECT_EQ(wav.GetSampleRate(), 44100);
+
+  string file_name = "test_hrtf_data_source.bin";
+  ASSERT_TRUE(BinaryHRTFDataSource::Write(wav, file_name));
+
+  BinaryHRTFDataSource binary;
+  ASSERT_TRUE(binary.Open(file_name));
+  EXPECT_EQ(wav.GetIdentifier(), binary.GetIdentifier());
+  ExpectEqualDataSources(wav, binary);
+
+  HRTF hrtf(binary, 48000, 256);
+  EXPECT_TRUE(hrtf.IsValid());
+  EXPECT_TRUE(hrtf.SetDirection(30.0f, -90.0f));
+  EXPECT_EQ(hrtf.GetFilterSize(), hrtf.GetLeftEarTimeHRTF().size());
+  remove(file_name.c_str());
+}
+
+TEST(HRTFDataSourceTest, MissingDirectoryFails) {
+  WavHRTFDataSource wav;
+  EXPECT_FALSE(wav.Open("does_not_exist", 1.4f));
+  BinaryHRTFDataSource binary;
+  EXPECT_FALSE(binary.Open("does_not_exist.bin"));
+}
+
+TEST(HRTFDataSourceTest, TruncatedBinaryFileInvalidatesHRTF) {
+  WavHRTFDataSource wav;
+  ASSERT_TRUE(wav.Open(HRTF_DATA_DIR, 1.4f));
+  string file_name = "test_hrtf_data_source_truncated.bin";
+  ASSERT_TRUE(BinaryHRTFDataSource::Write(wav, file_name));
+  FILE* file = fopen(file_name.c_str(), "rb");
+  ASSERT_TRUE(file != 0);
+  fseek(file, 0, SEEK_END);
+  long file_size = ftell(file);
+  fclose(file);
+  ASSERT_EQ(0, truncate(file_name.c_str(), file_size - 100));
+
+  // The header is intact, only the last HRTF fails to load. The bank is
+  // still built and reports the failure instead of terminating.
+  BinaryHRTFDataSource binary;
+  ASSERT_TRUE(binary.Open(file_name));
+  HRTF hrtf(binary, 48000, 256);
+  EXPECT_FALSE(hrtf.IsValid());
+  EXPECT_TRUE(hrtf.SetDirection(30.0f, -90.0f));
+  remove(file_name.c_str());
+}
+
+TEST(HRTFDataSourceTest, OversizedIdentifierFails) {
+  string file_name = "test_hrtf_data_source_identifier.bin";
+  FILE* file = fopen(file_name.c_str(), "wb");
+  ASSERT_TRUE(file != 0);
+  const unsigned char header[] = { 'H', 'R', 'T', 'F', 1, 0, 0, 0,
+                                   0xFF, 0xFF, 0xFF, 0x7F };
+  fwrite(header, 1, sizeof(header), file);
+  fclose(file);
+
+  BinaryHRTFDataSource binary;
+  EXPECT_FALSE(binary.Open(file_name));
+  remove(file_name.c_str());
+}
@@ -0,0 +1,77 @@
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "listener_geometry.h"
+
+using namespace std;
+
+static const float kRadToDeg = 180.0f / M_PI;
+
+TEST(ListenerGeometryTest, DefaultPoseAxes) {
+  const float x[] = { 0.0f, 2.0f, 0.0f, -1.0f, 0.0f, 0.0f };
+  const float y[] = { 1.0f, 0.0f, -3.0f, 0.0f, 0.0f, 0.0f };
+  const float z[] = { 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+  const float expected_elevation[] = { 0.0f, 0.0f, 0.0f, 0.0f, 90.0f, 0.0f };
+  const float expected_azimuth[] = { 0.0f, 90.0f, 180.0f, -90.0f, 0.0f, 0.0f };
+  const float expected_distance[] = { 1.0f, 2.0f, 3.0f, 1.0f, 1.0f, 0.0f };
+  float elevation[6], azimuth[6], distance[6];
+  TransformToSpherical(ListenerPose(), x, y, z, 6, elevation, azimuth,
+                       distance);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_NEAR(expected_elevation[i], elevation[i], 1e-3f);
+    EXPECT_NEAR(expected_azimuth[i], azimuth[i], 1e-3f);
+    EXPECT_NEAR(expected_distance[i], distance[i], 1e-6f);
+  }
+}
+
+// Compares the batch transform with scalar atan2() for random positions and
+// a random listener pose. The odd count exercises the scalar remainder.
+TEST(ListenerGeometryTest, MatchesScalarReference) {
+  const int kNumPositions = 1023;
+  srand(1);
+  vector<float> x(kNumPositions), y(kNumPositions), z(kNumPositions);
+  for (int i = 0; i < kNumPositions; ++i) {
+    x[i] = 20.0f * rand() / RAND_MAX - 10.0f;
+    y[i] = 20.0f * rand() / RAND_MAX - 10.0f;
+    z[i] = 20.0f * rand() / RAND_MAX - 10.0f;
+  }
+
+  // 30 degrees around (1, 2, 3).
+  ListenerPose listener;
+  listener.position[0] = 1.0f;
+  listener.position[1] = -2.0f;
+  listener.position[2] = 0.5f;
+  float half_angle = 15.0f / kRadToDeg;
+  float axis_norm = sqrt(14.0f);
+  listener.orientation[0] = cos(half_angle);
+  for (int i = 0; i < 3; ++i) {
+    listener.orientation[i + 1] = sin(half_angle) * (i + 1) / axis_norm;
+  }
+
+  vector<float> elevation(kNumPositions), azimuth(kNumPositions),
+      distance(kNumPositions);
+  TransformToSpherical(listener, &x[0], &y[0], &z[0], kNumPositions,
+                       &elevation[0], &azimuth[0], &distance[0]);
+
+  // Rotates by the conjugate orientation: v' = v + 2 * u x (u x v + w * v)
+  // with u = -(x, y, z).
+  float w = listener.orientation[0];
+  float u[3] = { -listener.orientation[1], -listener.orientation[2],
+                 -listener.orientation[3] };
+  for (int i = 0; i < kNumPositions; ++i) {
+    float v[3] = { x[i] - listener.position[0], y[i] - listener.position[1],
+                   z[i] - listener.position[2] };
+    float t[3] = { u[1] * v[2] - u[2] * v[1] + w * v[0],
+                   u[2] * v[0] - u[0] * v[2] + w * v[1],
+                   u[0] * v[1] - u[1] * v[0] + w * v[2] };
+    float lx = v[0] + 2.0f * (u[1] * t[2] - u[2] * t[1]);
+    float ly = v[1] + 2.0f * (u[2] * t[0] - u[0] * t[2]);
+    float lz = v[2] + 2.0f * (u[0] * t[1] - u[1] * t[0]);
+    float horizontal = sqrt(lx * lx + ly * ly);
+    EXPECT_NEAR(atan2(lz, horizontal) * kRadToDeg, elevation[i], 1e-3f);
+    EXPECT_NEAR(atan2(lx, ly) * kRadToDeg, azimuth[i], 1e-3f);
+    EXPECT_NEAR(sqrt(lx * lx + ly * ly + lz * lz), distance[i], 1e-4f);
+  }
+}
@@ -0,0 +1,124 @@
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include "audio_3d.h"
+#include "audio_3d_scene.h"
+#include "fft_filter.h"
+#include "gtest/gtest.h"
+#include "gtest/gtest-spi.h"
+#include "realtime_checker.h"
+#include "reberation.h"
+
+using namespace std;
+
+static const int kSampleRate = 44100;
+static const int kBlockSize = 256;
+
+static void FillBlock(int block, vector<float>* input) {
+  for (int i = 0; i < input->size(); ++i) {
+    (*input)[i] = sin(0.05f * (block * input->size() + i));
+  }
+}
+
+TEST(RealtimeCheckerTest, DetectsAllocationAndLock) {
+  EXPECT_NONFATAL_FAILURE({
+    ScopedRealtimeSection realtime_section;
+    int* volatile value = new int(1);
+    delete value;
+    EXPECT_GT(realtime_section.GetNumViolations(), 0);
+  }, "operator new on a realtime thread");
+
+  std::mutex mutex;
+  EXPECT_NONFATAL_FAILURE({
+    ScopedRealtimeSection realtime_section;
+    mutex.lock();
+    mutex.unlock();
+  }, "pthread_mutex_lock() on a realtime thread");
+}
+
+TEST(RealtimeSafetyTest, FFTFilterAndReberation) {
+  FFTFilter filter(kBlockSize);
+  Reberation reberation(4 * kBlockSize, kSampleRate, 0.1f);
+  vector<float> kernel(kBlockSize, 0.0f);
+  kernel[3] = 1.0f;
+  filter.SetTimeDomainKernel(kernel);
+
+  vector<float> input(kBlockSize);
+  vector<float> output(kBlockSize);
+  vector<float> spectrum;
+  vector<float> signal;
+  vector<float> left(kBlockSize, 0.0f);
+  vector<float> right(kBlockSize, 0.0f);
+  FillBlock(0, &input);
+  filter.ForwardTransform(input, &spectrum);
+  filter.InverseTransform(spectrum, &signal);
+
+  ScopedRealtimeSection realtime_section;
+  for (int block = 0; block < 8; ++block) {
+    FillBlock(block, &input);
+    filter.AddSignalBlock(input);
+    filter.GetResult(&output);
+    filter.ForwardTransform(input, &spectrum);
+    filter.InverseTransform(spectrum, &signal);
+    reberation.AddReberation(input, &left, &right);
+  }
+}
+
+static const Audio3DSource::QualityTier kTiers[] = {
+    Audio3DSource::kFullHRTF, Audio3DSource::kTruncatedHRTF,
+    Audio3DSource::kParametric };
+
+// Runs one pass over all quality tiers and a moving direction. The first
+// pass sizes all buffers, the second one has to be realtime safe.
+static void RenderSourcePass(int pass, vector<float>* input,
+                             vector<float>* output, Audio3DSource* source) {
+  for (int block = 0; block < 12; ++block) {
+    source->SetDirection(5.0f * pass, 25.0f * block - 150.0f, 1.0f + block);
+    source->SetQualityTier(kTiers[block / 4]);
+    FillBlock(block, input);
+    source->ProcessBlock(&(*input)[0], 2, &(*output)[0], &(*output)[1], 2);
+  }
+}
+
+TEST(RealtimeSafetyTest, Audio3DSourceProcessBlock) {
+  Audio3DSource source(kSampleRate, kBlockSize);
+  vector<float> stereo_input(2 * kBlockSize);
+  vector<float> output(2 * kBlockSize);
+  RenderSourcePass(0, &stereo_input, &output, &source);
+
+  ScopedRealtimeSection realtime_section;
+  RenderSourcePass(1, &stereo_input, &output, &source);
+}
+
+static void RenderScenePass(int pass, vector<float>* input,
+                            vector<float>* output, Audio3DScene* scene) {
+  for (int block = 0; block < 12; ++block) {
+    for (int i = 0; i < scene->GetNumSources(); ++i) {
+      Audio3DSource* source = scene->GetSource(i);
+      source->SetDirection(5.0f * pass, 25.0f * block + 90.0f * i, 2.0f);
+      source->SetQualityTier(kTiers[(block / 4 + i) % 3]);
+    }
+    FillBlock(block, input);
+    scene->ProcessBlock(&(*input)[0], &(*output)[0], &(*output)[kBlockSize],
+                        1);
+  }
+}
+
+// A single rendering thread; more workers synchronize through a mutex.
+TEST(RealtimeSafetyTest, Audio3DSceneProcessBlock) {
+  for (int mode = 0; mode < 2; ++mode) {
+    Audio3DScene scene(kSampleRate, kBlockSize);
+    scene.SetSummationMode(mode == 0 ? Audio3DScene::kTimeDomainSummation
+        : Audio3DScene::kFrequencyDomainSummation);
+    for (int i = 0; i < 3; ++i) {
+      scene.AddSource();
+    }
+    vector<float> input(3 * kBlockSize);
+    vector<float> output(2 * kBlockSize);
+    RenderScenePass(0, &input, &output, &scene);
+
+    ScopedRealtimeSection realtime_section;
+    RenderScenePass(1, &input, &output, &scene);
+  }
+}
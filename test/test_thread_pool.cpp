@@ -0,0 +1,62 @@
+#include <atomic>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+// Counts the runs of every item. The first items are much more expensive
+// than the rest so that the other workers run out of work and steal.
+class CountingTask : public ThreadPool::Task {
+ public:
+  CountingTask(int num_tasks, int num_workers)
+      : num_workers_(num_workers),
+        counts_(num_tasks) {
+    for (int i = 0; i < num_tasks; ++i) {
+      counts_[i] = 0;
+    }
+  }
+
+  virtual void Run(int task_index, int worker_index) {
+    ASSERT_GE(worker_index, 0);
+    ASSERT_LT(worker_index, num_workers_);
+    int num_iterations = task_index < 8 ? 20000 : 100;
+    volatile float sum = 0.0f;
+    for (int i = 0; i < num_iterations; ++i) {
+      sum += i * 0.5f;
+    }
+    ++counts_[task_index];
+  }
+
+  int GetCount(int task_index) const {
+    return counts_[task_index];
+  }
+
+ private:
+  int num_workers_;
+  vector<atomic<int> > counts_;
+};
+
+TEST(ThreadPoolTest, RunsEveryItemOnce) {
+  const int kNumTasks = 257;
+  const int num_workers[] = { 1, 2, 3, 8 };
+  for (int w = 0; w < 4; ++w) {
+    ThreadPool thread_pool(num_workers[w]);
+    ASSERT_EQ(num_workers[w], thread_pool.GetNumWorkers());
+    for (int iteration = 0; iteration < 20; ++iteration) {
+      CountingTask task(kNumTasks, num_workers[w]);
+      thread_pool.ParallelFor(kNumTasks, &task);
+      for (int i = 0; i < kNumTasks; ++i) {
+        ASSERT_EQ(1, task.GetCount(i)) << num_workers[w] << " workers";
+      }
+
+      const ThreadPool::Stats& stats = thread_pool.GetLastStats();
+      EXPECT_GT(stats.task_seconds, 0.0);
+      EXPECT_GE(stats.wall_seconds * num_workers[w], stats.task_seconds);
+      if (num_workers[w] == 1) {
+        EXPECT_EQ(0, stats.num_steals);
+      }
+    }
+  }
+}
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "wav_file.h"
+#include "wav_format.h"
+
+using namespace std;
+
+// Writes a minimal integer PCM WAV file with |bytes_per_sample| bytes per
+// sample from raw little endian sample data.
+static void WritePCMFile(const string& file_name, int num_channels,
+                         int bytes_per_sample,
+                         const vector<unsigned char>& data) {
+  unsigned char header[44] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0,
+                               'W', 'A', 'V', 'E', 'f', 'm', 't', ' ',
+                               16, 0, 0, 0, 1, 0 };
+  int size = data.size();
+  header[4] = (36 + size) & 0xFF;
+  header[5] = (36 + size) >> 8;
+  header[22] = num_channels;
+  header[24] = 44100 & 0xFF;
+  header[25] = 44100 >> 8;
+  header[32] = num_channels * bytes_per_sample;
+  header[34] = 8 * bytes_per_sample;
+  memcpy(header + 36, "data", 4);
+  header[40] = size & 0xFF;
+  header[41] = size >> 8;
+  FILE* file = fopen(file_name.c_str(), "wb");
+  ASSERT_TRUE(file != 0);
+  fwrite(header, 1, 44, file);
+  fwrite(&data[0], 1, data.size(), file);
+  fclose(file);
+}
+
+TEST(WavFileTest, FloatRoundTrip) {
+  vector<float> samples;
+  for (int i = 0; i < 3000; ++i) {
+    samples.push_back(0.001f * (i % 2000) - 1.0f);
+  }
+  string file_name = "test_wav_file_float.wav";
+  ASSERT_TRUE(WriteWavFile(file_name, 48000, 3, samples));
+
+  int sample_rate, num_channels;
+  vector<float> read_samples;
+  ASSERT_TRUE(ReadWavFile(file_name, &sample_rate, &num_channels,
+                          &read_samples));
+  EXPECT_EQ(48000, sample_rate);
+  EXPECT_EQ(3, num_channels);
+  EXPECT_EQ(samples, read_samples);
+  remove(file_name.c_str());
+}
+
+TEST(WavFileTest, ReadsIntegerPCM) {
+  // 0.5, -1, and -0.25 in 16 and 24 bit.
+  unsigned char short_data[] = { 0x00, 0x40, 0x00, 0x80, 0x00, 0xE0 };
+  unsigned char int24_data[] = { 0x00, 0x00, 0x40, 0x00, 0x00, 0x80,
+                                 0x00, 0x00, 0xE0 };
+  vector<unsigned char> data[2];
+  data[0].assign(short_data, short_data + sizeof(short_data));
+  data[1].assign(int24_data, int24_data + sizeof(int24_data));
+  string file_name = "test_wav_file_pcm.wav";
+  for (int i = 0; i < 2; ++i) {
+    WritePCMFile(file_name, 1, i + 2, data[i]);
+    int sample_rate, num_channels;
+    vector<float> samples;
+    ASSERT_TRUE(ReadWavFile(file_name, &sample_rate, &num_channels,
+                            &samples));
+    EXPECT_EQ(44100, sample_rate);
+    EXPECT_EQ(1, num_channels);
+    ASSERT_EQ(3, samples.size());
+    EXPECT_FLOAT_EQ(0.5f, samples[0]);
+    EXPECT_FLOAT_EQ(-1.0f, samples[1]);
+    EXPECT_FLOAT_EQ(-0.25f, samples[2]);
+  }
+  remove(file_name.c_str());
+}
+
+TEST(WavFileTest, PCM16ScalingRoundTrips) {
+  // The HRTF data sources and the WAV reader share one 16-bit scaling.
+  for (int value = -32768; value <= 32767; ++value) {
+    ASSERT_EQ(value, FloatToPCM16(PCM16ToFloat(value)));
+  }
+  EXPECT_FLOAT_EQ(-1.0f, PCM16ToFloat(-32768));
+  EXPECT_EQ(32767, FloatToPCM16(1.0f));
+  EXPECT_EQ(-32768, FloatToPCM16(-2.0f));
+}
+
+TEST(WavFileTest, StreamingWriterAndReader) {
+  const int kNumChannels = 2;
+  const int kNumFrames = 1000;
+  string file_name = "test_wav_file_streaming.wav";
+  {
+    // Small buffers so that Write() waits for the writer thread.
+    WavWriter writer(7, 2);
+    ASSERT_TRUE(writer.Open(file_name, 44100, kNumChannels));
+    vector<float> frames;
+    for (int frame = 0; frame < kNumFrames;) {
+      int num_frames = min(kNumFrames - frame, frame % 13 + 1);
+      frames.resize(kNumChannels * num_frames);
+      for (int i = 0; i < num_frames; ++i) {
+        frames[2 * i] = (frame + i) * 0.001f;
+        frames[2 * i + 1] = -(frame + i) * 0.001f;
+      }
+      ASSERT_TRUE(writer.Write(&frames[0], num_frames));
+      frame += num_frames;
+    }
+    EXPECT_TRUE(writer.Close());
+  }
+
+  WavReader reader;
+  ASSERT_TRUE(reader.Open(file_name));
+  EXPECT_EQ(44100, reader.GetSampleRate());
+  EXPECT_EQ(kNumChannels, reader.GetNumChannels());
+  ASSERT_EQ(kNumFrames, reader.GetNumFrames());
+  vector<float> left(64), right(64);
+  for (int frame = 0; frame < kNumFrames + 64; frame += 64) {
+    reader.ReadChannel(0, frame, 64, &left[0]);
+    reader.ReadChannel(1, frame, 64, &right[0]);
+    reader.ReleaseFrames(frame);
+    for (int i = 0; i < 64; ++i) {
+      float expected = frame + i < kNumFrames ? (frame + i) * 0.001f : 0.0f;
+      EXPECT_EQ(expected, left[i]);
+      EXPECT_EQ(-expected, right[i]);
+    }
+  }
+  // Released frames are mapped again.
+  reader.ReadChannel(0, 10, 1, &left[0]);
+  EXPECT_EQ(10 * 0.001f, left[0]);
+  remove(file_name.c_str());
+}
+
+TEST(WavFileTest, ZeroSampleRateFails) {
+  string file_name = "test_wav_file_rate.wav";
+  WriteWavFile(file_name, 0, 1, vector<float>(16, 0.0f));
+  WavReader reader;
+  EXPECT_FALSE(reader.Open(file_name));
+  remove(file_name.c_str());
+}
+
+TEST(WavFileTest, MissingFileFails) {
+  int sample_rate, num_channels;
+  vector<float> samples;
+  EXPECT_FALSE(ReadWavFile("does_not_exist.wav", &sample_rate,
+                           &num_channels, &samples));
+}
@@ -0,0 +1,313 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "audio_3d.h"
+#include "audio_3d_scene.h"
+#include "wav_file.h"
+
+using namespace std;
+
+// Renders a scene of WAV sources moving along trajectories into a stereo
+// WAV file, as fast as the machine allows and without an audio device. The
+// inputs are memory-mapped and the output is written while rendering, so
+// memory use does not depend on the length of the session.
+//
+// Scene file, one statement per line, '#' starts a comment:
+//   block_size <frames>     Render block size, default 256.
+//   threads <count>         Render threads, default 0 (all cores).
+//   tail <seconds>          Rendered after the longest input, default 1.
+//   reverb fdn <low> <high> FDN reverb with decay times in seconds at low
+//                           and high frequencies instead of the default
+//                           convolution reverb.
+//   source <wav> direction <trajectory> [channel]
+//   source <wav> position <trajectory> [channel]
+//
+// Every source renders one channel of its WAV file, channel 0 by default.
+// Sources can share a multichannel file.
+//
+// A trajectory file holds "<seconds> <a> <b> <c>" keyframes in ascending
+// time, "<elevation> <azimuth> <distance>" for direction trajectories and
+// listener-relative "<x> <y> <z>" in meters for position trajectories. The
+// keyframes are interpolated linearly at the start of every block, azimuths
+// along the shorter arc. Relative paths are resolved against the directory
+// of the scene file. All inputs must share one sample rate.
+
+namespace {
+
+struct Keyframe {
+  double time;
+  float values[3];
+};
+
+struct SourceDescription {
+  string wav_file;
+  bool position;
+  int channel;
+  vector<Keyframe> trajectory;
+};
+
+struct SceneDescription {
+  SceneDescription()
+      : block_size(256),
+        num_threads(0),
+        tail_seconds(1.0),
+        fdn_reverb(false),
+        low_reverb_time(0.0f),
+        high_reverb_time(0.0f) {
+  }
+  int block_size;
+  int num_threads;
+  double tail_seconds;
+  bool fdn_reverb;
+  float low_reverb_time;
+  float high_reverb_time;
+  vector<SourceDescription> sources;
+};
+
+string ResolvePath(const string& directory, const string& path) {
+  if (path.empty() || path[0] == '/' || directory.empty()) {
+    return path;
+  }
+  return directory + "/" + path;
+}
+
+bool ReadTrajectory(const string& file_name, vector<Keyframe>* trajectory) {
+  ifstream file(file_name.c_str());
+  if (!file) {
+    cerr << "Cannot open trajectory file: " << file_name << endl;
+    return false;
+  }
+  string line;
+  for (int line_number = 1; getline(file, line); ++line_number) {
+    line = line.substr(0, line.find('#'));
+    istringstream stream(line);
+    Keyframe keyframe;
+    if (!(stream >> keyframe.time)) {
+      continue;  // Empty line.
+    }
+    if (!(stream >> keyframe.values[0] >> keyframe.values[1]
+          >> keyframe.values[2])
+        || (!trajectory->empty() && keyframe.time < trajectory->back().time)) {
+      cerr << file_name << ":" << line_number << ": Invalid keyframe" << endl;
+      return false;
+    }
+    trajectory->push_back(keyframe);
+  }
+  if (trajectory->empty()) {
+    cerr << file_name << ": No keyframes" << endl;
+    return false;
+  }
+  return true;
+}
+
+bool ReadScene(const string& file_name, SceneDescription* scene) {
+  ifstream file(file_name.c_str());
+  if (!file) {
+    cerr << "Cannot open scene file: " << file_name << endl;
+    return false;
+  }
+  string directory;
+  size_t slash = file_name.rfind('/');
+  if (slash != string::npos) {
+    directory = file_name.substr(0, slash);
+  }
+
+  string line;
+  for (int line_number = 1; getline(file, line); ++line_number) {
+    line = line.substr(0, line.find('#'));
+    istringstream stream(line);
+    string keyword;
+    if (!(stream >> keyword)) {
+      continue;
+    }
+    bool valid;
+    if (keyword == "block_size") {
+      valid = (stream >> scene->block_size) && scene->block_size > 0;
+    } else if (keyword == "threads") {
+      valid = static_cast<bool>(stream >> scene->num_threads);
+    } else if (keyword == "tail") {
+      valid = (stream >> scene->tail_seconds) && scene->tail_seconds >= 0.0;
+    } else if (keyword == "reverb") {
+      string mode;
+      valid = (stream >> mode >> scene->low_reverb_time
+               >> scene->high_reverb_time) && mode == "fdn"
+          && scene->low_reverb_time > 0.0f && scene->high_reverb_time > 0.0f;
+      scene->fdn_reverb = true;
+    } else if (keyword == "source") {
+      SourceDescription source;
+      string mode, trajectory_file;
+      source.channel = 0;
+      valid = (stream >> source.wav_file >> mode >> trajectory_file)
+          && (mode == "direction" || mode == "position");
+      if (valid && !(stream >> source.channel)) {
+        valid = stream.eof() && source.channel == 0;
+      }
+      if (valid) {
+        source.wav_file = ResolvePath(directory, source.wav_file);
+        source.position = mode == "position";
+        if (!ReadTrajectory(ResolvePath(directory, trajectory_file),
+                            &source.trajectory)) {
+          return false;
+        }
+        scene->sources.push_back(source);
+      }
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      cerr << file_name << ":" << line_number << ": Invalid statement"
+          << endl;
+      return false;
+    }
+  }
+  if (scene->sources.empty()) {
+    cerr << file_name << ": No sources" << endl;
+    return false;
+  }
+  return true;
+}
+
+void EvaluateTrajectory(const SourceDescription& source, double time,
+                        float* values) {
+  const vector<Keyframe>& trajectory = source.trajectory;
+  int next = 0;
+  while (next < trajectory.size() && trajectory[next].time <= time) {
+    ++next;
+  }
+  if (next == 0 || next == trajectory.size()) {
+    const Keyframe& keyframe = trajectory[max(next - 1, 0)];
+    copy(keyframe.values, keyframe.values + 3, values);
+    return;
+  }
+  const Keyframe& a = trajectory[next - 1];
+  const Keyframe& b = trajectory[next];
+  float t = static_cast<float>((time - a.time) / (b.time - a.time));
+  for (int i = 0; i < 3; ++i) {
+    float delta = b.values[i] - a.values[i];
+    if (!source.position && i == 1) {
+      delta = remainderf(delta, 360.0f);
+    }
+    values[i] = a.values[i] + t * delta;
+  }
+  if (!source.position) {
+    values[1] = remainderf(values[1], 360.0f);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    cerr << "Usage: " << argv[0] << " <scene file> <output wav>" << endl;
+    return 1;
+  }
+  SceneDescription description;
+  if (!ReadScene(argv[1], &description)) {
+    return 1;
+  }
+
+  // Opens every input file once.
+  map<string, WavReader*> readers;
+  vector<const WavReader*> source_readers;
+  bool valid = true;
+  int sample_rate = 0;
+  int num_input_frames = 0;
+  for (int i = 0; valid && i < description.sources.size(); ++i) {
+    const SourceDescription& source = description.sources[i];
+    WavReader*& reader = readers[source.wav_file];
+    if (!reader) {
+      reader = new WavReader;
+      if (!reader->Open(source.wav_file)) {
+        valid = false;
+        break;
+      }
+    }
+    source_readers.push_back(reader);
+    if (source.channel < 0 || source.channel >= reader->GetNumChannels()
+        || (sample_rate != 0 && reader->GetSampleRate() != sample_rate)) {
+      cerr << source.wav_file << ": Expected channel " << source.channel
+          << " at " << (sample_rate ? sample_rate : reader->GetSampleRate())
+          << " Hz" << endl;
+      valid = false;
+    }
+    sample_rate = reader->GetSampleRate();
+    num_input_frames = max(num_input_frames, reader->GetNumFrames());
+  }
+
+  int block_size = description.block_size;
+  int num_frames = num_input_frames
+      + static_cast<int>(description.tail_seconds * sample_rate);
+  int num_blocks = (num_frames + block_size - 1) / block_size;
+  int num_sources = description.sources.size();
+
+  // Up to a second of output is queued for the writer thread.
+  WavWriter writer(block_size, max(2, sample_rate / block_size));
+  valid = valid && writer.Open(argv[2], sample_rate, 2);
+
+  double render_seconds = 0.0;
+  if (valid) {
+    Audio3DScene scene(sample_rate, block_size);
+    scene.SetNumThreads(description.num_threads);
+    if (description.fdn_reverb) {
+      scene.SetReverbMode(Audio3DScene::kFDNReverb);
+      scene.SetFDNReverbTime(description.low_reverb_time,
+                             description.high_reverb_time);
+    }
+    for (int i = 0; i < num_sources; ++i) {
+      scene.AddSource();
+    }
+
+    vector<float> output(2 * block_size);
+    vector<vector<float> > inputs(num_sources, vector<float>(block_size));
+    vector<const float*> input_channels(num_sources);
+    for (int i = 0; i < num_sources; ++i) {
+      input_channels[i] = &inputs[i][0];
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int block = 0; valid && block < num_blocks; ++block) {
+      int frame = block * block_size;
+      double time = static_cast<double>(frame) / sample_rate;
+      for (int i = 0; i < num_sources; ++i) {
+        const SourceDescription& source = description.sources[i];
+        float values[3];
+        EvaluateTrajectory(source, time, values);
+        if (source.position) {
+          scene.SetSourcePosition(i, values[0], values[1], values[2]);
+        } else {
+          scene.GetSource(i)->SetDirection(values[0], values[1], values[2]);
+        }
+        source_readers[i]->ReadChannel(source.channel, frame, block_size,
+                                       &inputs[i][0]);
+      }
+      for (map<string, WavReader*>::iterator it = readers.begin();
+           it != readers.end(); ++it) {
+        it->second->ReleaseFrames(frame);
+      }
+      scene.ProcessBlock(&input_channels[0], &output[0], &output[1], 2);
+      valid = writer.Write(&output[0], min(block_size, num_frames - frame));
+    }
+    render_seconds = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+    cout << "Rendered " << static_cast<double>(num_frames) / sample_rate
+        << " s of audio from " << num_sources << " sources in "
+        << render_seconds << " s on " << scene.GetNumThreads()
+        << " threads, real-time factor "
+        << num_frames / (sample_rate * max(render_seconds, 1e-9)) << endl;
+  }
+  valid = writer.Close() && valid;
+
+  for (map<string, WavReader*>::iterator it = readers.begin();
+       it != readers.end(); ++it) {
+    delete it->second;
+  }
+  return valid ? 0 : 1;
+}